@@ -0,0 +1,130 @@
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/art/range_lock.hpp"
+#include "../src/v0/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 8;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr int depthSamples = 10000;
+constexpr int runtimes = 3;
+
+using V0 = ConcurrentRangeLock<uint64_t, 24>;
+
+// heldRanges ranges [10i + 1, 10i + 5] stay locked. Every thread locks and
+// releases ranges in the gaps between them, so every operation succeeds
+// after a full search of the index.
+template <typename RangeLock>
+double runWorkload(RangeLock &rl, int numThreads, uint64_t heldRanges) {
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937_64 rng(i);
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t start = rng() % heldRanges * 10 + 6;
+                if (rl.tryLock(start, start + 3)) {
+                    rl.releaseLock(start, start + 3);
+                }
+                ++ops;
+            }
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+// Thread counts above the number of hardware threads are oversubscribed
+template <typename RangeLock>
+void sweep(const char *name, RangeLock &rl, uint64_t heldRanges,
+           std::ofstream &outFile) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 8) {
+        bool oversubscribed = static_cast<unsigned>(numThreads) > cores;
+        const char *note = oversubscribed ? " (oversubscribed)" : "";
+        std::cout << name << ", threads: " << numThreads << note << "\n";
+        outFile << name << ", threads: " << numThreads << note << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload(rl, numThreads, heldRanges);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average operations per second: " << average << "\n";
+        outFile << "Average operations per second: " << average << "\n";
+    }
+}
+
+template <typename RangeLock>
+void fill(RangeLock &rl, uint64_t heldRanges) {
+    for (uint64_t i = 0; i < heldRanges; ++i) {
+        rl.tryLock(i * 10 + 1, i * 10 + 5);
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/art_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    for (uint64_t heldRanges : {100000, 1000000, 10000000}) {
+        std::cout << "Held ranges: " << heldRanges << "\n";
+        outFile << "Held ranges: " << heldRanges << "\n";
+
+        {
+            auto art = std::make_unique<ArtRangeLock>();
+            fill(*art, heldRanges);
+
+            std::mt19937_64 rng(0);
+            uint64_t nodes = 0;
+            for (int i = 0; i < depthSamples; ++i) {
+                nodes += art->depth(rng() % heldRanges * 10 + 6);
+            }
+            double depth = static_cast<double>(nodes) / depthSamples;
+            std::cout << "ART nodes per lookup: " << depth << "\n";
+            outFile << "ART nodes per lookup: " << depth << "\n";
+
+            sweep("ART", *art, heldRanges, outFile);
+        }
+
+        // ConcurrentRangeLock never frees its nodes
+        auto v0 = new V0();
+        fill(*v0, heldRanges);
+        sweep("V0", *v0, heldRanges, outFile);
+        std::cout << "----------------------------------\n";
+    }
+
+    outFile.close();
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../src/v3/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 16;
+constexpr int heldRanges = 2000;
+constexpr int rangesPerRun = 200000;
+constexpr int runtimes = 3;
+
+// heldRanges long-lived ranges at multiples of 100 fill the list. Every
+// transaction of a thread locks batchSize ranges spread evenly over that key
+// space, each in a gap between two held ranges and at a per-thread offset,
+// and releases all of them at commit.
+double runWorkload(int numThreads, int batchSize, bool batched) {
+    SongRangeLock rl;
+    for (int i = 0; i < heldRanges; ++i) {
+        rl.tryLock(static_cast<uint64_t>(i) * 100 + 1,
+                   static_cast<uint64_t>(i) * 100 + 5);
+    }
+
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    const int transactions = rangesPerRun / batchSize / numThreads;
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::vector<std::pair<uint64_t, uint64_t>> ranges;
+            uint64_t stride = heldRanges / batchSize * 100;
+            for (int j = 0; j < batchSize; ++j) {
+                uint64_t start = j * stride + 10 + 5 * i;
+                ranges.emplace_back(start, start + 3);
+            }
+
+            syncPoint.arrive_and_wait();
+
+            for (int t = 0; t < transactions; ++t) {
+                if (batched) {
+                    rl.tryLockBatch(ranges);
+                    rl.releaseLockBatch(ranges);
+                } else {
+                    for (auto &range : ranges) {
+                        rl.tryLock(range.first, range.second);
+                    }
+                    for (auto &range : ranges) {
+                        rl.releaseLock(range.first);
+                    }
+                }
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(transactions) * batchSize * numThreads /
+           duration.count();
+}
+
+void sweep(int batchSize, bool batched, std::ofstream &outFile) {
+    const char *mode = batched ? "batched" : "one by one";
+    std::cout << "Ranges per transaction: " << batchSize << ", " << mode
+              << ":\n";
+    outFile << "Ranges per transaction: " << batchSize << ", " << mode
+            << ":\n";
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        std::cout << "Threads: " << numThreads << "\n";
+        outFile << "Threads: " << numThreads << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload(numThreads, batchSize, batched);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average ranges locked and released per second: "
+                  << average << "\n";
+        outFile << "Average ranges locked and released per second: "
+                << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/batch_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    for (int batchSize : {16, 64, 256}) {
+        sweep(batchSize, false, outFile);
+        sweep(batchSize, true, outFile);
+    }
+
+    outFile.close();
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/biased/range_lock.hpp"
+#include "../src/v0/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 8;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr uint64_t regionSize = 1 << 16;
+constexpr uint64_t maxWidth = 64;
+constexpr int runtimes = 3;
+
+using V0 = ConcurrentRangeLock<uint64_t, 12>;
+using Biased = BiasedRangeLock<12>;
+
+// The skip list starts at key 1 for the pure skip list, as its head takes 0
+uint64_t keyOffset(V0 &) { return 1; }
+
+uint64_t keyOffset(Biased &) { return 0; }
+
+V0 *makeLock(V0 *) { return new V0(); }
+
+Biased *makeLock(Biased *) { return new Biased(regionSize, maxThreads); }
+
+// Every thread locks and releases ranges of up to maxWidth keys in a region
+// of its own, and crossPercent of the time in the next thread's region
+template <typename RangeLock>
+double runWorkload(int numThreads, int crossPercent) {
+    std::unique_ptr<RangeLock> rl(makeLock(static_cast<RangeLock *>(nullptr)));
+    const uint64_t offset = keyOffset(*rl);
+
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937_64 rng(i);
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t region = i;
+                if (static_cast<int>(rng() % 100) < crossPercent) {
+                    region = (region + 1) % numThreads;
+                }
+                uint64_t start =
+                    region * regionSize + rng() % (regionSize - maxWidth);
+                uint64_t end = start + rng() % maxWidth;
+                if (rl->tryLock(start + offset, end + offset)) {
+                    rl->releaseLock(start + offset, end + offset);
+                }
+                ++ops;
+            }
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+// Thread counts above the number of hardware threads are oversubscribed
+template <typename RangeLock>
+void sweep(const char *name, int crossPercent, std::ofstream &outFile) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    std::cout << name << ", " << crossPercent << "% cross-region:\n";
+    outFile << name << ", " << crossPercent << "% cross-region:\n";
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        bool oversubscribed = static_cast<unsigned>(numThreads) > cores;
+        const char *note = oversubscribed ? " (oversubscribed)" : "";
+        std::cout << "Threads: " << numThreads << note << "\n";
+        outFile << "Threads: " << numThreads << note << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload<RangeLock>(numThreads, crossPercent);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average operations per second: " << average << "\n";
+        outFile << "Average operations per second: " << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/biased_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    for (int crossPercent : {0, 1}) {
+        sweep<V0>("V0", crossPercent, outFile);
+        sweep<Biased>("Biased", crossPercent, outFile);
+    }
+
+    outFile.close();
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/bitmap/range_lock.hpp"
+#include "../src/v0/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 8;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr int runtimes = 3;
+
+// Every thread locks and releases ranges of the given width at random
+// positions in the 16-bit key space. Keys 0 and 65535 are left out, since
+// the skip list uses them for its head and tail.
+template <typename RangeLock>
+double runWorkload(int numThreads, uint16_t width) {
+    RangeLock rl{};
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937 rng(i);
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint16_t start = 1 + rng() % (65534 - width);
+                uint16_t end = start + width - 1;
+                if (rl.tryLock(start, end)) {
+                    rl.releaseLock(start, end);
+                }
+                ++ops;
+            }
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+// Thread counts above the number of hardware threads are oversubscribed
+template <typename RangeLock>
+void sweep(const char *name, std::ofstream &outFile) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 8) {
+        bool oversubscribed = static_cast<unsigned>(numThreads) > cores;
+        const char *note = oversubscribed ? " (oversubscribed)" : "";
+        std::cout << name << ", threads: " << numThreads << note << ":\n";
+        outFile << name << ", threads: " << numThreads << note << ":\n";
+        for (int width = 1; width <= 4096; width *= 4) {
+            double total = 0;
+            for (int i = 0; i < runtimes; i++) {
+                total += runWorkload<RangeLock>(numThreads, width);
+            }
+            double average = total / runtimes;
+
+            std::cout << "Width " << width
+                      << ", average operations per second: " << average
+                      << "\n";
+            outFile << "Width " << width
+                    << ", average operations per second: " << average << "\n";
+        }
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/bitmap_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    sweep<ConcurrentRangeLock<uint16_t, 4>>("V0", outFile);
+    sweep<BitmapRangeLock<uint16_t>>("Bitmap", outFile);
+
+    outFile.close();
+    return 0;
+}
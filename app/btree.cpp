@@ -0,0 +1,117 @@
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/btree/range_lock.hpp"
+#include "../src/v0/range_lock.hpp"
+#include "../src/v1/range_lock.cpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 16;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr uint64_t heldRanges = 1000000;
+constexpr int runtimes = 3;
+
+// heldRanges ranges [10i + 1, 10i + 5] stay locked. Every thread locks and
+// releases ranges in the gaps between them, so every operation succeeds
+// after a full search of the index.
+template <typename RangeLock>
+double runWorkload(RangeLock &rl, int numThreads) {
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937_64 rng(i);
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t start = rng() % heldRanges * 10 + 6;
+                if (rl.tryLock(start, start + 3)) {
+                    rl.releaseLock(start, start + 3);
+                }
+                ++ops;
+            }
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+// Thread counts above the number of hardware threads are oversubscribed.
+// The range lock is filled once and shared by all runs.
+template <typename RangeLock>
+void sweep(const char *name, RangeLock &rl, std::ofstream &outFile) {
+    for (uint64_t i = 0; i < heldRanges; ++i) {
+        rl.tryLock(i * 10 + 1, i * 10 + 5);
+    }
+
+    const unsigned cores = std::thread::hardware_concurrency();
+    std::cout << name << ":\n";
+    outFile << name << ":\n";
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        bool oversubscribed = static_cast<unsigned>(numThreads) > cores;
+        const char *note = oversubscribed ? " (oversubscribed)" : "";
+        std::cout << "Threads: " << numThreads << note << "\n";
+        outFile << "Threads: " << numThreads << note << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload(rl, numThreads);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average operations per second: " << average << "\n";
+        outFile << "Average operations per second: " << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/btree_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    // The skip lists never free their nodes
+    sweep("V0", *new ConcurrentRangeLock<uint64_t, 20>(), outFile);
+    sweep("V1", *new ConcurrentRangeLock_V1<uint64_t, 20>(), outFile);
+    {
+        BTreeRangeLock<16> btl;
+        sweep("B+-tree, fanout 16", btl, outFile);
+    }
+    {
+        BTreeRangeLock<32> btl;
+        sweep("B+-tree, fanout 32", btl, outFile);
+    }
+    {
+        BTreeRangeLock<64> btl;
+        sweep("B+-tree, fanout 64", btl, outFile);
+    }
+
+    outFile.close();
+    return 0;
+}
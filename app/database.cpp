@@ -65,16 +65,18 @@ void database_transaction_v0(ConcurrentRangeLock<uint64_t, lockHeight> &crl,
     }
 }
 
-// Function to simulate a database transaction for v1
+// Function to simulate a database transaction for v1. With wait, conflicts
+// are waited out inside the list instead of sleeping and retrying.
 void database_transaction_v1(ListRL &list, int thread_id,
-                             int num_transactions) {
+                             int num_transactions, bool wait) {
     std::mt19937 rng(thread_id);
 
     for (int i = 0; i < num_transactions; ++i) {
         int start = dist(rng);
         int end = start + range_dist(rng);
 
-        auto rl = MutexRangeAcquire(&list, start, end);
+        auto rl = wait ? MutexRangeAcquireWait(&list, start, end)
+                       : MutexRangeAcquire(&list, start, end);
 
         while (rl == nullptr) {
             std::this_thread::sleep_for(std::chrono::milliseconds(time_delay));
@@ -114,12 +116,12 @@ auto benchmark_v0(int num_threads, int num_transactions_per_thread) {
 }
 
 // Benchmark function of v1 range lock
-auto benchmark_v1(int num_threads, int num_transactions_per_thread) {
+auto benchmark_v1(int num_threads, int num_transactions_per_thread, bool wait) {
     std::vector<std::thread> threads;
     ListRL list;
 
     for (int i = 0; i < num_threads; ++i) {
-        threads.emplace_back(database_transaction_v1, std::ref(list), i, num_transactions_per_thread);
+        threads.emplace_back(database_transaction_v1, std::ref(list), i, num_transactions_per_thread, wait);
     }
 
     auto start_time = std::chrono::high_resolution_clock::now();
@@ -129,8 +131,8 @@ auto benchmark_v1(int num_threads, int num_transactions_per_thread) {
     auto end_time = std::chrono::high_resolution_clock::now();
 
     std::chrono::duration<double> total_time = end_time - start_time;
-    std::cout << "Num threads: " << num_threads << ". Total time taken v1: " << total_time.count() << " seconds"
-              << std::endl;
+    std::cout << "Num threads: " << num_threads << ". Total time taken v1" << (wait ? " waiting" : "") << ": "
+              << total_time.count() << " seconds" << std::endl;
 
 
     return total_time.count();
@@ -141,7 +143,8 @@ int main() {
 
     for (int i = 10; i <= 50; i += 10) {
         benchmark_v0(i, num_transactions_per_thread);
-        benchmark_v1(i, num_transactions_per_thread);
+        benchmark_v1(i, num_transactions_per_thread, false);
+        benchmark_v1(i, num_transactions_per_thread, true);
         std::cout << std::endl;
     }
 
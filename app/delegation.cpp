@@ -0,0 +1,114 @@
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../src/v0/range_lock.hpp"
+#include "../src/v3/delegation.hpp"
+#include "../src/v3/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 64;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr int rangesPerThread = 16;
+constexpr int runtimes = 3;
+
+using V0 = ConcurrentRangeLock<uint64_t, 6>;
+
+void release(V0 &rl, uint64_t start, uint64_t end) {
+    rl.releaseLock(start, end);
+}
+
+void release(SongRangeLock<> &rl, uint64_t start, uint64_t) {
+    rl.releaseLock(start);
+}
+
+void release(DelegatedRangeLock &rl, uint64_t start, uint64_t) {
+    rl.releaseLock(start);
+}
+
+// Same workload as app/global_lock.cpp: every thread locks and immediately
+// releases ranges in its own key region, so all the contention is on the
+// structure itself. Runs are time-bounded.
+template <typename RangeLock>
+double runWorkload(int numThreads) {
+    RangeLock rl;
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            uint64_t base = 1 + static_cast<uint64_t>(i) * rangesPerThread * 10;
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t start = base + (ops++ % rangesPerThread) * 10;
+                if (rl.tryLock(start, start + 5)) {
+                    release(rl, start, start + 5);
+                }
+            }
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+// Thread counts above the number of hardware threads are oversubscribed.
+// The delegation server takes one hardware thread of its own.
+template <typename RangeLock>
+void sweep(const char *name, std::ofstream &outFile) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    std::cout << name << ":\n";
+    outFile << name << ":\n";
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        bool oversubscribed = static_cast<unsigned>(numThreads) > cores;
+        const char *note = oversubscribed ? " (oversubscribed)" : "";
+        std::cout << "Threads: " << numThreads << note << "\n";
+        outFile << "Threads: " << numThreads << note << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload<RangeLock>(numThreads);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average operations per second: " << average << "\n";
+        outFile << "Average operations per second: " << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/delegation_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    sweep<V0>("V0", outFile);
+    sweep<SongRangeLock<>>("V3 std::mutex", outFile);
+    sweep<DelegatedRangeLock>("V3 delegation", outFile);
+
+    outFile.close();
+    return 0;
+}
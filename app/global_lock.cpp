@@ -0,0 +1,103 @@
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../src/v3/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 64;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr int rangesPerThread = 16;
+constexpr int runtimes = 3;
+
+// Every thread locks and immediately releases ranges in its own key region,
+// so the list stays short and the global lock is held only briefly. Runs
+// are time-bounded, since unfair or convoying locks can fall behind by
+// orders of magnitude once threads are oversubscribed.
+template <typename Lock>
+double runWorkload(int numThreads) {
+    SongRangeLock<Lock> rl;
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            uint64_t base = 1 + static_cast<uint64_t>(i) * rangesPerThread * 10;
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t start = base + (ops++ % rangesPerThread) * 10;
+                if (rl.tryLock(start, start + 5)) {
+                    rl.releaseLock(start);
+                }
+            }
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+// Thread counts above the number of hardware threads are oversubscribed
+template <typename Lock>
+void sweep(const char *name, std::ofstream &outFile) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    std::cout << name << ":\n";
+    outFile << name << ":\n";
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        bool oversubscribed = static_cast<unsigned>(numThreads) > cores;
+        const char *note = oversubscribed ? " (oversubscribed)" : "";
+        std::cout << "Threads: " << numThreads << note << "\n";
+        outFile << "Threads: " << numThreads << note << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload<Lock>(numThreads);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average operations per second: " << average << "\n";
+        outFile << "Average operations per second: " << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/global_lock_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    sweep<std::mutex>("std::mutex", outFile);
+    sweep<SpinThenParkMutex>("std::mutex, spin then park", outFile);
+    sweep<TTASLock<false>>("TTAS", outFile);
+    sweep<TTASLock<true>>("TTAS, spin then park", outFile);
+    sweep<TicketLock<false>>("Ticket", outFile);
+    sweep<TicketLock<true>>("Ticket, spin then park", outFile);
+    sweep<MCSLock<false>>("MCS", outFile);
+    sweep<MCSLock<true>>("MCS, spin then park", outFile);
+
+    outFile.close();
+    return 0;
+}
@@ -101,9 +101,10 @@ void runScalabilityV0(benchmark::State& state) {
     destroySharedMemory(sharedMemory);
 }
 
+template <typename Lock>
 void runScalabilityV1(benchmark::State& state) {
     int numThreads = state.range(0);
-    ConcurrentRangeLock_V1<uint64_t, 6> crl{};
+    ConcurrentRangeLock_V1<uint64_t, 6, Lock> crl{};
     std::vector<std::thread> threads;
     threads.reserve(numThreads);
 
@@ -141,6 +142,7 @@ void runScalabilityV1(benchmark::State& state) {
         state.SetIterationTime(duration.count());
     }
 
+    state.counters["node_bytes"] = sizeof(Node_V1<uint64_t, Lock>);
     destroySharedMemory(sharedMemory);
 }
 
@@ -242,7 +244,19 @@ BENCHMARK(runScalabilityV0)
     ->UseManualTime()
     ->Iterations(5);
 
-BENCHMARK(runScalabilityV1)
+BENCHMARK_TEMPLATE(runScalabilityV1, MutexLock)
+    ->RangeMultiplier(2)
+    ->Range(minThreads, maxThreads)
+    ->UseManualTime()
+    ->Iterations(5);
+
+BENCHMARK_TEMPLATE(runScalabilityV1, SpinLock)
+    ->RangeMultiplier(2)
+    ->Range(minThreads, maxThreads)
+    ->UseManualTime()
+    ->Iterations(5);
+
+BENCHMARK_TEMPLATE(runScalabilityV1, OptimisticMutex)
     ->RangeMultiplier(2)
     ->Range(minThreads, maxThreads)
     ->UseManualTime()
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/v2/range_lock.cpp"
+
+constexpr int minHeld = 1000;
+constexpr int maxHeld = 1000000;
+constexpr int heldStep = 10;
+constexpr long long workPerRun = 100000000;
+constexpr int runtimes = 3;
+// 2^18 buckets of 64 keys cover the 10M keys of the largest list
+constexpr size_t hintBuckets = 1 << 18;
+
+// Fill the list with held ranges [10i, 10i + 5), then time acquire and
+// release of random ranges in the gaps between them. The list is filled in
+// descending order so that the fill itself stays O(1) per insert even
+// without the index. Fewer operations are timed for larger lists, since
+// without the index every acquire walks half the list on average.
+double runWorkload(int held, bool hints) {
+    ListRL list(hints ? hintBuckets : 0);
+    for (int i = held - 1; i >= 0; --i) {
+        MutexRangeAcquire(&list, static_cast<uint64_t>(i) * 10,
+                          static_cast<uint64_t>(i) * 10 + 5);
+    }
+
+    int ops = std::clamp<long long>(workPerRun / held, 100, 100000);
+    std::mt19937 rng(held);
+    std::uniform_int_distribution<uint64_t> dist(0, held - 1);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; ++i) {
+        uint64_t gap = dist(rng) * 10 + 6;
+        auto rl = MutexRangeAcquire(&list, gap, gap + 3);
+        if (rl) {
+            MutexRangeRelease(&list, rl);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> duration = end - start;
+
+    return duration.count() / ops;
+}
+
+int main() {
+    std::ofstream outFile("data/hint_index_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    for (bool hints : {false, true}) {
+        const char *name = hints ? "V2 with hint index:\n" : "V2:\n";
+        std::cout << name;
+        outFile << name;
+        for (int held = minHeld; held <= maxHeld; held *= heldStep) {
+            std::cout << "Held ranges: " << held << "\n";
+            outFile << "Held ranges: " << held << "\n";
+
+            double total = 0;
+            for (int i = 0; i < runtimes; i++) {
+                total += runWorkload(held, hints);
+            }
+            double average = total / runtimes;
+
+            std::cout << "Average ns per acquire and release: " << average
+                      << "\n";
+            outFile << "Average ns per acquire and release: " << average
+                    << "\n";
+            std::cout << "----------------------------------\n";
+        }
+    }
+
+    outFile.close();
+    return 0;
+}
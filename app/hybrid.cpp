@@ -0,0 +1,128 @@
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/hybrid/range_lock.hpp"
+#include "../src/v0/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 8;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr uint64_t pageSize = 4096;
+constexpr uint64_t workingPages = 1 << 15;
+constexpr uint64_t heldRanges = 10000;
+constexpr int alignedPercent = 95;
+constexpr int runtimes = 3;
+
+using V0 = ConcurrentRangeLock<uint64_t, 12>;
+using Hybrid = HybridRangeLock<12>;
+
+// The skip list starts at key 1 for the pure skip list, as its head takes 0
+uint64_t keyOffset(V0 &) { return 1; }
+
+uint64_t keyOffset(Hybrid &) { return 0; }
+
+V0 *makeLock(V0 *) { return new V0(); }
+
+Hybrid *makeLock(Hybrid *) { return new Hybrid(2 * workingPages); }
+
+// heldRanges long-lived unaligned ranges sit in pages above the working
+// set, so that the skip list is not empty. Every thread then locks and
+// releases ranges in the working set, alignedPercent of them one to four
+// whole pages and the rest up to 256 bytes at an arbitrary offset.
+template <typename RangeLock>
+double runWorkload(int numThreads) {
+    std::unique_ptr<RangeLock> rl(makeLock(static_cast<RangeLock *>(nullptr)));
+    const uint64_t offset = keyOffset(*rl);
+    for (uint64_t i = 0; i < heldRanges; ++i) {
+        uint64_t start = (workingPages + i) * pageSize + 100;
+        rl->tryLock(start + offset, start + offset + 99);
+    }
+
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937_64 rng(i);
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t start, end;
+                if (static_cast<int>(rng() % 100) < alignedPercent) {
+                    start = rng() % (workingPages - 4) * pageSize;
+                    end = start + (1 + rng() % 4) * pageSize - 1;
+                } else {
+                    start = rng() % ((workingPages - 1) * pageSize);
+                    end = start + rng() % 256;
+                }
+                if (rl->tryLock(start + offset, end + offset)) {
+                    rl->releaseLock(start + offset, end + offset);
+                }
+                ++ops;
+            }
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+// Thread counts above the number of hardware threads are oversubscribed
+template <typename RangeLock>
+void sweep(const char *name, std::ofstream &outFile) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    std::cout << name << ":\n";
+    outFile << name << ":\n";
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        bool oversubscribed = static_cast<unsigned>(numThreads) > cores;
+        const char *note = oversubscribed ? " (oversubscribed)" : "";
+        std::cout << "Threads: " << numThreads << note << "\n";
+        outFile << "Threads: " << numThreads << note << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload<RangeLock>(numThreads);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average operations per second: " << average << "\n";
+        outFile << "Average operations per second: " << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/hybrid_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    sweep<V0>("V0", outFile);
+    sweep<Hybrid>("Hybrid", outFile);
+
+    outFile.close();
+    return 0;
+}
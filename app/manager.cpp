@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/manager/range_lock.hpp"
+#include "../src/v0/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 8;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr uint64_t objectCount = 100000;
+constexpr double zipfTheta = 0.99;
+constexpr size_t samplesPerThread = 1 << 16;
+constexpr uint64_t objectKeys = 1 << 20;
+constexpr uint64_t maxWidth = 64;
+constexpr int runtimes = 3;
+
+using V0 = ConcurrentRangeLock<uint64_t, 8>;
+using Manager = RangeLockManager<8>;
+
+// A ConcurrentRangeLock for every object, created up front
+struct PerObject {
+    std::vector<std::unique_ptr<V0>> locks;
+
+    PerObject() {
+        locks.reserve(objectCount);
+        for (uint64_t i = 0; i < objectCount; ++i) {
+            locks.emplace_back(new V0());
+        }
+    }
+
+    bool tryLock(uint64_t object, uint64_t start, uint64_t end) {
+        return locks[object]->tryLock(start + 1, end + 1);
+    }
+
+    bool releaseLock(uint64_t object, uint64_t start, uint64_t end) {
+        return locks[object]->releaseLock(start + 1, end + 1);
+    }
+
+    size_t instances() const { return locks.size(); }
+};
+
+// A bucket per object keeps the chains short when most objects are live
+struct ManagedObjects {
+    Manager manager{objectCount};
+
+    bool tryLock(uint64_t object, uint64_t start, uint64_t end) {
+        return manager.tryLock(object, start, end);
+    }
+
+    bool releaseLock(uint64_t object, uint64_t start, uint64_t end) {
+        return manager.releaseLock(object, start, end);
+    }
+
+    size_t instances() { return manager.allocatedCount(); }
+};
+
+// Object IDs with Zipfian popularity, object 0 the most popular. Scattered
+// over the ID space, so that popular objects do not share hash buckets.
+std::vector<uint64_t> zipfianObjects(const std::vector<double> &cdf,
+                                     unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<uint64_t> objects(samplesPerThread);
+    for (auto &object : objects) {
+        auto rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) -
+                    cdf.begin();
+        object = std::min<uint64_t>(rank, objectCount - 1) * 7919 %
+                 objectCount;
+    }
+    return objects;
+}
+
+// Every thread locks and releases ranges of up to maxWidth keys in objects
+// drawn from its precomputed Zipfian sample, after an untimed pass over all
+// samples. Stores the number of lock
+// instances at the end in instances.
+template <typename Objects>
+double runWorkload(int numThreads, const std::vector<double> &cdf,
+                   size_t &instances) {
+    auto objects = std::make_unique<Objects>();
+    std::vector<std::vector<uint64_t>> samples;
+    for (int i = 0; i < numThreads; i++) {
+        samples.push_back(zipfianObjects(cdf, i));
+    }
+    // Untimed warm-up, so that the manager's objects are mostly created,
+    // like the ones created up front
+    for (auto &sample : samples) {
+        for (uint64_t object : sample) {
+            if (objects->tryLock(object, 0, 0)) {
+                objects->releaseLock(object, 0, 0);
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937_64 rng(i);
+            auto &mine = samples[i];
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t object = mine[ops % samplesPerThread];
+                uint64_t start = rng() % (objectKeys - maxWidth);
+                uint64_t end = start + rng() % maxWidth;
+                if (objects->tryLock(object, start, end)) {
+                    objects->releaseLock(object, start, end);
+                }
+                ++ops;
+            }
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    instances = objects->instances();
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+// Thread counts above the number of hardware threads are oversubscribed
+template <typename Objects>
+void sweep(const char *name, const std::vector<double> &cdf,
+           std::ofstream &outFile) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    std::cout << name << ":\n";
+    outFile << name << ":\n";
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        bool oversubscribed = static_cast<unsigned>(numThreads) > cores;
+        const char *note = oversubscribed ? " (oversubscribed)" : "";
+        std::cout << "Threads: " << numThreads << note << "\n";
+        outFile << "Threads: " << numThreads << note << "\n";
+
+        double total = 0;
+        size_t totalInstances = 0;
+        for (int i = 0; i < runtimes; i++) {
+            size_t instances;
+            total += runWorkload<Objects>(numThreads, cdf, instances);
+            totalInstances += instances;
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average operations per second: " << average << "\n";
+        outFile << "Average operations per second: " << average << "\n";
+        std::cout << "Average lock instances: " << totalInstances / runtimes
+                  << "\n";
+        outFile << "Average lock instances: " << totalInstances / runtimes
+                << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/manager_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    std::vector<double> cdf(objectCount);
+    double sum = 0;
+    for (uint64_t i = 0; i < objectCount; ++i) {
+        sum += 1 / std::pow(i + 1, zipfTheta);
+        cdf[i] = sum;
+    }
+    for (auto &p : cdf) {
+        p /= sum;
+    }
+
+    // The manager goes first, since the skip lists of the per-object locks
+    // are never freed and leave the heap fragmented
+    sweep<ManagedObjects>("Manager", cdf, outFile);
+    sweep<PerObject>("Lock per object", cdf, outFile);
+
+    outFile.close();
+    return 0;
+}
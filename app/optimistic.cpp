@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/v1/optimistic_range_lock.hpp"
+#include "../src/v1/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 64;
+constexpr int totalOps = 100000;
+constexpr int disjointRangesPerThread = 1000;
+constexpr int overlappingKeys = 4096;
+constexpr int overlappingWidth = 8;
+constexpr int runtimes = 3;
+
+// The total number of operations is fixed since v1 does not reclaim nodes.
+// Disjoint: every thread locks and releases ranges in its own key region.
+// Overlapping: all threads lock and release random ranges from a small
+// shared key space, failed tryLocks count as operations too.
+template <typename Lock>
+double runWorkload(int numThreads, bool overlapping) {
+    Lock crl{};
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937 rng(i);
+            std::uniform_int_distribution<int> dist(
+                0, overlappingKeys - overlappingWidth);
+            uint64_t base =
+                static_cast<uint64_t>(i) * disjointRangesPerThread * 10;
+
+            syncPoint.arrive_and_wait();
+
+            for (int j = 0; j < totalOps / numThreads; ++j) {
+                uint64_t start =
+                    overlapping ? dist(rng)
+                                : base + (j % disjointRangesPerThread) * 10;
+                uint64_t end = start + overlappingWidth;
+                if (crl.tryLock(start, end)) {
+                    crl.releaseLock(start, end);
+                }
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(totalOps / numThreads * numThreads) /
+           duration.count();
+}
+
+template <typename Lock>
+void sweep(const char *name, std::ofstream &outFile, bool overlapping) {
+    const char *workload = overlapping ? " overlapping:\n" : " disjoint:\n";
+    std::cout << name << workload;
+    outFile << name << workload;
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        std::cout << "Threads: " << numThreads << "\n";
+        outFile << "Threads: " << numThreads << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload<Lock>(numThreads, overlapping);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average operations per second: " << average << "\n";
+        outFile << "Average operations per second: " << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/optimistic_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    for (bool overlapping : {false, true}) {
+        sweep<ConcurrentRangeLock_V1<uint64_t, 6>>("V1 lock coupling",
+                                                   outFile, overlapping);
+        sweep<ConcurrentRangeLock_V1<uint64_t, 6, OptimisticMutex>>(
+            "V1 lock coupling (version lock)", outFile, overlapping);
+        sweep<OptimisticRangeLock_V1<uint64_t, 6>>("V1 optimistic", outFile,
+                                                   overlapping);
+    }
+
+    outFile.close();
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cassert>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/v0/range_lock.hpp"
+#include "../src/v1/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 17;
+constexpr int rangeStart = 1;
+constexpr int rangeEnd = 500000;
+constexpr int runtimes = 10;
+constexpr int step = 4;
+constexpr int queriesPerLock = 10;
+constexpr int queryWidth = 8;
+
+std::vector<std::pair<int, int>> createNonOverlappingRanges() {
+    std::vector<std::pair<int, int>> ranges;
+    for (int i = rangeStart; i < rangeEnd; i += 10) {
+        ranges.emplace_back(i, i + 5);
+    }
+    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+    std::shuffle(ranges.begin(), ranges.end(),
+                 std::default_random_engine(seed));
+    return ranges;
+}
+
+// Every thread locks its share of the ranges. For each range it locks, it
+// asks queriesPerLock times whether a random region is being written, and
+// then releases the range again. With probe set, a query is answered the
+// way it had to be before anyOverlap existed: by trying to lock the region
+// and releasing it again on success.
+template <typename Lock>
+double runOverlap(int numThreads,
+                  const std::vector<std::pair<int, int>> &ranges, bool probe) {
+    Lock crl{};
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<uint64_t> hits{0};
+
+    auto rangePerThread = ranges.size() / numThreads;
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937 rng(i);
+            std::uniform_int_distribution<int> dist(rangeStart, rangeEnd);
+            uint64_t localHits = 0;
+
+            syncPoint.arrive_and_wait();
+
+            auto startIdx = i * rangePerThread;
+            auto endIdx = (i == numThreads - 1) ? ranges.size()
+                                                : startIdx + rangePerThread;
+
+            for (auto j = startIdx; j < endIdx; ++j) {
+                crl.tryLock(ranges[j].first, ranges[j].second);
+                for (int q = 0; q < queriesPerLock; q++) {
+                    auto lo = dist(rng);
+                    if (!probe) {
+                        localHits += crl.anyOverlap(lo, lo + queryWidth);
+                    } else if (crl.tryLock(lo, lo + queryWidth)) {
+                        crl.releaseLock(lo, lo + queryWidth);
+                    } else {
+                        localHits++;
+                    }
+                }
+                crl.releaseLock(ranges[j].first, ranges[j].second);
+            }
+            hits.fetch_add(localHits);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    assert(crl.size() == 0);
+    return static_cast<double>(ranges.size() * (queriesPerLock + 2)) /
+           duration.count();
+}
+
+template <typename Lock>
+void sweep(const char *name, std::ofstream &outFile,
+           const std::vector<std::pair<int, int>> &ranges, bool probe) {
+    std::cout << name << (probe ? " (probe):\n" : " (anyOverlap):\n");
+    outFile << name << (probe ? " (probe):\n" : " (anyOverlap):\n");
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads += step) {
+        std::cout << "Threads: " << numThreads << "\n";
+        outFile << "Threads: " << numThreads << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runOverlap<Lock>(numThreads, ranges, probe);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average operations per second: " << average << "\n";
+        outFile << "Average operations per second: " << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/overlap_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    auto ranges = createNonOverlappingRanges();
+
+    sweep<ConcurrentRangeLock<uint64_t, 6>>("V0", outFile, ranges, false);
+    sweep<ConcurrentRangeLock<uint64_t, 6>>("V0", outFile, ranges, true);
+    sweep<ConcurrentRangeLock_V1<uint64_t, 6>>("V1", outFile, ranges, false);
+    sweep<ConcurrentRangeLock_V1<uint64_t, 6>>("V1", outFile, ranges, true);
+
+    outFile.close();
+    return 0;
+}
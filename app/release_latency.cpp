@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../src/v1/range_lock.hpp"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 16;
+constexpr int opsPerThread = 20000;
+constexpr int heldPerThread = 64;
+constexpr int runtimes = 3;
+
+enum class Mode { Eager, Cooperative, Maintenance };
+
+// Every thread keeps a sliding window of heldPerThread ranges in its own key
+// region: lock the next range, release the oldest one and time only the
+// release. Neighbouring threads touch the same predecessors at the region
+// borders, and inside a region the next tryLock runs over the node that was
+// just released. Cooperative leaves the unlink to those traversals,
+// Maintenance additionally runs a thread that sweeps marked nodes.
+std::vector<uint64_t> runWorkload(int numThreads, Mode mode) {
+    ConcurrentRangeLock_V1<uint64_t, 6> crl{mode != Mode::Eager};
+    std::vector<std::thread> threads;
+    std::vector<std::vector<uint64_t>> latencies(numThreads);
+    std::barrier syncPoint(numThreads);
+    std::atomic<bool> done{false};
+
+    std::thread maintenance;
+    if (mode == Mode::Maintenance) {
+        maintenance = std::thread([&]() {
+            while (!done.load(std::memory_order_relaxed)) {
+                if (crl.unlinkMarked() == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            auto &samples = latencies[i];
+            samples.reserve(opsPerThread);
+            uint64_t base = static_cast<uint64_t>(i) * heldPerThread * 10;
+            auto range = [&](int j) {
+                return base + (j % heldPerThread) * 10;
+            };
+
+            for (int j = 0; j < heldPerThread - 1; ++j) {
+                crl.tryLock(range(j), range(j) + 5);
+            }
+            syncPoint.arrive_and_wait();
+
+            for (int j = heldPerThread - 1; j < opsPerThread; ++j) {
+                crl.tryLock(range(j), range(j) + 5);
+
+                uint64_t start = range(j + 1);
+                auto begin = std::chrono::steady_clock::now();
+                crl.releaseLock(start, start + 5);
+                auto end = std::chrono::steady_clock::now();
+
+                samples.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        end - begin)
+                        .count());
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    done.store(true);
+    if (maintenance.joinable()) {
+        maintenance.join();
+    }
+
+    std::vector<uint64_t> all;
+    for (auto &samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    return all;
+}
+
+uint64_t percentile(const std::vector<uint64_t> &sorted, double p) {
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+void sweep(const char *name, Mode mode, std::ofstream &outFile) {
+    std::cout << name << ":\n";
+    outFile << name << ":\n";
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        std::cout << "Threads: " << numThreads << "\n";
+        outFile << "Threads: " << numThreads << "\n";
+
+        double p50 = 0, p99 = 0, p999 = 0;
+        for (int i = 0; i < runtimes; i++) {
+            auto sorted = runWorkload(numThreads, mode);
+            p50 += percentile(sorted, 0.50);
+            p99 += percentile(sorted, 0.99);
+            p999 += percentile(sorted, 0.999);
+        }
+
+        std::cout << "Average release latency p50/p99/p99.9 (ns): "
+                  << p50 / runtimes << " " << p99 / runtimes << " "
+                  << p999 / runtimes << "\n";
+        outFile << "Average release latency p50/p99/p99.9 (ns): "
+                << p50 / runtimes << " " << p99 / runtimes << " "
+                << p999 / runtimes << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/release_latency_benchmark.txt",
+                          std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    sweep("V1 eager unlink", Mode::Eager, outFile);
+    sweep("V1 deferred unlink, cooperative", Mode::Cooperative, outFile);
+    sweep("V1 deferred unlink, maintenance thread", Mode::Maintenance,
+          outFile);
+
+    outFile.close();
+    return 0;
+}
@@ -10,6 +10,9 @@
 
 #include "../src/v0/range_lock.hpp"
 #include "../src/v2/range_lock.cpp"
+#include "../src/v3/adaptive.hpp"
+#include "../src/v3/range_lock.hpp"
+#include "../src/v4/concurrent_tree.h"
 
 constexpr int minThreads = 1;
 constexpr int maxThreads = 17;
@@ -17,6 +20,17 @@ constexpr int rangeStart = 1;
 constexpr int rangeEnd = 500000;
 constexpr int runtimes = 10;
 constexpr int step = 4;
+constexpr int readHeavyOps = 200000;
+constexpr int readHeavyKeys = 10000;
+constexpr int readHeavyWidth = 16;
+constexpr int readPercent = 90;
+constexpr int readHeavyHeld = 8;
+constexpr int v3MaxThreads = 64;
+// v3 is a 4-level skip list, keep its list short enough to stay O(log n)
+constexpr size_t v3Ranges = 5000;
+// Enough lock and release rounds for the adaptive lock to fill a few
+// sampling windows per run
+constexpr int adaptiveRounds = 20;
 
 std::vector<std::pair<int, int>> createNonOverlappingRanges() {
     std::vector<std::pair<int, int>> ranges;
@@ -99,6 +113,259 @@ double runScalabilityV2(int numThreads,
     return static_cast<double>(list.size()) / duration.count();
 }
 
+// Every thread locks its share of the ranges and then releases them again,
+// timing each call. Returns operations per second and stores the 99th
+// percentile latency in nanoseconds in p99.
+double runScalabilityV3(int numThreads,
+                        const std::vector<std::pair<int, int>> &ranges,
+                        bool flatCombining, double &p99) {
+    SongRangeLock rl(flatCombining);
+    std::vector<std::thread> threads;
+    std::vector<std::vector<uint64_t>> latencies(numThreads);
+    std::barrier syncPoint(numThreads + 1);
+
+    auto rangePerThread = ranges.size() / numThreads;
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            auto startIdx = i * rangePerThread;
+            auto endIdx = (i == numThreads - 1) ? ranges.size()
+                                                : startIdx + rangePerThread;
+            auto &samples = latencies[i];
+            samples.reserve(2 * (endIdx - startIdx));
+
+            auto timed = [&samples](auto &&op) {
+                auto begin = std::chrono::steady_clock::now();
+                op();
+                auto end = std::chrono::steady_clock::now();
+                samples.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        end - begin)
+                        .count());
+            };
+
+            syncPoint.arrive_and_wait();
+
+            for (auto j = startIdx; j < endIdx; ++j) {
+                timed([&]() { rl.tryLock(ranges[j].first, ranges[j].second); });
+            }
+            for (auto j = startIdx; j < endIdx; ++j) {
+                timed([&]() { rl.releaseLock(ranges[j].first); });
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    std::vector<uint64_t> all;
+    for (auto &samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    p99 = static_cast<double>(all[all.size() * 99 / 100]);
+
+    assert(rl.size() == 0);
+    return static_cast<double>(all.size()) / duration.count();
+}
+
+void releaseRange(ConcurrentRangeLock<uint64_t, 6> &rl, int start, int end) {
+    rl.releaseLock(start, end);
+}
+
+void releaseRange(SongRangeLock<> &rl, int start, int) {
+    rl.releaseLock(start);
+}
+
+void releaseRange(AdaptiveRangeLock &rl, int start, int end) {
+    rl.releaseLock(start, end);
+}
+
+// Every thread locks its share of the ranges and releases them again,
+// adaptiveRounds times. Returns operations per second.
+template <typename Lock>
+double runLockRelease(Lock &rl, int numThreads,
+                      const std::vector<std::pair<int, int>> &ranges) {
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+
+    auto rangePerThread = ranges.size() / numThreads;
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            auto startIdx = i * rangePerThread;
+            auto endIdx = (i == numThreads - 1) ? ranges.size()
+                                                : startIdx + rangePerThread;
+
+            syncPoint.arrive_and_wait();
+
+            for (int round = 0; round < adaptiveRounds; ++round) {
+                for (auto j = startIdx; j < endIdx; ++j) {
+                    rl.tryLock(ranges[j].first, ranges[j].second);
+                }
+                for (auto j = startIdx; j < endIdx; ++j) {
+                    releaseRange(rl, ranges[j].first, ranges[j].second);
+                }
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    assert(rl.size() == 0);
+    return 2.0 * adaptiveRounds * ranges.size() / duration.count();
+}
+
+// Notes whether any range in the locked keyrange belongs to someone else
+struct TreeConflict {
+    bool found = false;
+
+    bool fn(const keyrange &, TXNID) {
+        found = true;
+        return false;
+    }
+};
+
+// Counts the ranges in the locked keyrange
+struct TreeCount {
+    size_t count = 0;
+
+    bool fn(const keyrange &, TXNID) {
+        ++count;
+        return true;
+    }
+};
+
+// Every thread locks its share of the ranges in the interval tree: prepare,
+// acquire the range, check it for overlaps and insert it. The tree is
+// emptied again after the timed part, so that it can be destroyed.
+double runScalabilityV4(int numThreads,
+                        const std::vector<std::pair<int, int>> &ranges) {
+    concurrent_tree tree;
+    tree.create();
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+
+    auto rangePerThread = ranges.size() / numThreads;
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            syncPoint.arrive_and_wait();
+
+            auto startIdx = i * rangePerThread;
+            auto endIdx = (i == numThreads - 1) ? ranges.size()
+                                                : startIdx + rangePerThread;
+
+            for (auto j = startIdx; j < endIdx; ++j) {
+                keyrange range;
+                range.create(ranges[j].first, ranges[j].second);
+
+                concurrent_tree::locked_keyrange lkr;
+                lkr.prepare(&tree);
+                lkr.acquire(range.m_left_key, range.m_right_key);
+                TreeConflict conflict;
+                lkr.iterate(&conflict);
+                if (!conflict.found) {
+                    lkr.insert(range, i + 1);
+                }
+                lkr.release();
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    concurrent_tree::locked_keyrange lkr;
+    lkr.prepare(&tree);
+    TreeCount held;
+    lkr.iterate(&held);
+    assert(held.count == ranges.size());
+    for (auto &range : ranges) {
+        keyrange kr;
+        kr.create(range.first, range.second);
+        lkr.remove(kr);
+    }
+    lkr.release();
+    tree.destroy();
+
+    return static_cast<double>(held.count) / duration.count();
+}
+
+// Threads lock random ranges from a small shared key space, readPercent of
+// them as readers, and keep the last readHeavyHeld granted ones held. The
+// exclusive list treats every request as a writer. Returns granted locks
+// per second, a failed try moves on to a new range.
+double runReadHeavyV2(int numThreads, bool readerWriter) {
+    ListRL list;
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<uint64_t> granted{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937 rng(i);
+            std::uniform_int_distribution<uint64_t> dist(
+                0, readHeavyKeys - readHeavyWidth);
+            std::vector<RangeLock *> held(readHeavyHeld, nullptr);
+            uint64_t localGranted = 0;
+
+            syncPoint.arrive_and_wait();
+
+            for (int j = 0; j < readHeavyOps / numThreads; ++j) {
+                uint64_t start = dist(rng);
+                bool reader =
+                    readerWriter && static_cast<int>(rng() % 100) < readPercent;
+                auto rl = RWRangeAcquire(&list, start, start + readHeavyWidth,
+                                         reader);
+                if (rl) {
+                    auto &slot = held[localGranted++ % readHeavyHeld];
+                    if (slot) {
+                        RWRangeRelease(&list, slot);
+                    }
+                    slot = rl;
+                }
+            }
+            for (auto rl : held) {
+                if (rl) {
+                    RWRangeRelease(&list, rl);
+                }
+            }
+            granted.fetch_add(localGranted);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(granted.load()) / duration.count();
+}
+
 int main() {
     std::ofstream outFile("data/scalability_benchmark.txt", std::ios_base::app);
     if (!outFile.is_open()) {
@@ -142,6 +409,120 @@ int main() {
         std::cout << "----------------------------------\n";
     }
 
+    std::cout << "V4:\n";
+    outFile << "V4:\n";
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads += step) {
+        std::cout << "Threads: " << numThreads << "\n";
+        outFile << "Threads: " << numThreads << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runScalabilityV4(numThreads, ranges);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average locks per second: " << average << "\n";
+        outFile << "Average locks per second: " << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+
+    std::vector<std::pair<int, int>> v3ranges(ranges.begin(),
+                                              ranges.begin() + v3Ranges);
+    for (bool flatCombining : {false, true}) {
+        const char *name =
+            flatCombining ? "V3 flat combining:\n" : "V3 mutex:\n";
+        std::cout << name;
+        outFile << name;
+        for (int numThreads = minThreads; numThreads <= v3MaxThreads;
+             numThreads *= 2) {
+            std::cout << "Threads: " << numThreads << "\n";
+            outFile << "Threads: " << numThreads << "\n";
+
+            double total = 0, totalP99 = 0;
+            for (int i = 0; i < runtimes; i++) {
+                double p99;
+                total +=
+                    runScalabilityV3(numThreads, v3ranges, flatCombining, p99);
+                totalP99 += p99;
+            }
+            double average = total / runtimes;
+
+            std::cout << "Average operations per second: " << average << "\n";
+            outFile << "Average operations per second: " << average << "\n";
+            std::cout << "Average p99 latency (ns): " << totalP99 / runtimes
+                      << "\n";
+            outFile << "Average p99 latency (ns): " << totalP99 / runtimes
+                    << "\n";
+            std::cout << "----------------------------------\n";
+        }
+    }
+
+    // The adaptive lock should follow whichever of V3 and V0 is faster
+    const char *lockReleaseNames[] = {"V0 lock and release:\n",
+                                      "V3 lock and release:\n",
+                                      "Adaptive lock and release:\n"};
+    for (int kind = 0; kind < 3; ++kind) {
+        const char *name = lockReleaseNames[kind];
+        std::cout << name;
+        outFile << name;
+        for (int numThreads = minThreads; numThreads <= v3MaxThreads;
+             numThreads *= 2) {
+            std::cout << "Threads: " << numThreads << "\n";
+            outFile << "Threads: " << numThreads << "\n";
+
+            double total = 0;
+            size_t migrations = 0;
+            for (int i = 0; i < runtimes; i++) {
+                if (kind == 0) {
+                    ConcurrentRangeLock<uint64_t, 6> rl{};
+                    total += runLockRelease(rl, numThreads, v3ranges);
+                } else if (kind == 1) {
+                    SongRangeLock rl;
+                    total += runLockRelease(rl, numThreads, v3ranges);
+                } else {
+                    AdaptiveRangeLock rl;
+                    total += runLockRelease(rl, numThreads, v3ranges);
+                    migrations += rl.migrations();
+                }
+            }
+            double average = total / runtimes;
+
+            std::cout << "Average operations per second: " << average << "\n";
+            outFile << "Average operations per second: " << average << "\n";
+            if (kind == 2) {
+                std::cout << "Average mode switches: "
+                          << static_cast<double>(migrations) / runtimes
+                          << "\n";
+                outFile << "Average mode switches: "
+                        << static_cast<double>(migrations) / runtimes << "\n";
+            }
+            std::cout << "----------------------------------\n";
+        }
+    }
+
+    for (bool readerWriter : {false, true}) {
+        const char *name = readerWriter ? "V2 read-heavy, reader-writer:\n"
+                                        : "V2 read-heavy, exclusive:\n";
+        std::cout << name;
+        outFile << name;
+        for (int numThreads = minThreads; numThreads <= maxThreads;
+             numThreads += step) {
+            std::cout << "Threads: " << numThreads << "\n";
+            outFile << "Threads: " << numThreads << "\n";
+
+            double total = 0;
+            for (int i = 0; i < runtimes; i++) {
+                total += runReadHeavyV2(numThreads, readerWriter);
+            }
+            double average = total / runtimes;
+
+            std::cout << "Average locks per second: " << average << "\n";
+            outFile << "Average locks per second: " << average << "\n";
+            std::cout << "----------------------------------\n";
+        }
+    }
+
     outFile.close();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/sharded/range_lock.hpp"
+#include "../src/v0/range_lock.hpp"
+
+constexpr int numThreads = 8;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr uint64_t keySpace = 1 << 20;
+constexpr uint64_t hotKeys = keySpace / 64;
+constexpr uint64_t maxWidth = 16;
+constexpr int runtimes = 3;
+
+using V0 = ShiftedBackend<ConcurrentRangeLock<uint64_t, 6>>;
+
+// Every thread locks and releases short ranges, either uniformly over the
+// whole key space or, skewed, with nine in ten of them in the first 1/64 of
+// it. Without rebalancing the skewed load lands in stripe 0 for any stripe
+// count up to 64.
+double runWorkload(size_t stripes, bool skewed, bool rebalance) {
+    ShardedRangeLock<V0> rl(stripes, keySpace, rebalance);
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937_64 rng(i);
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                bool hot = skewed && rng() % 10 != 0;
+                uint64_t start = rng() % (hot ? hotKeys : keySpace - maxWidth);
+                uint64_t end = start + 1 + rng() % maxWidth;
+                if (rl.tryLock(start, end)) {
+                    rl.releaseLock(start, end);
+                }
+                ++ops;
+            }
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+void sweep(bool skewed, bool rebalance, std::ofstream &outFile) {
+    const char *load = skewed ? "skewed" : "uniform";
+    const char *mode = rebalance ? "rebalancing" : "fixed stripes";
+    const char *note =
+        static_cast<unsigned>(numThreads) > std::thread::hardware_concurrency()
+            ? " (oversubscribed)"
+            : "";
+    std::cout << "V0, " << numThreads << " threads" << note << ", " << load
+              << ", " << mode << ":\n";
+    outFile << "V0, " << numThreads << " threads" << note << ", " << load
+            << ", " << mode << ":\n";
+    for (size_t stripes = 1; stripes <= 16; stripes *= 2) {
+        std::cout << "Stripes: " << stripes << "\n";
+        outFile << "Stripes: " << stripes << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload(stripes, skewed, rebalance);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average operations per second: " << average << "\n";
+        outFile << "Average operations per second: " << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/sharded_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    sweep(false, false, outFile);
+    sweep(false, true, outFile);
+    sweep(true, false, outFile);
+    sweep(true, true, outFile);
+
+    outFile.close();
+    return 0;
+}
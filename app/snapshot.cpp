@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/v0/range_lock.hpp"
+
+constexpr int lockerThreads = 8;
+constexpr int maxScanners = 4;
+constexpr int rangeStart = 1;
+constexpr int rangeEnd = 500000;
+constexpr int windowSize = 10000;
+constexpr int runtimes = 10;
+
+std::vector<std::pair<int, int>> createNonOverlappingRanges() {
+    std::vector<std::pair<int, int>> ranges;
+    for (int i = rangeStart; i < rangeEnd; i += 10) {
+        ranges.emplace_back(i, i + 5);
+    }
+    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+    std::shuffle(ranges.begin(), ranges.end(),
+                 std::default_random_engine(seed));
+    return ranges;
+}
+
+// Lockers lock every other range and keep it, then lock and release the
+// remaining ones, while scanners iterate random windows until they finish.
+// Returns lock operations per second of the lockers.
+double runWithScanners(int numScanners,
+                       const std::vector<std::pair<int, int>> &ranges,
+                       uint64_t &scanned) {
+    ConcurrentRangeLock<uint64_t, 6> crl{};
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(lockerThreads + numScanners + 1);
+    std::atomic<int> running{lockerThreads};
+    std::atomic<uint64_t> totalScanned{0};
+
+    auto rangePerThread = ranges.size() / lockerThreads;
+
+    threads.reserve(lockerThreads + numScanners);
+    for (int i = 0; i < lockerThreads; i++) {
+        threads.emplace_back([&, i]() {
+            syncPoint.arrive_and_wait();
+
+            auto startIdx = i * rangePerThread;
+            auto endIdx = (i == lockerThreads - 1) ? ranges.size()
+                                                   : startIdx + rangePerThread;
+
+            for (auto j = startIdx; j < endIdx; ++j) {
+                crl.tryLock(ranges[j].first, ranges[j].second);
+                if (j % 2) {
+                    crl.releaseLock(ranges[j].first, ranges[j].second);
+                }
+            }
+            running.fetch_sub(1);
+        });
+    }
+
+    for (int i = 0; i < numScanners; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937 rng(i);
+            std::uniform_int_distribution<int> dist(rangeStart,
+                                                    rangeEnd - windowSize);
+            uint64_t count = 0;
+
+            syncPoint.arrive_and_wait();
+            while (running.load(std::memory_order_relaxed) > 0) {
+                auto lo = dist(rng);
+                for (auto it = crl.snapshot(lo, lo + windowSize); it.valid();
+                     it.next()) {
+                    count++;
+                }
+            }
+            totalScanned.fetch_add(count);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    while (running.load() > 0) {
+        std::this_thread::yield();
+    }
+    auto end = std::chrono::steady_clock::now();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> duration = end - start;
+
+    scanned = totalScanned.load();
+    return static_cast<double>(ranges.size() + ranges.size() / 2) /
+           duration.count();
+}
+
+int main() {
+    std::ofstream outFile("data/snapshot_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    auto ranges = createNonOverlappingRanges();
+
+    std::cout << "V0 with snapshot scanners (" << lockerThreads
+              << " lockers):\n";
+    for (int numScanners = 0; numScanners <= maxScanners; numScanners++) {
+        std::cout << "Scanners: " << numScanners << "\n";
+        outFile << "Scanners: " << numScanners << "\n";
+
+        double total = 0;
+        uint64_t totalScanned = 0;
+        for (int i = 0; i < runtimes; i++) {
+            uint64_t scanned = 0;
+            total += runWithScanners(numScanners, ranges, scanned);
+            totalScanned += scanned;
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average lock operations per second: " << average << "\n";
+        std::cout << "Average ranges scanned per run: "
+                  << totalScanned / runtimes << "\n";
+        outFile << "Average lock operations per second: " << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+
+    outFile.close();
+    return 0;
+}
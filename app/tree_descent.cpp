@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/v4/concurrent_tree.h"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 64;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr uint64_t heldRanges = 100000;
+constexpr int runtimes = 3;
+
+// Notes whether the locked keyrange holds any range
+struct AnyRange {
+    bool found = false;
+
+    bool fn(const keyrange &, TXNID) {
+        found = true;
+        return false;
+    }
+};
+
+void acquire(concurrent_tree::locked_keyrange &lkr, concurrent_tree *tree,
+             const keyrange &range, bool optimistic) {
+    if (optimistic) {
+        lkr.acquire_optimistic(tree, range.m_left_key, range.m_right_key);
+    } else {
+        lkr.prepare(tree);
+        lkr.acquire(range.m_left_key, range.m_right_key);
+    }
+}
+
+// heldRanges ranges [10i, 10i + 5) are inserted in random order, so that
+// the tree is reasonably balanced. The key space is then split into one
+// region per thread, and every thread locks and releases random ranges in
+// the gaps of its own region: an acquire, an overlap check and an insert,
+// then an acquire and a remove. Runs are time-bounded.
+double runWorkload(int numThreads, bool optimistic) {
+    concurrent_tree tree;
+    tree.create();
+
+    std::vector<uint64_t> order(heldRanges);
+    for (uint64_t i = 0; i < heldRanges; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    for (uint64_t i : order) {
+        keyrange range;
+        range.create(i * 10, i * 10 + 5);
+        concurrent_tree::locked_keyrange lkr;
+        acquire(lkr, &tree, range, false);
+        lkr.insert(range, 1);
+        lkr.release();
+    }
+
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            const uint64_t regionSize = heldRanges / numThreads;
+            std::mt19937 rng(i);
+            std::uniform_int_distribution<uint64_t> dist(
+                i * regionSize, (i + 1) * regionSize - 1);
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                keyrange range;
+                uint64_t gap = dist(rng) * 10 + 6;
+                range.create(gap, gap + 2);
+
+                concurrent_tree::locked_keyrange lkr;
+                acquire(lkr, &tree, range, optimistic);
+                AnyRange conflict;
+                lkr.iterate(&conflict);
+                if (!conflict.found) {
+                    lkr.insert(range, i + 2);
+                }
+                lkr.release();
+
+                acquire(lkr, &tree, range, optimistic);
+                lkr.remove(range);
+                lkr.release();
+                ops++;
+            }
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    for (uint64_t i : order) {
+        keyrange range;
+        range.create(i * 10, i * 10 + 5);
+        concurrent_tree::locked_keyrange lkr;
+        acquire(lkr, &tree, range, false);
+        lkr.remove(range);
+        lkr.release();
+    }
+    tree.destroy();
+
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+// Thread counts above the number of hardware threads are oversubscribed
+void sweep(bool optimistic, std::ofstream &outFile) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    const char *name = optimistic ? "V4 optimistic descent:\n"
+                                  : "V4 prepare and acquire:\n";
+    std::cout << name;
+    outFile << name;
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        bool oversubscribed = static_cast<unsigned>(numThreads) > cores;
+        const char *note = oversubscribed ? " (oversubscribed)" : "";
+        std::cout << "Threads: " << numThreads << note << "\n";
+        outFile << "Threads: " << numThreads << note << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload(numThreads, optimistic);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average ranges locked and released per second: "
+                  << average << "\n";
+        outFile << "Average ranges locked and released per second: "
+                << average << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/tree_descent_benchmark.txt",
+                          std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    sweep(false, outFile);
+    sweep(true, outFile);
+
+    outFile.close();
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/v4/concurrent_tree.h"
+
+constexpr int minThreads = 1;
+constexpr int maxThreads = 64;
+constexpr auto runDuration = std::chrono::milliseconds(200);
+constexpr uint64_t rangesPerRound = 1000;
+constexpr int runtimes = 3;
+
+// Every thread fills a tree of its own with rangesPerRound ranges in random
+// order and empties it again, over and over. The trees are private, so the
+// only thing the threads share is the allocator. Runs are time-bounded.
+double runWorkload(int numThreads) {
+    std::vector<std::thread> threads;
+    std::barrier syncPoint(numThreads + 1);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> totalOps{0};
+
+    threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back([&, i]() {
+            concurrent_tree tree;
+            tree.create();
+            std::vector<keyrange> ranges(rangesPerRound);
+            for (uint64_t j = 0; j < rangesPerRound; ++j) {
+                ranges[j].create(j * 10, j * 10 + 5);
+            }
+            std::shuffle(ranges.begin(), ranges.end(), std::mt19937(i));
+
+            syncPoint.arrive_and_wait();
+
+            uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (auto &range : ranges) {
+                    concurrent_tree::locked_keyrange lkr;
+                    lkr.prepare(&tree);
+                    lkr.acquire(range.m_left_key, range.m_right_key);
+                    lkr.insert(range, i + 1);
+                    lkr.release();
+                }
+                for (auto &range : ranges) {
+                    concurrent_tree::locked_keyrange lkr;
+                    lkr.prepare(&tree);
+                    lkr.acquire(range.m_left_key, range.m_right_key);
+                    lkr.remove(range);
+                    lkr.release();
+                }
+                ops += rangesPerRound;
+            }
+            tree.destroy();
+            totalOps.fetch_add(ops);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    syncPoint.arrive_and_wait();
+    std::this_thread::sleep_for(runDuration);
+    stop.store(true);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    return static_cast<double>(totalOps.load()) / duration.count();
+}
+
+// Thread counts above the number of hardware threads are oversubscribed
+void sweep(bool pooling, std::ofstream &outFile) {
+    treenode::set_pooling(pooling);
+    const unsigned cores = std::thread::hardware_concurrency();
+    const char *name = pooling ? "V4 treenode pool:\n" : "V4 new and delete:\n";
+    std::cout << name;
+    outFile << name;
+    std::cout << "Bytes per insertion: "
+              << concurrent_tree::get_insertion_memory_overhead() << "\n";
+    outFile << "Bytes per insertion: "
+            << concurrent_tree::get_insertion_memory_overhead() << "\n";
+    for (int numThreads = minThreads; numThreads <= maxThreads;
+         numThreads *= 2) {
+        bool oversubscribed = static_cast<unsigned>(numThreads) > cores;
+        const char *note = oversubscribed ? " (oversubscribed)" : "";
+        std::cout << "Threads: " << numThreads << note << "\n";
+        outFile << "Threads: " << numThreads << note << "\n";
+
+        double total = 0;
+        for (int i = 0; i < runtimes; i++) {
+            total += runWorkload(numThreads);
+        }
+        double average = total / runtimes;
+
+        std::cout << "Average inserts and removes per second: " << average
+                  << "\n";
+        outFile << "Average inserts and removes per second: " << average
+                << "\n";
+        std::cout << "----------------------------------\n";
+    }
+}
+
+int main() {
+    std::ofstream outFile("data/tree_pool_benchmark.txt", std::ios_base::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Failed to open the file!" << std::endl;
+        return 1;
+    }
+
+    sweep(false, outFile);
+    sweep(true, outFile);
+
+    outFile.close();
+    return 0;
+}
@@ -15,7 +15,18 @@ int main() {
     tree->create();
 
     lkr.prepare(tree);
-    lkr.acquire(range);
+    lkr.acquire(range.m_left_key, range.m_right_key);
+    lkr.insert(range, 1);
+    lkr.release();
+
+    lkr.prepare(tree);
+    lkr.acquire(range.m_left_key, range.m_right_key);
+    lkr.remove(range);
+    lkr.release();
+
+    assert(tree->is_empty());
+    tree->destroy();
+    delete tree;
 }
 
 // int main() {
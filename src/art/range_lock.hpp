@@ -0,0 +1,1102 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+Range lock that indexes held ranges by start key in an adaptive radix tree
+(Leis et al., ICDE 2013) with optimistic lock coupling (Leis et al., DaMoN
+2016). A key is looked up in at most eight nodes, one per key byte, and path
+compression skips the bytes that all keys below a node share, so a lookup
+costs a few dependent cache misses where the skip list costs O(log n).
+
+Ranges are closed, [start, end], and end must be below the largest uint64_t.
+A range may be locked if the held range with the greatest start below start
+ends before it and the held range with the smallest start at or after start
+begins after end.
+
+Every node has a version word. Readers do not write to shared memory: they
+remember the version of every node they look at, and an operation restarts
+if one of them changed before it was done. tryLock looks up the nodes where
+start goes, its predecessor and its successor, takes the latches of the one
+or two nodes it has to modify by upgrading their remembered versions and
+then checks that no other node it looked at has changed. A concurrent
+insertion between the predecessor and the successor always modifies a node
+on one of the three paths, so two overlapping ranges can never both
+succeed.
+
+releaseLock removes the range from its leaf. A leaf left empty is unlinked
+from its parent, and an inner node left with one child is replaced by that
+child in its grandparent, under the latches of all the nodes involved, so
+that the tree only holds the paths of held ranges. Nodes are not shrunk.
+
+Unlinked nodes and nodes replaced by a larger one are retired, since
+optimistic readers may still be looking at them. Every operation announces
+the epoch it started in, in a slot of its own, and a retired node is freed
+once no operation that started before it was retired is still running.
+*/
+class ArtRangeLock {
+public:
+    ArtRangeLock();
+
+    ~ArtRangeLock();
+
+    ArtRangeLock(const ArtRangeLock &) = delete;
+
+    ArtRangeLock &operator=(const ArtRangeLock &) = delete;
+
+    bool tryLock(uint64_t start, uint64_t end);
+
+    bool releaseLock(uint64_t start, uint64_t end);
+
+    size_t size();
+
+    // Number of nodes a lookup of key passes through
+    size_t depth(uint64_t key);
+
+    // Number of nodes in the tree, while no other operation runs
+    size_t nodeCount();
+
+    // Number of nodes retired and not freed yet
+    size_t retiredCount();
+
+private:
+    enum NodeType : uint8_t { N4, N16, N48, N256 };
+
+    static constexpr uint64_t lockedBit = 0b10;
+    static constexpr uint64_t obsoleteBit = 0b01;
+    // Nodes at this level tell apart the last key byte, and their child
+    // slots hold end + 1 of the ranges instead of node pointers
+    static constexpr unsigned leafLevel = 7;
+    static constexpr size_t epochSlots = 64;
+    // Retired nodes are freed in batches of this many
+    static constexpr size_t reclaimBatch = 256;
+
+    /*
+    level is the index of the key byte a node tells its children apart by,
+    counted from the most significant byte. All keys below a node share the
+    bytes before level with prefix. Both never change, a node that has to
+    tell apart keys at an earlier byte is put above it instead.
+    */
+    struct Node {
+        Node(NodeType type, unsigned level, uint64_t prefix)
+                : type{type}, level{level}, prefix{prefix} {}
+
+        std::atomic<uint64_t> version{0};
+        const NodeType type;
+        const unsigned level;
+        const uint64_t prefix;
+        std::atomic<unsigned> count{0};
+    };
+
+    // Node4 and Node16 keep their key bytes sorted
+    template<unsigned capacity, NodeType kind>
+    struct SortedNode : Node {
+        SortedNode(unsigned level, uint64_t prefix)
+                : Node(kind, level, prefix) {}
+
+        std::atomic<uint8_t> keys[capacity]{};
+        std::atomic<uint64_t> children[capacity]{};
+    };
+
+    using Node4 = SortedNode<4, N4>;
+    using Node16 = SortedNode<16, N16>;
+
+    struct Node48 : Node {
+        Node48(unsigned level, uint64_t prefix) : Node(N48, level, prefix) {}
+
+        // Slot of the child plus one, 0 if there is none
+        std::atomic<uint8_t> index[256]{};
+        std::atomic<uint64_t> children[48]{};
+    };
+
+    struct Node256 : Node {
+        Node256(unsigned level, uint64_t prefix) : Node(N256, level, prefix) {}
+
+        std::atomic<uint64_t> children[256]{};
+    };
+
+    using ReadSet = std::vector<std::pair<Node *, uint64_t>>;
+
+    // Where tryLock attaches start, found by lookUp
+    struct InsertPoint {
+        enum Kind { intoNode, splitPrefix } kind;
+        Node *node;
+        uint64_t nodeVersion;
+        Node *parent;
+        uint64_t parentVersion;
+        uint8_t parentByte;
+        bool exists;
+    };
+
+    enum class Seek { found, missing, restart };
+
+    // The epoch an operation of its thread started in, 0 while none runs
+    struct alignas(64) EpochSlot {
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    Node256 *root;
+    std::atomic<size_t> elementsCount{0};
+    std::unique_ptr<EpochSlot[]> slots;
+    std::atomic<uint64_t> globalEpoch{1};
+    std::mutex retiredMutex;
+    // Retired nodes with the epoch they were retired in
+    std::vector<std::pair<Node *, uint64_t>> retired;
+
+    static uint8_t keyByte(uint64_t key, unsigned level);
+
+    static int comparePrefix(const Node *node, uint64_t key);
+
+    static Node *toNode(uint64_t child);
+
+    static uint64_t fromNode(Node *node);
+
+    static bool readLock(Node *node, uint64_t &version);
+
+    static bool validate(const Node *node, uint64_t version);
+
+    static bool upgrade(Node *node, uint64_t version);
+
+    static void unlock(Node *node);
+
+    static void unlockObsolete(Node *node);
+
+    static unsigned sortedCount(const Node *node);
+
+    static std::atomic<uint8_t> *sortedKeys(const Node *node);
+
+    static std::atomic<uint64_t> *sortedChildren(const Node *node);
+
+    static uint64_t getChild(const Node *node, uint8_t byte);
+
+    static bool lowerChild(const Node *node, int bound, uint8_t &byte,
+                           uint64_t &child);
+
+    static bool upperChild(const Node *node, int bound, uint8_t &byte,
+                           uint64_t &child);
+
+    static bool isFull(const Node *node);
+
+    static void insertChild(Node *node, uint8_t byte, uint64_t child);
+
+    static void removeChild(Node *node, uint8_t byte);
+
+    static void replaceChild(Node *node, uint8_t byte, uint64_t child);
+
+    static Node *grow(const Node *node);
+
+    static Node *newLeaf(uint64_t start, uint64_t end);
+
+    static void deleteNode(Node *node);
+
+    static void deleteTree(Node *node);
+
+    static size_t countTree(const Node *node);
+
+    // Announces an operation and returns its slot
+    size_t enter();
+
+    void exit(size_t slot);
+
+    // The node is unlinked and unlatched
+    void retire(Node *node);
+
+    void reclaimLocked();
+
+    bool lookUp(uint64_t key, InsertPoint &point, ReadSet &reads);
+
+    Seek seekBelow(Node *node, uint64_t key, bool bounded, uint64_t &start,
+                   uint64_t &end, ReadSet &reads);
+
+    Seek seekAbove(Node *node, uint64_t key, bool bounded, uint64_t &start,
+                   ReadSet &reads);
+
+    bool attach(const InsertPoint &point, uint64_t start, uint64_t end,
+                const ReadSet &reads);
+
+    bool insertRange(uint64_t start, uint64_t end);
+
+    bool removeRange(uint64_t start, uint64_t end);
+
+    // Unlinks the latched leaf and, if its parent is left with one child,
+    // the parent. Fails if one of them changed since it was read.
+    bool detach(const ReadSet &reads, uint64_t start);
+};
+
+inline ArtRangeLock::ArtRangeLock()
+        : root{new Node256(0, 0)}, slots{new EpochSlot[epochSlots]} {}
+
+inline ArtRangeLock::~ArtRangeLock() {
+    deleteTree(root);
+    for (auto &node : retired) {
+        deleteNode(node.first);
+    }
+}
+
+inline size_t ArtRangeLock::size() {
+    return elementsCount.load();
+}
+
+inline uint8_t ArtRangeLock::keyByte(uint64_t key, unsigned level) {
+    return (key >> (8 * (7 - level))) & 0xFF;
+}
+
+// Compares the bytes of key before the level of node with its prefix
+inline int ArtRangeLock::comparePrefix(const Node *node, uint64_t key) {
+    if (node->level == 0) {
+        return 0;
+    }
+    unsigned shift = 8 * (8 - node->level);
+    uint64_t nodeBytes = node->prefix >> shift;
+    uint64_t keyBytes = key >> shift;
+    return nodeBytes < keyBytes ? -1 : nodeBytes > keyBytes ? 1 : 0;
+}
+
+inline ArtRangeLock::Node *ArtRangeLock::toNode(uint64_t child) {
+    return reinterpret_cast<Node *>(static_cast<uintptr_t>(child));
+}
+
+inline uint64_t ArtRangeLock::fromNode(Node *node) {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(node));
+}
+
+// Waits for a writer to finish, fails if the node has been replaced
+inline bool ArtRangeLock::readLock(Node *node, uint64_t &version) {
+    version = node->version.load(std::memory_order_acquire);
+    while (version & lockedBit) {
+        std::this_thread::yield();
+        version = node->version.load(std::memory_order_acquire);
+    }
+    return !(version & obsoleteBit);
+}
+
+inline bool ArtRangeLock::validate(const Node *node, uint64_t version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return node->version.load(std::memory_order_relaxed) == version;
+}
+
+// Takes the latch if nothing changed since the node was read at version
+inline bool ArtRangeLock::upgrade(Node *node, uint64_t version) {
+    if (!node->version.compare_exchange_strong(version, version + lockedBit,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+}
+
+inline void ArtRangeLock::unlock(Node *node) {
+    node->version.fetch_add(lockedBit, std::memory_order_release);
+}
+
+inline void ArtRangeLock::unlockObsolete(Node *node) {
+    node->version.fetch_add(lockedBit | obsoleteBit,
+                            std::memory_order_release);
+}
+
+// Number of children of a Node4 or Node16, which a racing read may see
+// ahead of its arrays
+inline unsigned ArtRangeLock::sortedCount(const Node *node) {
+    unsigned n = node->count.load(std::memory_order_relaxed);
+    return std::min(n, node->type == N4 ? 4u : 16u);
+}
+
+inline std::atomic<uint8_t> *ArtRangeLock::sortedKeys(const Node *node) {
+    if (node->type == N4) {
+        return static_cast<Node4 *>(const_cast<Node *>(node))->keys;
+    }
+    return static_cast<Node16 *>(const_cast<Node *>(node))->keys;
+}
+
+inline std::atomic<uint64_t> *ArtRangeLock::sortedChildren(const Node *node) {
+    if (node->type == N4) {
+        return static_cast<Node4 *>(const_cast<Node *>(node))->children;
+    }
+    return static_cast<Node16 *>(const_cast<Node *>(node))->children;
+}
+
+inline uint64_t ArtRangeLock::getChild(const Node *node, uint8_t byte) {
+    switch (node->type) {
+        case N4:
+        case N16: {
+            auto *keys = sortedKeys(node);
+            auto *children = sortedChildren(node);
+            unsigned n = sortedCount(node);
+            for (unsigned i = 0; i < n; ++i) {
+                if (keys[i].load(std::memory_order_relaxed) == byte) {
+                    return children[i].load(std::memory_order_relaxed);
+                }
+            }
+            return 0;
+        }
+        case N48: {
+            auto *n48 = static_cast<const Node48 *>(node);
+            uint8_t slot = n48->index[byte].load(std::memory_order_relaxed);
+            return slot == 0 ? 0 : n48->children[(slot - 1) % 48].load(
+                    std::memory_order_relaxed);
+        }
+        case N256:
+            return static_cast<const Node256 *>(node)->children[byte].load(
+                    std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+// Child with the greatest key byte not above bound
+inline bool ArtRangeLock::lowerChild(const Node *node, int bound,
+                                     uint8_t &byte, uint64_t &child) {
+    switch (node->type) {
+        case N4:
+        case N16: {
+            auto *keys = sortedKeys(node);
+            auto *children = sortedChildren(node);
+            unsigned n = sortedCount(node);
+            for (unsigned i = n; i-- > 0;) {
+                uint8_t key = keys[i].load(std::memory_order_relaxed);
+                if (key > bound) {
+                    continue;
+                }
+                child = children[i].load(std::memory_order_relaxed);
+                if (child != 0) {
+                    byte = key;
+                    return true;
+                }
+            }
+            return false;
+        }
+        case N48: {
+            auto *n48 = static_cast<const Node48 *>(node);
+            for (int b = bound; b >= 0; --b) {
+                uint8_t slot = n48->index[b].load(std::memory_order_relaxed);
+                if (slot == 0) {
+                    continue;
+                }
+                child = n48->children[(slot - 1) % 48].load(
+                        std::memory_order_relaxed);
+                if (child != 0) {
+                    byte = b;
+                    return true;
+                }
+            }
+            return false;
+        }
+        case N256: {
+            auto *n256 = static_cast<const Node256 *>(node);
+            for (int b = bound; b >= 0; --b) {
+                child = n256->children[b].load(std::memory_order_relaxed);
+                if (child != 0) {
+                    byte = b;
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+// Child with the smallest key byte not below bound
+inline bool ArtRangeLock::upperChild(const Node *node, int bound,
+                                     uint8_t &byte, uint64_t &child) {
+    switch (node->type) {
+        case N4:
+        case N16: {
+            auto *keys = sortedKeys(node);
+            auto *children = sortedChildren(node);
+            unsigned n = sortedCount(node);
+            for (unsigned i = 0; i < n; ++i) {
+                uint8_t key = keys[i].load(std::memory_order_relaxed);
+                if (key < bound) {
+                    continue;
+                }
+                child = children[i].load(std::memory_order_relaxed);
+                if (child != 0) {
+                    byte = key;
+                    return true;
+                }
+            }
+            return false;
+        }
+        case N48: {
+            auto *n48 = static_cast<const Node48 *>(node);
+            for (int b = bound; b < 256; ++b) {
+                uint8_t slot = n48->index[b].load(std::memory_order_relaxed);
+                if (slot == 0) {
+                    continue;
+                }
+                child = n48->children[(slot - 1) % 48].load(
+                        std::memory_order_relaxed);
+                if (child != 0) {
+                    byte = b;
+                    return true;
+                }
+            }
+            return false;
+        }
+        case N256: {
+            auto *n256 = static_cast<const Node256 *>(node);
+            for (int b = bound; b < 256; ++b) {
+                child = n256->children[b].load(std::memory_order_relaxed);
+                if (child != 0) {
+                    byte = b;
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+inline bool ArtRangeLock::isFull(const Node *node) {
+    unsigned n = node->count.load(std::memory_order_relaxed);
+    switch (node->type) {
+        case N4:
+            return n == 4;
+        case N16:
+            return n == 16;
+        case N48:
+            return n == 48;
+        case N256:
+            return false;
+    }
+    return false;
+}
+
+// The node is latched and not full
+inline void ArtRangeLock::insertChild(Node *node, uint8_t byte,
+                                      uint64_t child) {
+    unsigned n = node->count.load(std::memory_order_relaxed);
+    switch (node->type) {
+        case N4:
+        case N16: {
+            auto *keys = sortedKeys(node);
+            auto *children = sortedChildren(node);
+            unsigned pos = 0;
+            while (pos < n &&
+                   keys[pos].load(std::memory_order_relaxed) < byte) {
+                ++pos;
+            }
+            for (unsigned i = n; i > pos; --i) {
+                keys[i].store(
+                        keys[i - 1].load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+                children[i].store(
+                        children[i - 1].load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+            }
+            keys[pos].store(byte, std::memory_order_relaxed);
+            children[pos].store(child, std::memory_order_relaxed);
+            break;
+        }
+        case N48: {
+            auto *n48 = static_cast<Node48 *>(node);
+            unsigned slot = 0;
+            while (n48->children[slot].load(std::memory_order_relaxed) != 0) {
+                ++slot;
+            }
+            n48->children[slot].store(child, std::memory_order_relaxed);
+            n48->index[byte].store(slot + 1, std::memory_order_relaxed);
+            break;
+        }
+        case N256:
+            static_cast<Node256 *>(node)->children[byte].store(
+                    child, std::memory_order_relaxed);
+            break;
+    }
+    node->count.store(n + 1, std::memory_order_relaxed);
+}
+
+// The node is latched and has a child at byte
+inline void ArtRangeLock::removeChild(Node *node, uint8_t byte) {
+    unsigned n = node->count.load(std::memory_order_relaxed);
+    switch (node->type) {
+        case N4:
+        case N16: {
+            auto *keys = sortedKeys(node);
+            auto *children = sortedChildren(node);
+            unsigned pos = 0;
+            while (keys[pos].load(std::memory_order_relaxed) != byte) {
+                ++pos;
+            }
+            for (unsigned i = pos; i + 1 < n; ++i) {
+                keys[i].store(
+                        keys[i + 1].load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+                children[i].store(
+                        children[i + 1].load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+            }
+            children[n - 1].store(0, std::memory_order_relaxed);
+            break;
+        }
+        case N48: {
+            auto *n48 = static_cast<Node48 *>(node);
+            uint8_t slot = n48->index[byte].load(std::memory_order_relaxed);
+            n48->index[byte].store(0, std::memory_order_relaxed);
+            n48->children[slot - 1].store(0, std::memory_order_relaxed);
+            break;
+        }
+        case N256:
+            static_cast<Node256 *>(node)->children[byte].store(
+                    0, std::memory_order_relaxed);
+            break;
+    }
+    node->count.store(n - 1, std::memory_order_relaxed);
+}
+
+// The node is latched and has a child at byte
+inline void ArtRangeLock::replaceChild(Node *node, uint8_t byte,
+                                       uint64_t child) {
+    switch (node->type) {
+        case N4:
+        case N16: {
+            auto *keys = sortedKeys(node);
+            auto *children = sortedChildren(node);
+            unsigned pos = 0;
+            while (keys[pos].load(std::memory_order_relaxed) != byte) {
+                ++pos;
+            }
+            children[pos].store(child, std::memory_order_relaxed);
+            break;
+        }
+        case N48: {
+            auto *n48 = static_cast<Node48 *>(node);
+            uint8_t slot = n48->index[byte].load(std::memory_order_relaxed);
+            n48->children[slot - 1].store(child, std::memory_order_relaxed);
+            break;
+        }
+        case N256:
+            static_cast<Node256 *>(node)->children[byte].store(
+                    child, std::memory_order_relaxed);
+            break;
+    }
+}
+
+// Copy of a full node with room for more children
+inline ArtRangeLock::Node *ArtRangeLock::grow(const Node *node) {
+    Node *bigger;
+    switch (node->type) {
+        case N4:
+            bigger = new Node16(node->level, node->prefix);
+            break;
+        case N16:
+            bigger = new Node48(node->level, node->prefix);
+            break;
+        default:
+            bigger = new Node256(node->level, node->prefix);
+            break;
+    }
+    uint8_t byte;
+    uint64_t child;
+    for (int b = 0; b < 256 && upperChild(node, b, byte, child); b = byte + 1) {
+        insertChild(bigger, byte, child);
+    }
+    return bigger;
+}
+
+inline ArtRangeLock::Node *ArtRangeLock::newLeaf(uint64_t start,
+                                                 uint64_t end) {
+    Node *leaf = new Node4(leafLevel, start);
+    insertChild(leaf, keyByte(start, leafLevel), end + 1);
+    return leaf;
+}
+
+inline void ArtRangeLock::deleteNode(Node *node) {
+    switch (node->type) {
+        case N4:
+            delete static_cast<Node4 *>(node);
+            break;
+        case N16:
+            delete static_cast<Node16 *>(node);
+            break;
+        case N48:
+            delete static_cast<Node48 *>(node);
+            break;
+        case N256:
+            delete static_cast<Node256 *>(node);
+            break;
+    }
+}
+
+inline void ArtRangeLock::deleteTree(Node *node) {
+    if (node->level != leafLevel) {
+        uint8_t byte;
+        uint64_t child;
+        for (int b = 0; b < 256 && upperChild(node, b, byte, child);
+             b = byte + 1) {
+            deleteTree(toNode(child));
+        }
+    }
+    deleteNode(node);
+}
+
+inline size_t ArtRangeLock::countTree(const Node *node) {
+    size_t count = 1;
+    if (node->level != leafLevel) {
+        uint8_t byte;
+        uint64_t child;
+        for (int b = 0; b < 256 && upperChild(node, b, byte, child);
+             b = byte + 1) {
+            count += countTree(toNode(child));
+        }
+    }
+    return count;
+}
+
+// Threads share a slot only while more than epochSlots operations run. The
+// fence pairs with the one in reclaimLocked: either the reclaim sees the
+// slot taken, or the operation does not see the nodes it frees.
+inline size_t ArtRangeLock::enter() {
+    static std::atomic<size_t> nextSlot{0};
+    thread_local size_t preferred = nextSlot.fetch_add(1);
+    for (size_t i = preferred % epochSlots;; i = (i + 1) % epochSlots) {
+        uint64_t idle = 0;
+        if (slots[i].epoch.load(std::memory_order_relaxed) == 0 &&
+            slots[i].epoch.compare_exchange_strong(
+                    idle, globalEpoch.load(std::memory_order_acquire),
+                    std::memory_order_relaxed)) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return i;
+        }
+    }
+}
+
+inline void ArtRangeLock::exit(size_t slot) {
+    slots[slot].epoch.store(0, std::memory_order_release);
+}
+
+inline void ArtRangeLock::retire(Node *node) {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    retired.emplace_back(node, globalEpoch.load(std::memory_order_relaxed));
+    if (retired.size() >= reclaimBatch) {
+        reclaimLocked();
+    }
+}
+
+// Operations that announced an epoch after a node was retired started
+// after it was unlinked, so only older announcements keep it
+inline void ArtRangeLock::reclaimLocked() {
+    globalEpoch.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < epochSlots; ++i) {
+        uint64_t epoch = slots[i].epoch.load(std::memory_order_relaxed);
+        if (epoch != 0) {
+            oldest = std::min(oldest, epoch);
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    size_t kept = 0;
+    for (auto &node : retired) {
+        if (node.second < oldest) {
+            deleteNode(node.first);
+        } else {
+            retired[kept++] = node;
+        }
+    }
+    retired.resize(kept);
+}
+
+/*
+Finds the node that start has to go into, or the node whose prefix start
+does not share and that needs a new node above it. Fails if it ran into a
+node that has been replaced.
+*/
+inline bool ArtRangeLock::lookUp(uint64_t key, InsertPoint &point,
+                                 ReadSet &reads) {
+    Node *parent = nullptr;
+    uint64_t parentVersion = 0;
+    uint8_t parentByte = 0;
+    Node *node = root;
+    while (true) {
+        uint64_t version;
+        if (!readLock(node, version)) {
+            return false;
+        }
+        reads.emplace_back(node, version);
+        point = {InsertPoint::intoNode, node, version, parent, parentVersion,
+                 parentByte, false};
+
+        if (comparePrefix(node, key) != 0) {
+            point.kind = InsertPoint::splitPrefix;
+            return true;
+        }
+        uint8_t byte = keyByte(key, node->level);
+        uint64_t child = getChild(node, byte);
+        if (node->level == leafLevel || child == 0) {
+            point.exists = child != 0;
+            return true;
+        }
+
+        parent = node;
+        parentVersion = version;
+        parentByte = byte;
+        node = toNode(child);
+    }
+}
+
+/*
+Finds the held range with the greatest start not above key in the subtree of
+node. While bounded, key lies within the subtree; once the search has fallen
+back to a smaller key byte, it takes the greatest start of the subtree.
+*/
+inline ArtRangeLock::Seek ArtRangeLock::seekBelow(Node *node, uint64_t key,
+                                                  bool bounded,
+                                                  uint64_t &start,
+                                                  uint64_t &end,
+                                                  ReadSet &reads) {
+    uint64_t version;
+    if (!readLock(node, version)) {
+        return Seek::restart;
+    }
+    reads.emplace_back(node, version);
+
+    if (bounded) {
+        int order = comparePrefix(node, key);
+        if (order > 0) {
+            return Seek::missing;
+        }
+        bounded = order == 0;
+    }
+
+    int bound = 255;
+    uint8_t byte;
+    uint64_t child;
+    if (bounded) {
+        byte = keyByte(key, node->level);
+        bound = byte;
+        if (node->level != leafLevel) {
+            child = getChild(node, byte);
+            if (child != 0) {
+                Seek seek = seekBelow(toNode(child), key, true, start, end,
+                                      reads);
+                if (seek != Seek::missing) {
+                    return seek;
+                }
+            }
+            bound = byte - 1;
+        }
+    }
+
+    for (; bound >= 0 && lowerChild(node, bound, byte, child);
+         bound = byte - 1) {
+        if (node->level == leafLevel) {
+            start = (node->prefix & ~uint64_t{0xFF}) | byte;
+            end = child - 1;
+            return Seek::found;
+        }
+        Seek seek = seekBelow(toNode(child), key, false, start, end, reads);
+        if (seek != Seek::missing) {
+            return seek;
+        }
+    }
+    return Seek::missing;
+}
+
+// Counterpart of seekBelow for the smallest start not below key
+inline ArtRangeLock::Seek ArtRangeLock::seekAbove(Node *node, uint64_t key,
+                                                  bool bounded,
+                                                  uint64_t &start,
+                                                  ReadSet &reads) {
+    uint64_t version;
+    if (!readLock(node, version)) {
+        return Seek::restart;
+    }
+    reads.emplace_back(node, version);
+
+    if (bounded) {
+        int order = comparePrefix(node, key);
+        if (order < 0) {
+            return Seek::missing;
+        }
+        bounded = order == 0;
+    }
+
+    int bound = 0;
+    uint8_t byte;
+    uint64_t child;
+    if (bounded) {
+        byte = keyByte(key, node->level);
+        bound = byte;
+        if (node->level != leafLevel) {
+            child = getChild(node, byte);
+            if (child != 0) {
+                Seek seek = seekAbove(toNode(child), key, true, start, reads);
+                if (seek != Seek::missing) {
+                    return seek;
+                }
+            }
+            bound = byte + 1;
+        }
+    }
+
+    for (; bound < 256 && upperChild(node, bound, byte, child);
+         bound = byte + 1) {
+        if (node->level == leafLevel) {
+            start = (node->prefix & ~uint64_t{0xFF}) | byte;
+            return Seek::found;
+        }
+        Seek seek = seekAbove(toNode(child), key, false, start, reads);
+        if (seek != Seek::missing) {
+            return seek;
+        }
+    }
+    return Seek::missing;
+}
+
+/*
+Latches the node start goes into, and its parent if the node has to be
+replaced, and checks that nothing else that was read has changed. Then
+links in [start, end] and returns true, or backs out and returns false.
+*/
+inline bool ArtRangeLock::attach(const InsertPoint &point, uint64_t start,
+                                 uint64_t end, const ReadSet &reads) {
+    Node *node = point.node;
+    Node *parent = point.parent;
+    bool split = point.kind == InsertPoint::splitPrefix;
+    bool replace = !split && isFull(node);
+
+    bool lockParent = split || replace;
+    bool lockNode = !split;
+    if (lockParent && !upgrade(parent, point.parentVersion)) {
+        return false;
+    }
+    if (lockNode && !upgrade(node, point.nodeVersion)) {
+        if (lockParent) {
+            unlock(parent);
+        }
+        return false;
+    }
+    // Of two writers that latch and then validate each other's nodes, the
+    // second to validate sees the latch of the first
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (auto &read : reads) {
+        bool latched = (lockParent && read.first == parent) ||
+                       (lockNode && read.first == node);
+        if (!latched && !validate(read.first, read.second)) {
+            if (lockNode) {
+                unlock(node);
+            }
+            if (lockParent) {
+                unlock(parent);
+            }
+            return false;
+        }
+    }
+
+    if (split) {
+        // The first byte where start leaves the prefix of node
+        unsigned level = __builtin_clzll(start ^ node->prefix) / 8;
+        Node *above = new Node4(level, start);
+        insertChild(above, keyByte(node->prefix, level), fromNode(node));
+        insertChild(above, keyByte(start, level), fromNode(newLeaf(start, end)));
+        replaceChild(parent, point.parentByte, fromNode(above));
+        unlock(parent);
+        return true;
+    }
+
+    uint8_t byte = keyByte(start, node->level);
+    uint64_t child = node->level == leafLevel ? end + 1
+                                              : fromNode(newLeaf(start, end));
+    if (replace) {
+        Node *bigger = grow(node);
+        insertChild(bigger, byte, child);
+        replaceChild(parent, point.parentByte, fromNode(bigger));
+        unlock(parent);
+        unlockObsolete(node);
+        retire(node);
+    } else {
+        insertChild(node, byte, child);
+        unlock(node);
+    }
+    return true;
+}
+
+inline bool ArtRangeLock::tryLock(uint64_t start, uint64_t end) {
+    if (start > end || end == std::numeric_limits<uint64_t>::max()) {
+        std::cerr << "Invalid range " << start << " " << end << std::endl;
+        return false;
+    }
+    size_t slot = enter();
+    bool locked = insertRange(start, end);
+    exit(slot);
+    return locked;
+}
+
+inline bool ArtRangeLock::insertRange(uint64_t start, uint64_t end) {
+    thread_local ReadSet reads;
+    for (int attempt = 0;; ++attempt) {
+        if (attempt > 0 && attempt % 16 == 0) {
+            std::this_thread::yield();
+        }
+        reads.clear();
+
+        InsertPoint point;
+        if (!lookUp(start, point, reads)) {
+            continue;
+        }
+        bool conflict = point.exists;
+        uint64_t otherStart, otherEnd;
+        if (!conflict) {
+            Seek seek = seekAbove(root, start, true, otherStart, reads);
+            if (seek == Seek::restart) {
+                continue;
+            }
+            conflict = seek == Seek::found && otherStart <= end;
+        }
+        if (!conflict && start > 0) {
+            Seek seek = seekBelow(root, start - 1, true, otherStart, otherEnd,
+                                  reads);
+            if (seek == Seek::restart) {
+                continue;
+            }
+            conflict = seek == Seek::found && otherEnd >= start;
+        }
+
+        if (conflict) {
+            bool valid = true;
+            for (auto &read : reads) {
+                valid = valid && validate(read.first, read.second);
+            }
+            if (valid) {
+                return false;
+            }
+            continue;
+        }
+        if (attach(point, start, end, reads)) {
+            elementsCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+inline bool ArtRangeLock::releaseLock(uint64_t start, uint64_t end) {
+    size_t slot = enter();
+    bool released = removeRange(start, end);
+    exit(slot);
+    return released;
+}
+
+inline bool ArtRangeLock::removeRange(uint64_t start, uint64_t end) {
+    thread_local ReadSet reads;
+    while (true) {
+        reads.clear();
+        InsertPoint point;
+        if (!lookUp(start, point, reads)) {
+            continue;
+        }
+        Node *node = point.node;
+        if (point.kind != InsertPoint::intoNode || !point.exists ||
+            node->level != leafLevel) {
+            // A child read while its node changed may lead anywhere, so
+            // the whole path has to be unchanged for the range to be absent
+            bool valid = true;
+            for (auto &read : reads) {
+                valid = valid && validate(read.first, read.second);
+            }
+            if (!valid) {
+                continue;
+            }
+            std::cerr << "Range not found. Wrong usage of releaseLock. "
+                      << start << " " << end << std::endl;
+            return false;
+        }
+
+        // A node that is not obsolete is still linked into the tree
+        if (!upgrade(node, point.nodeVersion)) {
+            continue;
+        }
+        uint8_t byte = keyByte(start, leafLevel);
+        if (getChild(node, byte) != end + 1) {
+            unlock(node);
+            std::cerr << "Range not found. Wrong usage of releaseLock. "
+                      << start << " " << end << std::endl;
+            return false;
+        }
+        if (node->count.load(std::memory_order_relaxed) == 1) {
+            if (!detach(reads, start)) {
+                unlock(node);
+                continue;
+            }
+        } else {
+            removeChild(node, byte);
+            unlock(node);
+        }
+        elementsCount.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+}
+
+/*
+reads holds the path from the root to the leaf, as lookUp left it. The
+parent and, for a collapse, the grandparent are latched by upgrading the
+versions they were read at, so that a change to either makes the caller
+start over. Latches are only ever tried, never waited for, so taking them
+bottom-up cannot deadlock. An inner node other than the root always keeps
+at least two children this way.
+*/
+inline bool ArtRangeLock::detach(const ReadSet &reads, uint64_t start) {
+    size_t depth = reads.size();
+    Node *leaf = reads[depth - 1].first;
+    Node *parent = reads[depth - 2].first;
+    if (!upgrade(parent, reads[depth - 2].second)) {
+        return false;
+    }
+    Node *grand = nullptr;
+    if (parent != root && parent->count.load(std::memory_order_relaxed) == 2) {
+        grand = reads[depth - 3].first;
+        if (!upgrade(grand, reads[depth - 3].second)) {
+            unlock(parent);
+            return false;
+        }
+    }
+
+    removeChild(parent, keyByte(start, parent->level));
+    unlockObsolete(leaf);
+    if (grand != nullptr) {
+        uint8_t byte;
+        uint64_t child;
+        upperChild(parent, 0, byte, child);
+        replaceChild(grand, keyByte(start, grand->level), child);
+        unlock(grand);
+        unlockObsolete(parent);
+        retire(parent);
+    } else {
+        unlock(parent);
+    }
+    retire(leaf);
+    return true;
+}
+
+inline size_t ArtRangeLock::depth(uint64_t key) {
+    thread_local ReadSet reads;
+    size_t slot = enter();
+    reads.clear();
+    InsertPoint point;
+    while (!lookUp(key, point, reads)) {
+        reads.clear();
+    }
+    exit(slot);
+    return reads.size();
+}
+
+inline size_t ArtRangeLock::nodeCount() {
+    return countTree(root);
+}
+
+inline size_t ArtRangeLock::retiredCount() {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    return retired.size();
+}
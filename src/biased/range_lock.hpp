@@ -0,0 +1,339 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "../v0/range_lock.hpp"
+
+/*
+Range lock for workloads where each thread mostly locks ranges inside a key
+region of its own. The key space is cut into regionCount regions of
+regionSize keys. A thread whose ranges in a region keep succeeding without
+interference is granted a lease on the region once it holds nothing there.
+From then on it locks and releases ranges that fit in the region in a map
+only it touches, with no shared atomic but the handshake below. Every other
+range goes to a ConcurrentRangeLock.
+
+A region's state word counts the skip-list ranges that touch the region,
+including ones whose tryLock is under way, and keeps the lease holder in its
+upper half. A lease is granted by a compare-and-swap from 0, so it starts
+with no skip-list range in the region, and a skip-list operation that bumps
+the count of a leased region revokes the lease before it goes on. While a
+region is leased all its ranges are therefore in the lease holder's map.
+
+The holder marks itself busy around every map operation, and a revocation
+raises revoking and waits for busy to drop. After that it moves the held
+ranges into the skip list, where they do not conflict with anything, and
+clears the lease. A range across a region border always goes to the skip
+list, so it revokes the leases of the regions it touches, its own thread's
+included. Keys from regionCount * regionSize on are never leased. The skip
+list gets keys shifted up by one and its tail takes the largest key, so
+end has to be below the largest uint64_t minus one, leased or not.
+*/
+template<unsigned maxLevel>
+class BiasedRangeLock {
+public:
+    // Successful skip-list operations in a row by one thread before it is
+    // offered a lease on the region
+    static constexpr uint32_t leaseThreshold = 64;
+
+    BiasedRangeLock(uint64_t regionSize, uint64_t regionCount);
+
+    bool tryLock(uint64_t start, uint64_t end);
+
+    bool releaseLock(uint64_t start, uint64_t end);
+
+    bool isLeased(uint64_t key) const;
+
+    size_t revocations() const { return revocationCount.load(); }
+
+    size_t size();
+
+private:
+    struct alignas(64) Region {
+        std::atomic<uint64_t> state{0};
+        std::atomic<bool> busy{false};
+        std::atomic<bool> revoking{false};
+        std::atomic<uint32_t> candidate{0};
+        std::atomic<uint32_t> streak{0};
+        std::mutex revokeMutex;
+        // Held ranges of the lease holder, by start
+        std::map<uint64_t, uint64_t> held;
+    };
+
+    const uint64_t regionSize;
+    const uint64_t regionCount;
+    std::unique_ptr<Region[]> regions;
+    std::atomic<size_t> leasedCount{0};
+    std::atomic<size_t> revocationCount{0};
+    // Keys are shifted up by one, since the head of the skip list takes 0
+    ConcurrentRangeLock<uint64_t, maxLevel> list;
+
+    static uint32_t threadToken();
+
+    static uint32_t holder(uint64_t state) { return state >> 32; }
+
+    // Regions of [start, end] that exist, false if there are none
+    bool regionSpan(uint64_t start, uint64_t end, uint64_t &first,
+                    uint64_t &last) const;
+
+    // Marks the calling lease holder busy in the region, false if the lease
+    // is gone or being revoked
+    bool enterLease(Region &region, uint32_t token);
+
+    bool tryLockLeased(Region &region, uint64_t start, uint64_t end);
+
+    bool releaseLeased(Region &region, uint64_t start, uint64_t end);
+
+    void revoke(Region &region);
+
+    bool tryLockShared(uint64_t start, uint64_t end);
+
+    bool releaseShared(uint64_t start, uint64_t end);
+
+    void leaveRegions(uint64_t first, uint64_t last);
+
+    // Counts a successful skip-list operation by the calling thread
+    void recordUse(Region &region);
+};
+
+template<unsigned maxLevel>
+BiasedRangeLock<maxLevel>::BiasedRangeLock(uint64_t regionSize,
+                                           uint64_t regionCount)
+        : regionSize{regionSize}, regionCount{regionCount},
+          regions{new Region[regionCount]} {}
+
+template<unsigned maxLevel>
+uint32_t BiasedRangeLock<maxLevel>::threadToken() {
+    static std::atomic<uint32_t> nextToken{1};
+    thread_local uint32_t token = nextToken.fetch_add(1);
+    return token;
+}
+
+template<unsigned maxLevel>
+size_t BiasedRangeLock<maxLevel>::size() {
+    return leasedCount.load() + list.size();
+}
+
+template<unsigned maxLevel>
+bool BiasedRangeLock<maxLevel>::isLeased(uint64_t key) const {
+    uint64_t r = key / regionSize;
+    return r < regionCount &&
+           holder(regions[r].state.load(std::memory_order_acquire)) != 0;
+}
+
+template<unsigned maxLevel>
+bool BiasedRangeLock<maxLevel>::regionSpan(uint64_t start, uint64_t end,
+                                           uint64_t &first,
+                                           uint64_t &last) const {
+    first = start / regionSize;
+    last = std::min(end / regionSize, regionCount - 1);
+    return first < regionCount;
+}
+
+template<unsigned maxLevel>
+bool BiasedRangeLock<maxLevel>::tryLock(uint64_t start, uint64_t end) {
+    if (start > end || end >= std::numeric_limits<uint64_t>::max() - 1) {
+        std::cerr << "Invalid range " << start << " " << end << std::endl;
+        return false;
+    }
+    uint64_t r = start / regionSize;
+    if (r < regionCount && end / regionSize == r) {
+        Region &region = regions[r];
+        uint32_t token = threadToken();
+        if (holder(region.state.load(std::memory_order_acquire)) == token &&
+            enterLease(region, token)) {
+            bool locked = tryLockLeased(region, start, end);
+            region.busy.store(false, std::memory_order_release);
+            return locked;
+        }
+    }
+    return tryLockShared(start, end);
+}
+
+template<unsigned maxLevel>
+bool BiasedRangeLock<maxLevel>::releaseLock(uint64_t start, uint64_t end) {
+    if (start > end || end >= std::numeric_limits<uint64_t>::max() - 1) {
+        std::cerr << "Invalid range " << start << " " << end << std::endl;
+        return false;
+    }
+    uint64_t r = start / regionSize;
+    if (r < regionCount && end / regionSize == r) {
+        Region &region = regions[r];
+        uint32_t token = threadToken();
+        if (holder(region.state.load(std::memory_order_acquire)) == token &&
+            enterLease(region, token)) {
+            bool released = releaseLeased(region, start, end);
+            region.busy.store(false, std::memory_order_release);
+            return released;
+        }
+    }
+    return releaseShared(start, end);
+}
+
+// The seq_cst store of busy and load of revoking pair with the store of
+// revoking and the load of busy in revoke: either the revocation waits for
+// this operation, or this operation sees the revocation.
+template<unsigned maxLevel>
+bool BiasedRangeLock<maxLevel>::enterLease(Region &region, uint32_t token) {
+    region.busy.store(true, std::memory_order_seq_cst);
+    if (region.revoking.load(std::memory_order_seq_cst) ||
+        holder(region.state.load(std::memory_order_acquire)) != token) {
+        region.busy.store(false, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+template<unsigned maxLevel>
+bool BiasedRangeLock<maxLevel>::tryLockLeased(Region &region, uint64_t start,
+                                              uint64_t end) {
+    auto next = region.held.lower_bound(start);
+    if (next != region.held.end() && next->first <= end) {
+        return false;
+    }
+    if (next != region.held.begin() && std::prev(next)->second >= start) {
+        return false;
+    }
+    region.held.emplace_hint(next, start, end);
+    leasedCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+template<unsigned maxLevel>
+bool BiasedRangeLock<maxLevel>::releaseLeased(Region &region, uint64_t start,
+                                              uint64_t end) {
+    auto it = region.held.find(start);
+    if (it == region.held.end() || it->second != end) {
+        std::cerr << "Range not held. Wrong usage of releaseLock. "
+                  << start << " " << end << std::endl;
+        return false;
+    }
+    region.held.erase(it);
+    leasedCount.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+template<unsigned maxLevel>
+void BiasedRangeLock<maxLevel>::revoke(Region &region) {
+    std::lock_guard<std::mutex> lock(region.revokeMutex);
+    uint64_t state = region.state.load(std::memory_order_acquire);
+    if (holder(state) == 0) {
+        return;
+    }
+
+    region.revoking.store(true, std::memory_order_seq_cst);
+    while (region.busy.load(std::memory_order_seq_cst)) {
+        std::this_thread::yield();
+    }
+
+    uint64_t moved = region.held.size();
+    for (auto &range : region.held) {
+        list.tryLock(range.first + 1, range.second + 1);
+    }
+    region.held.clear();
+    leasedCount.fetch_sub(moved, std::memory_order_relaxed);
+
+    // Drops the holder and counts the moved ranges in one step
+    region.state.fetch_add(moved - (uint64_t{holder(state)} << 32),
+                           std::memory_order_acq_rel);
+    region.streak.store(0, std::memory_order_relaxed);
+    revocationCount.fetch_add(1, std::memory_order_relaxed);
+    region.revoking.store(false, std::memory_order_release);
+}
+
+template<unsigned maxLevel>
+void BiasedRangeLock<maxLevel>::leaveRegions(uint64_t first, uint64_t last) {
+    for (uint64_t r = first; r <= last; ++r) {
+        regions[r].state.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+template<unsigned maxLevel>
+bool BiasedRangeLock<maxLevel>::tryLockShared(uint64_t start, uint64_t end) {
+    uint64_t first, last;
+    bool covered = regionSpan(start, end, first, last);
+    if (covered) {
+        for (uint64_t r = first; r <= last; ++r) {
+            if (holder(regions[r].state.fetch_add(
+                        1, std::memory_order_acq_rel)) != 0) {
+                revoke(regions[r]);
+            }
+        }
+    }
+
+    if (!list.tryLock(start + 1, end + 1)) {
+        if (covered) {
+            leaveRegions(first, last);
+            for (uint64_t r = first; r <= last; ++r) {
+                regions[r].streak.store(0, std::memory_order_relaxed);
+            }
+        }
+        return false;
+    }
+    if (covered && first == last) {
+        recordUse(regions[first]);
+    }
+    return true;
+}
+
+template<unsigned maxLevel>
+bool BiasedRangeLock<maxLevel>::releaseShared(uint64_t start, uint64_t end) {
+    uint64_t first, last;
+    bool covered = regionSpan(start, end, first, last);
+    if (covered) {
+        // A leased region keeps all its ranges in the holder's map
+        for (uint64_t r = first; r <= last; ++r) {
+            if (holder(regions[r].state.load(std::memory_order_acquire)) !=
+                0) {
+                revoke(regions[r]);
+            }
+        }
+    }
+
+    if (!list.releaseLock(start + 1, end + 1)) {
+        return false;
+    }
+    if (!covered) {
+        return true;
+    }
+    leaveRegions(first, last);
+    if (first != last) {
+        return true;
+    }
+
+    // The lease is granted only once the region holds no skip-list range
+    Region &region = regions[first];
+    uint32_t token = threadToken();
+    recordUse(region);
+    if (region.candidate.load(std::memory_order_relaxed) == token &&
+        region.streak.load(std::memory_order_relaxed) >= leaseThreshold) {
+        uint64_t expected = 0;
+        region.state.compare_exchange_strong(expected,
+                                             uint64_t{token} << 32,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// The candidate and its streak are hints, racing updates only delay or
+// hasten a lease
+template<unsigned maxLevel>
+void BiasedRangeLock<maxLevel>::recordUse(Region &region) {
+    uint32_t token = threadToken();
+    if (region.candidate.load(std::memory_order_relaxed) == token) {
+        region.streak.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        region.candidate.store(token, std::memory_order_relaxed);
+        region.streak.store(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+/*
+Range lock for small dense key types such as uint8_t and uint16_t, with the
+interface of ConcurrentRangeLock. Every key is a bit in an array of atomic
+64-bit words. Locking a range sets its bits word by word and backs out on
+the first word with a conflicting bit; releasing clears them.
+
+Words that lie entirely inside the range are taken with a single
+compare-and-swap from 0, so a conflict there writes nothing and a wide range
+costs one atomic per 64 keys. A word is read before it is written, so a
+conflicting tryLock only dirties the words it had already set. Bits set and
+then backed out can still make a concurrent tryLock on an overlapping range
+fail, which a caller retrying on failure does not notice.
+
+The bitmap does not record where one range ends and the next begins, so
+releaseLock only checks that every key of the range is held.
+*/
+template<typename T>
+class BitmapRangeLock {
+    static_assert(std::is_unsigned_v<T> && std::numeric_limits<T>::digits <= 24,
+                  "BitmapRangeLock needs an unsigned key type of at most 24 bits");
+
+private:
+    static constexpr size_t keys = size_t{std::numeric_limits<T>::max()} + 1;
+    static constexpr size_t wordCount = (keys + 63) / 64;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> words;
+    std::atomic<size_t> elementsCount{0};
+
+    static uint64_t mask(size_t word, T start, T end);
+
+    void clear(size_t first, size_t last, T start, T end);
+
+public:
+    BitmapRangeLock();
+
+    bool tryLock(T start, T end);
+
+    bool releaseLock(T start, T end);
+
+    bool anyOverlap(T start, T end) const;
+
+    bool isLocked(T key) const;
+
+    size_t size();
+
+    void displayList();
+};
+
+template<typename T>
+BitmapRangeLock<T>::BitmapRangeLock()
+        : words{new std::atomic<uint64_t>[wordCount]()} {}
+
+template<typename T>
+size_t BitmapRangeLock<T>::size() {
+    return elementsCount.load();
+}
+
+// Bits of the given word that fall into [start, end]
+template<typename T>
+uint64_t BitmapRangeLock<T>::mask(size_t word, T start, T end) {
+    size_t lo = word == start / 64 ? start % 64 : 0;
+    size_t hi = word == end / 64 ? end % 64 : 63;
+    return (~uint64_t{0} >> (63 - hi)) & (~uint64_t{0} << lo);
+}
+
+// Clears the bits of [start, end] in the words first to last
+template<typename T>
+void BitmapRangeLock<T>::clear(size_t first, size_t last, T start, T end) {
+    for (size_t w = first; w <= last; ++w) {
+        uint64_t bits = mask(w, start, end);
+        if (bits == ~uint64_t{0}) {
+            words[w].store(0, std::memory_order_release);
+        } else {
+            words[w].fetch_and(~bits, std::memory_order_release);
+        }
+    }
+}
+
+template<typename T>
+bool BitmapRangeLock<T>::tryLock(T start, T end) {
+    if (start > end) {
+        std::cerr << "Invalid range " << +start << " " << +end << std::endl;
+        return false;
+    }
+
+    size_t first = start / 64;
+    size_t last = end / 64;
+    for (size_t w = first; w <= last; ++w) {
+        uint64_t bits = mask(w, start, end);
+        bool conflict;
+        if (bits == ~uint64_t{0}) {
+            uint64_t expected = 0;
+            conflict = !words[w].compare_exchange_strong(
+                    expected, bits, std::memory_order_acquire,
+                    std::memory_order_relaxed);
+        } else if (words[w].load(std::memory_order_relaxed) & bits) {
+            conflict = true;
+        } else {
+            uint64_t old = words[w].fetch_or(bits, std::memory_order_acquire);
+            conflict = old & bits;
+            if (conflict) {
+                // Keep the bits that were already set
+                words[w].fetch_and(~(bits & ~old), std::memory_order_relaxed);
+            }
+        }
+
+        if (conflict) {
+            if (w > first) {
+                clear(first, w - 1, start, end);
+            }
+            return false;
+        }
+    }
+
+    elementsCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+template<typename T>
+bool BitmapRangeLock<T>::releaseLock(T start, T end) {
+    if (start > end) {
+        std::cerr << "Invalid range " << +start << " " << +end << std::endl;
+        return false;
+    }
+
+    size_t first = start / 64;
+    size_t last = end / 64;
+    for (size_t w = first; w <= last; ++w) {
+        uint64_t bits = mask(w, start, end);
+        if ((words[w].load(std::memory_order_relaxed) & bits) != bits) {
+            std::cerr << "Range not held. Wrong usage of releaseLock. "
+                      << +start << " " << +end << std::endl;
+            return false;
+        }
+    }
+
+    clear(first, last, start, end);
+    elementsCount.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+template<typename T>
+bool BitmapRangeLock<T>::anyOverlap(T start, T end) const {
+    if (start > end) {
+        return false;
+    }
+    for (size_t w = start / 64; w <= end / 64; ++w) {
+        if (words[w].load(std::memory_order_acquire) & mask(w, start, end)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename T>
+bool BitmapRangeLock<T>::isLocked(T key) const {
+    return anyOverlap(key, key);
+}
+
+// Adjacent ranges cannot be told apart and are printed as one
+template<typename T>
+void BitmapRangeLock<T>::displayList() {
+    bool inRange = false;
+    size_t rangeStart = 0;
+    for (size_t key = 0; key <= keys; ++key) {
+        bool held = key < keys &&
+                    (words[key / 64].load(std::memory_order_relaxed) >>
+                     (key % 64)) & 1;
+        if (held && !inRange) {
+            rangeStart = key;
+        } else if (!held && inRange) {
+            std::cout << "[" << rangeStart << ", " << key - 1 << "] ";
+        }
+        inRange = held;
+    }
+    std::cout << std::endl;
+}
@@ -0,0 +1,811 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+Range lock that indexes held ranges by start key in a B+-tree whose leaves
+keep their [start, end] pairs contiguously and sorted. With a fanout of 16
+to 64 a lookup touches a handful of nodes, and the neighbours of a range
+mostly sit in the same cache lines as the slot it goes into.
+
+Descents use optimistic lock coupling (Leis et al., DaMoN 2016): every node
+has a version word, readers never write to shared memory and restart if a
+version they read has changed. tryLock reads the leaf that start goes into,
+and the leaves to its left and right as far as needed to find the held
+range before start and to cover [start, end]. It then latches only that
+leaf, by upgrading the version it read, and validates every other node it
+looked at. Two overlapping ranges each read the leaf the other goes into,
+so the second to validate sees the latch or the change of the first.
+
+A full node is split on the way to an insertion and underfull nodes are
+merged with a sibling after a release, which latches the parent and the two
+siblings. Nodes that were merged away are retired, since optimistic readers
+may still be looking at them. Every operation announces the epoch it
+started in, in a slot of its own, and a retired node is freed once no
+operation that started before it was retired is still running.
+*/
+template<unsigned fanout = 32>
+class BTreeRangeLock {
+    static_assert(fanout >= 16 && fanout <= 64,
+                  "BTreeRangeLock supports a fanout of 16 to 64");
+
+public:
+    BTreeRangeLock();
+
+    ~BTreeRangeLock();
+
+    BTreeRangeLock(const BTreeRangeLock &) = delete;
+
+    BTreeRangeLock &operator=(const BTreeRangeLock &) = delete;
+
+    bool tryLock(uint64_t start, uint64_t end);
+
+    bool releaseLock(uint64_t start, uint64_t end);
+
+    size_t size();
+
+    // Number of levels, 1 while the root is a leaf
+    size_t height();
+
+    // Number of nodes retired and not freed yet
+    size_t retiredCount();
+
+private:
+    static constexpr uint64_t lockedBit = 0b10;
+    static constexpr uint64_t obsoleteBit = 0b01;
+    static constexpr unsigned minFill = fanout / 4;
+    static constexpr size_t epochSlots = 64;
+    // Retired nodes are freed in batches of this many
+    static constexpr size_t reclaimBatch = 256;
+
+    struct Node {
+        explicit Node(bool leaf) : leaf{leaf} {}
+
+        std::atomic<uint64_t> version{0};
+        const bool leaf;
+        // Entries of a leaf, children of an inner node
+        std::atomic<unsigned> count{0};
+    };
+
+    struct Leaf : Node {
+        Leaf() : Node(true) {}
+
+        // Start of entry i at 2i, its end at 2i + 1
+        std::atomic<uint64_t> entries[2 * fanout]{};
+    };
+
+    // Child i holds the starts from keys[i - 1] up to keys[i]
+    struct Inner : Node {
+        Inner() : Node(false) {}
+
+        std::atomic<uint64_t> keys[fanout - 1]{};
+        std::atomic<Node *> children[fanout]{};
+    };
+
+    // A node on the way down and the child that was taken from it
+    struct Step {
+        Node *node;
+        uint64_t version;
+        unsigned child;
+    };
+
+    // Keys a leaf may hold, [low, high)
+    struct Fences {
+        bool hasLow;
+        uint64_t low;
+        bool hasHigh;
+        uint64_t high;
+    };
+
+    // The epoch an operation of its thread started in, 0 while none runs
+    struct alignas(64) EpochSlot {
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    using ReadSet = std::vector<std::pair<Node *, uint64_t>>;
+    using Path = std::vector<Step>;
+
+    std::atomic<Node *> root;
+    std::atomic<size_t> elementsCount{0};
+    std::unique_ptr<EpochSlot[]> slots;
+    std::atomic<uint64_t> globalEpoch{1};
+    std::mutex retiredMutex;
+    // Retired nodes with the epoch they were retired in
+    std::vector<std::pair<Node *, uint64_t>> retired;
+
+    static bool readLock(Node *node, uint64_t &version);
+
+    static bool validate(const Node *node, uint64_t version);
+
+    static bool upgrade(Node *node, uint64_t version);
+
+    static bool latch(Node *node);
+
+    static void unlock(Node *node);
+
+    static void unlockObsolete(Node *node);
+
+    static unsigned countOf(const Node *node);
+
+    static uint64_t startAt(const Leaf *leaf, unsigned i);
+
+    static uint64_t endAt(const Leaf *leaf, unsigned i);
+
+    static unsigned lowerBound(const Leaf *leaf, unsigned n, uint64_t key);
+
+    static uint64_t halve(Node *node, Node *&right);
+
+    static void absorb(Node *left, Node *right, uint64_t separator);
+
+    static void deleteNode(Node *node);
+
+    static void deleteTree(Node *node);
+
+    bool descend(uint64_t key, Path &path, Fences &fences, ReadSet &reads);
+
+    bool successorWithin(Fences fences, uint64_t end, ReadSet &reads,
+                         bool &conflict);
+
+    bool predecessorReaches(Fences fences, uint64_t start, ReadSet &reads,
+                            bool &conflict);
+
+    void split(const Path &path, size_t depth);
+
+    void merge(const Path &path, size_t depth);
+
+    bool insertRange(uint64_t start, uint64_t end);
+
+    bool removeRange(uint64_t start, uint64_t end);
+
+    // Announces an operation and returns its slot
+    size_t enter();
+
+    void exit(size_t slot);
+
+    // The node is unlinked and marked obsolete
+    void retire(Node *node);
+
+    void reclaimLocked();
+};
+
+template<unsigned fanout>
+BTreeRangeLock<fanout>::BTreeRangeLock()
+        : root{new Leaf()}, slots{new EpochSlot[epochSlots]} {}
+
+template<unsigned fanout>
+BTreeRangeLock<fanout>::~BTreeRangeLock() {
+    deleteTree(root.load());
+    for (auto &node : retired) {
+        deleteNode(node.first);
+    }
+}
+
+template<unsigned fanout>
+size_t BTreeRangeLock<fanout>::size() {
+    return elementsCount.load();
+}
+
+template<unsigned fanout>
+size_t BTreeRangeLock<fanout>::height() {
+    size_t slot = enter();
+    size_t levels = 1;
+    for (Node *node = root.load(); !node->leaf;
+         node = static_cast<Inner *>(node)->children[0].load()) {
+        ++levels;
+    }
+    exit(slot);
+    return levels;
+}
+
+template<unsigned fanout>
+size_t BTreeRangeLock<fanout>::retiredCount() {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    return retired.size();
+}
+
+// Waits for a writer to finish, fails if the node has been merged away
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::readLock(Node *node, uint64_t &version) {
+    version = node->version.load(std::memory_order_acquire);
+    while (version & lockedBit) {
+        std::this_thread::yield();
+        version = node->version.load(std::memory_order_acquire);
+    }
+    return !(version & obsoleteBit);
+}
+
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::validate(const Node *node, uint64_t version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return node->version.load(std::memory_order_relaxed) == version;
+}
+
+// Takes the latch if nothing changed since the node was read at version
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::upgrade(Node *node, uint64_t version) {
+    if (!node->version.compare_exchange_strong(version, version + lockedBit,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+}
+
+// Takes the latch of a node that was not read before, without waiting
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::latch(Node *node) {
+    uint64_t version = node->version.load(std::memory_order_relaxed);
+    return !(version & (lockedBit | obsoleteBit)) && upgrade(node, version);
+}
+
+template<unsigned fanout>
+void BTreeRangeLock<fanout>::unlock(Node *node) {
+    node->version.fetch_add(lockedBit, std::memory_order_release);
+}
+
+template<unsigned fanout>
+void BTreeRangeLock<fanout>::unlockObsolete(Node *node) {
+    node->version.fetch_add(lockedBit | obsoleteBit,
+                            std::memory_order_release);
+}
+
+// A racing read may see the count ahead of the arrays
+template<unsigned fanout>
+unsigned BTreeRangeLock<fanout>::countOf(const Node *node) {
+    return std::min(node->count.load(std::memory_order_relaxed), fanout);
+}
+
+template<unsigned fanout>
+uint64_t BTreeRangeLock<fanout>::startAt(const Leaf *leaf, unsigned i) {
+    return leaf->entries[2 * i].load(std::memory_order_relaxed);
+}
+
+template<unsigned fanout>
+uint64_t BTreeRangeLock<fanout>::endAt(const Leaf *leaf, unsigned i) {
+    return leaf->entries[2 * i + 1].load(std::memory_order_relaxed);
+}
+
+// First of the n entries of leaf that starts at or after key
+template<unsigned fanout>
+unsigned BTreeRangeLock<fanout>::lowerBound(const Leaf *leaf, unsigned n,
+                                            uint64_t key) {
+    unsigned lo = 0, hi = n;
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        if (startAt(leaf, mid) < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+Moves the upper half of a latched full node into a new right sibling and
+returns the separator, the smallest key the sibling holds.
+*/
+template<unsigned fanout>
+uint64_t BTreeRangeLock<fanout>::halve(Node *node, Node *&right) {
+    unsigned n = node->count.load(std::memory_order_relaxed);
+    unsigned m = n / 2;
+    if (node->leaf) {
+        auto *left = static_cast<Leaf *>(node);
+        auto *sibling = new Leaf();
+        for (unsigned i = m; i < n; ++i) {
+            sibling->entries[2 * (i - m)].store(startAt(left, i));
+            sibling->entries[2 * (i - m) + 1].store(endAt(left, i));
+        }
+        sibling->count.store(n - m);
+        left->count.store(m, std::memory_order_relaxed);
+        right = sibling;
+        return startAt(sibling, 0);
+    }
+
+    auto *left = static_cast<Inner *>(node);
+    auto *sibling = new Inner();
+    for (unsigned i = m; i < n; ++i) {
+        sibling->children[i - m].store(left->children[i].load());
+        if (i + 1 < n) {
+            sibling->keys[i - m].store(left->keys[i].load());
+        }
+    }
+    sibling->count.store(n - m);
+    left->count.store(m, std::memory_order_relaxed);
+    right = sibling;
+    return left->keys[m - 1].load(std::memory_order_relaxed);
+}
+
+// Appends a latched right sibling to a latched left node
+template<unsigned fanout>
+void BTreeRangeLock<fanout>::absorb(Node *left, Node *right,
+                                    uint64_t separator) {
+    unsigned nl = left->count.load(std::memory_order_relaxed);
+    unsigned nr = right->count.load(std::memory_order_relaxed);
+    if (left->leaf) {
+        auto *to = static_cast<Leaf *>(left);
+        auto *from = static_cast<Leaf *>(right);
+        for (unsigned i = 0; i < nr; ++i) {
+            to->entries[2 * (nl + i)].store(startAt(from, i),
+                                            std::memory_order_relaxed);
+            to->entries[2 * (nl + i) + 1].store(endAt(from, i),
+                                                std::memory_order_relaxed);
+        }
+    } else {
+        auto *to = static_cast<Inner *>(left);
+        auto *from = static_cast<Inner *>(right);
+        to->keys[nl - 1].store(separator, std::memory_order_relaxed);
+        for (unsigned i = 0; i < nr; ++i) {
+            to->children[nl + i].store(from->children[i].load(),
+                                       std::memory_order_relaxed);
+            if (i + 1 < nr) {
+                to->keys[nl + i].store(from->keys[i].load(),
+                                       std::memory_order_relaxed);
+            }
+        }
+    }
+    left->count.store(nl + nr, std::memory_order_relaxed);
+}
+
+template<unsigned fanout>
+void BTreeRangeLock<fanout>::deleteNode(Node *node) {
+    if (node->leaf) {
+        delete static_cast<Leaf *>(node);
+    } else {
+        delete static_cast<Inner *>(node);
+    }
+}
+
+template<unsigned fanout>
+void BTreeRangeLock<fanout>::deleteTree(Node *node) {
+    if (!node->leaf) {
+        auto *inner = static_cast<Inner *>(node);
+        for (unsigned i = 0; i < countOf(node); ++i) {
+            deleteTree(inner->children[i].load());
+        }
+    }
+    deleteNode(node);
+}
+
+// Threads share a slot only while more than epochSlots operations run. The
+// fence pairs with the one in reclaimLocked: either the reclaim sees the
+// slot taken, or the operation does not see the nodes it frees.
+template<unsigned fanout>
+size_t BTreeRangeLock<fanout>::enter() {
+    static std::atomic<size_t> nextSlot{0};
+    thread_local size_t preferred = nextSlot.fetch_add(1);
+    for (size_t i = preferred % epochSlots;; i = (i + 1) % epochSlots) {
+        uint64_t idle = 0;
+        if (slots[i].epoch.load(std::memory_order_relaxed) == 0 &&
+            slots[i].epoch.compare_exchange_strong(
+                    idle, globalEpoch.load(std::memory_order_acquire),
+                    std::memory_order_relaxed)) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return i;
+        }
+    }
+}
+
+template<unsigned fanout>
+void BTreeRangeLock<fanout>::exit(size_t slot) {
+    slots[slot].epoch.store(0, std::memory_order_release);
+}
+
+template<unsigned fanout>
+void BTreeRangeLock<fanout>::retire(Node *node) {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    retired.emplace_back(node, globalEpoch.load(std::memory_order_relaxed));
+    if (retired.size() >= reclaimBatch) {
+        reclaimLocked();
+    }
+}
+
+// Operations that announced an epoch after a node was retired started
+// after it was unlinked, so only older announcements keep it
+template<unsigned fanout>
+void BTreeRangeLock<fanout>::reclaimLocked() {
+    globalEpoch.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < epochSlots; ++i) {
+        uint64_t epoch = slots[i].epoch.load(std::memory_order_relaxed);
+        if (epoch != 0) {
+            oldest = std::min(oldest, epoch);
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    size_t kept = 0;
+    for (auto &node : retired) {
+        if (node.second < oldest) {
+            deleteNode(node.first);
+        } else {
+            retired[kept++] = node;
+        }
+    }
+    retired.resize(kept);
+}
+
+/*
+Walks down to the leaf that holds key, coupling every step by validating
+the parent after reading the child. Fails if it saw a concurrent change.
+*/
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::descend(uint64_t key, Path &path,
+                                     Fences &fences, ReadSet &reads) {
+    path.clear();
+    fences = {false, 0, false, 0};
+
+    Node *node = root.load(std::memory_order_acquire);
+    uint64_t version;
+    if (!readLock(node, version) ||
+        root.load(std::memory_order_acquire) != node) {
+        return false;
+    }
+    while (true) {
+        reads.emplace_back(node, version);
+        if (node->leaf) {
+            path.push_back({node, version, 0});
+            return true;
+        }
+
+        auto *inner = static_cast<Inner *>(node);
+        unsigned n = countOf(node);
+        unsigned i = 0;
+        while (i + 1 < n &&
+               key >= inner->keys[i].load(std::memory_order_relaxed)) {
+            ++i;
+        }
+        if (i > 0) {
+            fences.hasLow = true;
+            fences.low = inner->keys[i - 1].load(std::memory_order_relaxed);
+        }
+        if (i + 1 < n) {
+            fences.hasHigh = true;
+            fences.high = inner->keys[i].load(std::memory_order_relaxed);
+        }
+        Node *child = inner->children[i].load(std::memory_order_relaxed);
+        path.push_back({node, version, i});
+
+        uint64_t childVersion;
+        if (child == nullptr || !readLock(child, childVersion) ||
+            !validate(node, version)) {
+            return false;
+        }
+        node = child;
+        version = childVersion;
+    }
+}
+
+/*
+Looks for a held range starting in [high fence, end] in the leaves right of
+the one with the given fences. Fails if it saw a concurrent change.
+*/
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::successorWithin(Fences fences, uint64_t end,
+                                             ReadSet &reads, bool &conflict) {
+    thread_local Path path;
+    conflict = false;
+    while (fences.hasHigh && fences.high <= end) {
+        Fences next;
+        if (!descend(fences.high, path, next, reads)) {
+            return false;
+        }
+        auto *leaf = static_cast<Leaf *>(path.back().node);
+        unsigned n = countOf(leaf);
+        unsigned pos = lowerBound(leaf, n, fences.high);
+        if (pos < n) {
+            conflict = startAt(leaf, pos) <= end;
+            return true;
+        }
+        if (next.hasHigh && next.high <= fences.high) {
+            return false;
+        }
+        fences = next;
+    }
+    return true;
+}
+
+/*
+Looks whether the held range nearest before the low fence reaches start,
+in the leaves left of the one with the given fences. Fails if it saw a
+concurrent change.
+*/
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::predecessorReaches(Fences fences,
+                                                uint64_t start,
+                                                ReadSet &reads,
+                                                bool &conflict) {
+    thread_local Path path;
+    conflict = false;
+    while (fences.hasLow && fences.low > 0) {
+        Fences next;
+        if (!descend(fences.low - 1, path, next, reads)) {
+            return false;
+        }
+        auto *leaf = static_cast<Leaf *>(path.back().node);
+        unsigned n = countOf(leaf);
+        unsigned pos = lowerBound(leaf, n, fences.low);
+        if (pos > 0) {
+            conflict = endAt(leaf, pos - 1) >= start;
+            return true;
+        }
+        if (next.hasLow && next.low >= fences.low) {
+            return false;
+        }
+        fences = next;
+    }
+    return true;
+}
+
+/*
+Splits the full node at path[depth], splitting a full parent first. Gives
+up if any node on the way has changed; the caller restarts either way.
+*/
+template<unsigned fanout>
+void BTreeRangeLock<fanout>::split(const Path &path, size_t depth) {
+    Node *node = path[depth].node;
+    if (depth == 0) {
+        if (!upgrade(node, path[depth].version)) {
+            return;
+        }
+        Node *right;
+        uint64_t separator = halve(node, right);
+        auto *newRoot = new Inner();
+        newRoot->keys[0].store(separator);
+        newRoot->children[0].store(node);
+        newRoot->children[1].store(right);
+        newRoot->count.store(2);
+        root.store(newRoot, std::memory_order_release);
+        unlock(node);
+        return;
+    }
+
+    const Step &up = path[depth - 1];
+    auto *parent = static_cast<Inner *>(up.node);
+    if (countOf(parent) == fanout) {
+        split(path, depth - 1);
+        return;
+    }
+    if (!upgrade(parent, up.version)) {
+        return;
+    }
+    if (!upgrade(node, path[depth].version)) {
+        unlock(parent);
+        return;
+    }
+
+    Node *right;
+    uint64_t separator = halve(node, right);
+    unsigned n = parent->count.load(std::memory_order_relaxed);
+    for (unsigned i = n; i > up.child + 1; --i) {
+        parent->children[i].store(parent->children[i - 1].load(),
+                                  std::memory_order_relaxed);
+        parent->keys[i - 1].store(parent->keys[i - 2].load(),
+                                  std::memory_order_relaxed);
+    }
+    parent->keys[up.child].store(separator, std::memory_order_relaxed);
+    parent->children[up.child + 1].store(right, std::memory_order_relaxed);
+    parent->count.store(n + 1, std::memory_order_relaxed);
+    unlock(node);
+    unlock(parent);
+}
+
+/*
+Merges the underfull node at path[depth] with a sibling if both fit into
+one node, and goes on with the parent if that leaves it underfull. A root
+with a single child hands over to that child. Gives up on any latch that is
+taken or any node that has changed, underfull nodes are merely slower.
+*/
+template<unsigned fanout>
+void BTreeRangeLock<fanout>::merge(const Path &path, size_t depth) {
+    if (depth == 0) {
+        return;
+    }
+    const Step &up = path[depth - 1];
+    auto *parent = static_cast<Inner *>(up.node);
+    if (!upgrade(parent, up.version)) {
+        return;
+    }
+    unsigned n = parent->count.load(std::memory_order_relaxed);
+    if (n < 2) {
+        unlock(parent);
+        return;
+    }
+    unsigned li = up.child > 0 ? up.child - 1 : 0;
+    Node *left = parent->children[li].load(std::memory_order_relaxed);
+    Node *right = parent->children[li + 1].load(std::memory_order_relaxed);
+    if (!latch(left)) {
+        unlock(parent);
+        return;
+    }
+    if (!latch(right)) {
+        unlock(left);
+        unlock(parent);
+        return;
+    }
+    if (left->count.load(std::memory_order_relaxed) +
+                right->count.load(std::memory_order_relaxed) >
+        fanout) {
+        unlock(right);
+        unlock(left);
+        unlock(parent);
+        return;
+    }
+
+    absorb(left, right, parent->keys[li].load(std::memory_order_relaxed));
+    for (unsigned i = li + 1; i + 1 < n; ++i) {
+        parent->children[i].store(parent->children[i + 1].load(),
+                                  std::memory_order_relaxed);
+        parent->keys[i - 1].store(parent->keys[i].load(),
+                                  std::memory_order_relaxed);
+    }
+    parent->count.store(n - 1, std::memory_order_relaxed);
+    unlock(left);
+    unlockObsolete(right);
+    retire(right);
+
+    if (depth == 1 && n - 1 == 1) {
+        root.store(left, std::memory_order_release);
+        unlockObsolete(parent);
+        retire(parent);
+        return;
+    }
+    unlock(parent);
+    if (n - 1 < minFill) {
+        merge(path, depth - 1);
+    }
+}
+
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::tryLock(uint64_t start, uint64_t end) {
+    if (start > end) {
+        std::cerr << "Invalid range " << start << " " << end << std::endl;
+        return false;
+    }
+    size_t slot = enter();
+    bool locked = insertRange(start, end);
+    exit(slot);
+    return locked;
+}
+
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::insertRange(uint64_t start, uint64_t end) {
+    thread_local ReadSet reads;
+    thread_local Path path;
+    for (int attempt = 0;; ++attempt) {
+        if (attempt > 0 && attempt % 16 == 0) {
+            std::this_thread::yield();
+        }
+        reads.clear();
+
+        Fences fences;
+        if (!descend(start, path, fences, reads)) {
+            continue;
+        }
+        auto *leaf = static_cast<Leaf *>(path.back().node);
+        unsigned n = countOf(leaf);
+        unsigned pos = lowerBound(leaf, n, start);
+
+        bool conflict;
+        if (pos < n) {
+            conflict = startAt(leaf, pos) <= end;
+        } else if (!successorWithin(fences, end, reads, conflict)) {
+            continue;
+        }
+        if (!conflict) {
+            if (pos > 0) {
+                conflict = endAt(leaf, pos - 1) >= start;
+            } else if (!predecessorReaches(fences, start, reads, conflict)) {
+                continue;
+            }
+        }
+
+        if (conflict) {
+            bool valid = true;
+            for (auto &read : reads) {
+                valid = valid && validate(read.first, read.second);
+            }
+            if (valid) {
+                return false;
+            }
+            continue;
+        }
+
+        if (n == fanout) {
+            split(path, path.size() - 1);
+            continue;
+        }
+        if (!upgrade(leaf, path.back().version)) {
+            continue;
+        }
+        // Of two writers that latch and then validate each other's leaves,
+        // the second to validate sees the latch of the first
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool valid = true;
+        for (auto &read : reads) {
+            valid = valid && (read.first == leaf ||
+                              validate(read.first, read.second));
+        }
+        if (!valid) {
+            unlock(leaf);
+            continue;
+        }
+
+        for (unsigned i = n; i > pos; --i) {
+            leaf->entries[2 * i].store(startAt(leaf, i - 1),
+                                       std::memory_order_relaxed);
+            leaf->entries[2 * i + 1].store(endAt(leaf, i - 1),
+                                           std::memory_order_relaxed);
+        }
+        leaf->entries[2 * pos].store(start, std::memory_order_relaxed);
+        leaf->entries[2 * pos + 1].store(end, std::memory_order_relaxed);
+        leaf->count.store(n + 1, std::memory_order_relaxed);
+        unlock(leaf);
+        elementsCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+}
+
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::releaseLock(uint64_t start, uint64_t end) {
+    size_t slot = enter();
+    bool released = removeRange(start, end);
+    exit(slot);
+    return released;
+}
+
+template<unsigned fanout>
+bool BTreeRangeLock<fanout>::removeRange(uint64_t start, uint64_t end) {
+    thread_local ReadSet reads;
+    thread_local Path path;
+    while (true) {
+        reads.clear();
+        Fences fences;
+        if (!descend(start, path, fences, reads)) {
+            continue;
+        }
+        auto *leaf = static_cast<Leaf *>(path.back().node);
+        uint64_t version = path.back().version;
+        unsigned n = countOf(leaf);
+        unsigned pos = lowerBound(leaf, n, start);
+        if (pos == n || startAt(leaf, pos) != start ||
+            endAt(leaf, pos) != end) {
+            if (!validate(leaf, version)) {
+                continue;
+            }
+            std::cerr << "Range not found. Wrong usage of releaseLock. "
+                      << start << " " << end << std::endl;
+            return false;
+        }
+
+        // A leaf that has not changed still holds the range
+        if (!upgrade(leaf, version)) {
+            continue;
+        }
+        for (unsigned i = pos; i + 1 < n; ++i) {
+            leaf->entries[2 * i].store(startAt(leaf, i + 1),
+                                       std::memory_order_relaxed);
+            leaf->entries[2 * i + 1].store(endAt(leaf, i + 1),
+                                           std::memory_order_relaxed);
+        }
+        leaf->count.store(n - 1, std::memory_order_relaxed);
+        unlock(leaf);
+        elementsCount.fetch_sub(1, std::memory_order_relaxed);
+
+        if (n - 1 < minFill) {
+            merge(path, path.size() - 1);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+#include "../v0/range_lock.hpp"
+
+/*
+Range lock over byte addresses for workloads where most ranges cover whole
+4 KiB pages. A range that starts and ends on page boundaries and spans at
+most maxFastPages pages takes a lock word per page in a flat array, which is
+constant work with no traversal. Every other range, unaligned or larger, is
+locked in a ConcurrentRangeLock.
+
+The page words keep the two paths mutually exclusive. A word is pageHeld
+while an aligned range owns the page and otherwise counts the skip-list
+ranges that touch the page. The fast path claims a page only when its word
+is 0. The slow path increments the words of the pages it touches before it
+goes to the skip list, and backs out if one of them is pageHeld. Whichever
+path reaches a word first wins, and skip-list ranges sharing a page are left
+to the skip list. Both paths only ever add and subtract their own share of a
+word, so an increment that is about to be backed out survives the release of
+the aligned range it ran into.
+
+A slow-path range pays one increment on acquire and one decrement on
+release for every page it touches, so its cost grows linearly with its
+length in pages, on top of the skip list. Ranges much longer than
+maxFastPages pages are best kept beyond the page array.
+
+An aligned range is released only by the exact range that locked it. The
+first page of the range keeps its length in pages, so that releasing a
+part of it, or a larger range over it, is rejected instead of freeing
+pages another range owns.
+
+Keys from pageCount * pageSize on have no page words and always take the
+slow path. The skip list gets keys shifted up by one and its tail takes
+the largest key, so end has to be below the largest uint64_t minus one.
+*/
+template<unsigned maxLevel>
+class HybridRangeLock {
+public:
+    static constexpr uint64_t pageSize = 4096;
+    static constexpr uint64_t maxFastPages = 16;
+
+    explicit HybridRangeLock(uint64_t pageCount);
+
+    bool tryLock(uint64_t start, uint64_t end);
+
+    bool releaseLock(uint64_t start, uint64_t end);
+
+    bool isFastPath(uint64_t start, uint64_t end) const;
+
+    size_t size();
+
+    ConcurrentRangeLock<uint64_t, maxLevel> &skipList() { return list; }
+
+private:
+    static constexpr uint32_t pageHeld = uint32_t{1} << 31;
+
+    const uint64_t pageCount;
+    std::unique_ptr<std::atomic<uint32_t>[]> pages;
+    // Length in pages of the aligned range starting at each page, 0 if none
+    std::unique_ptr<std::atomic<uint8_t>[]> runs;
+    std::atomic<size_t> fastCount{0};
+    // Keys are shifted up by one, since the head of the skip list takes 0
+    ConcurrentRangeLock<uint64_t, maxLevel> list;
+
+    bool tryLockFast(uint64_t first, uint64_t last);
+
+    void releaseFast(uint64_t first, uint64_t last);
+
+    bool tryLockSlow(uint64_t start, uint64_t end);
+
+    bool releaseSlow(uint64_t start, uint64_t end);
+
+    // Page words of [start, end] that exist, false if there are none
+    bool pageSpan(uint64_t start, uint64_t end, uint64_t &first,
+                  uint64_t &last) const;
+
+    void leavePages(uint64_t first, uint64_t last);
+};
+
+template<unsigned maxLevel>
+HybridRangeLock<maxLevel>::HybridRangeLock(uint64_t pageCount)
+        : pageCount{pageCount}, pages{new std::atomic<uint32_t>[pageCount]()},
+          runs{new std::atomic<uint8_t>[pageCount]()} {}
+
+template<unsigned maxLevel>
+size_t HybridRangeLock<maxLevel>::size() {
+    return fastCount.load() + list.size();
+}
+
+template<unsigned maxLevel>
+bool HybridRangeLock<maxLevel>::isFastPath(uint64_t start,
+                                           uint64_t end) const {
+    return start % pageSize == 0 && (end + 1) % pageSize == 0 &&
+           end < pageCount * pageSize &&
+           (end - start + 1) / pageSize <= maxFastPages;
+}
+
+template<unsigned maxLevel>
+bool HybridRangeLock<maxLevel>::tryLock(uint64_t start, uint64_t end) {
+    if (start > end || end >= std::numeric_limits<uint64_t>::max() - 1) {
+        std::cerr << "Invalid range " << start << " " << end << std::endl;
+        return false;
+    }
+    if (isFastPath(start, end)) {
+        return tryLockFast(start / pageSize, end / pageSize);
+    }
+    return tryLockSlow(start, end);
+}
+
+template<unsigned maxLevel>
+bool HybridRangeLock<maxLevel>::releaseLock(uint64_t start, uint64_t end) {
+    if (start > end || end >= std::numeric_limits<uint64_t>::max() - 1) {
+        std::cerr << "Invalid range " << start << " " << end << std::endl;
+        return false;
+    }
+    if (isFastPath(start, end)) {
+        uint64_t first = start / pageSize, last = end / pageSize;
+        if (!(pages[first].load(std::memory_order_relaxed) & pageHeld) ||
+            runs[first].load(std::memory_order_relaxed) != last - first + 1) {
+            std::cerr << "Range not held. Wrong usage of releaseLock. "
+                      << start << " " << end << std::endl;
+            return false;
+        }
+        releaseFast(first, last);
+        return true;
+    }
+    return releaseSlow(start, end);
+}
+
+template<unsigned maxLevel>
+bool HybridRangeLock<maxLevel>::tryLockFast(uint64_t first, uint64_t last) {
+    for (uint64_t p = first; p <= last; ++p) {
+        uint32_t expected = 0;
+        if (!pages[p].compare_exchange_strong(expected, pageHeld,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed)) {
+            for (uint64_t q = first; q < p; ++q) {
+                pages[q].fetch_sub(pageHeld, std::memory_order_release);
+            }
+            return false;
+        }
+    }
+    runs[first].store(last - first + 1, std::memory_order_relaxed);
+    fastCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+template<unsigned maxLevel>
+void HybridRangeLock<maxLevel>::releaseFast(uint64_t first, uint64_t last) {
+    runs[first].store(0, std::memory_order_relaxed);
+    for (uint64_t p = first; p <= last; ++p) {
+        pages[p].fetch_sub(pageHeld, std::memory_order_release);
+    }
+    fastCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template<unsigned maxLevel>
+bool HybridRangeLock<maxLevel>::pageSpan(uint64_t start, uint64_t end,
+                                         uint64_t &first,
+                                         uint64_t &last) const {
+    first = start / pageSize;
+    last = std::min(end / pageSize, pageCount - 1);
+    return first < pageCount;
+}
+
+template<unsigned maxLevel>
+void HybridRangeLock<maxLevel>::leavePages(uint64_t first, uint64_t last) {
+    for (uint64_t p = first; p <= last; ++p) {
+        pages[p].fetch_sub(1, std::memory_order_release);
+    }
+}
+
+// One increment per page of the range, see the class comment
+template<unsigned maxLevel>
+bool HybridRangeLock<maxLevel>::tryLockSlow(uint64_t start, uint64_t end) {
+    uint64_t first, last;
+    bool covered = pageSpan(start, end, first, last);
+    if (covered) {
+        for (uint64_t p = first; p <= last; ++p) {
+            if (pages[p].fetch_add(1, std::memory_order_acquire) & pageHeld) {
+                leavePages(first, p);
+                return false;
+            }
+        }
+    }
+
+    if (!list.tryLock(start + 1, end + 1)) {
+        if (covered) {
+            leavePages(first, last);
+        }
+        return false;
+    }
+    return true;
+}
+
+template<unsigned maxLevel>
+bool HybridRangeLock<maxLevel>::releaseSlow(uint64_t start, uint64_t end) {
+    if (!list.releaseLock(start + 1, end + 1)) {
+        return false;
+    }
+    uint64_t first, last;
+    if (pageSpan(start, end, first, last)) {
+        leavePages(first, last);
+    }
+    return true;
+}
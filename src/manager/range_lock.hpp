@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include "../v0/range_lock.hpp"
+
+/*
+One ConcurrentRangeLock per object, such as a file or a table, for many
+objects of which few are in use at a time. Object IDs map to entries
+holding a lock through a hash table with a fixed number of buckets, and an
+entry is only created when its object is first locked. A bucket is just the
+head of a chain of entries, so that the table stays small next to the
+entries. Changes to the chains are serialised by stripeCount mutexes, each
+guarding every stripeCount-th bucket.
+
+A lookup walks the bucket's chain without locking and pins the entry it
+finds with one increment. Pinned entries are never reclaimed, and the pin
+is dropped again when the operation returns. If the walk finds nothing, the
+entry is looked up again, and created if need be, under the stripe's mutex.
+
+Entries that hold no range and were not used since the last sweep over
+their bucket are taken out of the table, in the manner of the CLOCK page
+replacement algorithm. Every thread sweeps a few buckets every reclaimRate
+operations. A reclaimed entry keeps its empty lock and goes to a free list
+of its stripe, to be reused for the next new object there, so the skip-list
+heads and tails of idle objects are not allocated again. Entries are only
+freed by the destructor, since a lookup may still be walking through a
+reclaimed one. Keys are shifted up by one, as the head of the skip list
+takes 0, and its tail takes the largest key, so end has to be below the
+largest uint64_t minus one.
+*/
+template<unsigned maxLevel>
+class RangeLockManager {
+public:
+    static constexpr uint64_t reclaimRate = 1024;
+    static constexpr size_t sweepBuckets = 8;
+    static constexpr size_t stripeCount = 1024;
+
+    explicit RangeLockManager(size_t bucketCount = 1 << 14);
+
+    ~RangeLockManager();
+
+    bool tryLock(uint64_t object, uint64_t start, uint64_t end);
+
+    bool releaseLock(uint64_t object, uint64_t start, uint64_t end);
+
+    // Sweeps every bucket once and returns the number of entries reclaimed.
+    // An entry used since the previous sweep survives one more.
+    size_t reclaimIdle();
+
+    // Objects that currently have an entry
+    size_t objectCount() const { return liveCount.load(); }
+
+    // Entries ever allocated, live or waiting to be reused
+    size_t allocatedCount() const { return allocated.load(); }
+
+private:
+    // Set in pins while an entry is out of the table
+    static constexpr uint64_t dead = uint64_t{1} << 63;
+    // A lookup gives up on the lock-free walk after this many entries,
+    // since an entry reused meanwhile can lead it into another chain
+    static constexpr int maxProbe = 64;
+
+    struct alignas(64) Entry {
+        std::atomic<uint64_t> object{0};
+        std::atomic<uint64_t> pins{dead};
+        std::atomic<bool> referenced{false};
+        std::atomic<Entry *> next{nullptr};
+        ConcurrentRangeLock<uint64_t, maxLevel> lock;
+    };
+
+    struct alignas(64) Stripe {
+        std::mutex mutex;
+        // Reclaimed entries, linked through next
+        Entry *freeList = nullptr;
+    };
+
+    const size_t bucketMask;
+    const unsigned bucketShift;
+    std::unique_ptr<std::atomic<Entry *>[]> buckets;
+    std::unique_ptr<Stripe[]> stripes;
+    std::atomic<size_t> clockHand{0};
+    std::atomic<size_t> liveCount{0};
+    std::atomic<size_t> allocated{0};
+
+    size_t bucketOf(uint64_t object) const;
+
+    Stripe &stripeOf(size_t bucket) { return stripes[bucket % stripeCount]; }
+
+    // Returns the pinned entry of object, creating it if create is set, or
+    // nullptr if there is none
+    Entry *pinEntry(uint64_t object, bool create);
+
+    Entry *pinEntryLocked(size_t bucket, uint64_t object, bool create);
+
+    static bool pin(Entry *entry, uint64_t object);
+
+    static void unpin(Entry *entry);
+
+    size_t sweepLocked(size_t bucket);
+
+    // Counts an operation of the calling thread and sweeps every
+    // reclaimRate of them
+    void tick();
+};
+
+template<unsigned maxLevel>
+RangeLockManager<maxLevel>::RangeLockManager(size_t bucketCount)
+        : bucketMask{std::bit_ceil(std::max<size_t>(bucketCount, 2)) - 1},
+          bucketShift{64 - static_cast<unsigned>(std::popcount(bucketMask))},
+          buckets{new std::atomic<Entry *>[bucketMask + 1]()},
+          stripes{new Stripe[stripeCount]} {}
+
+template<unsigned maxLevel>
+RangeLockManager<maxLevel>::~RangeLockManager() {
+    auto deleteChain = [](Entry *entry) {
+        while (entry != nullptr) {
+            Entry *next = entry->next.load();
+            delete entry;
+            entry = next;
+        }
+    };
+    for (size_t i = 0; i <= bucketMask; ++i) {
+        deleteChain(buckets[i].load());
+    }
+    for (size_t i = 0; i < stripeCount; ++i) {
+        deleteChain(stripes[i].freeList);
+    }
+}
+
+// Fibonacci hashing, the top bits of the product spread sequential IDs
+// evenly over the buckets
+template<unsigned maxLevel>
+size_t RangeLockManager<maxLevel>::bucketOf(uint64_t object) const {
+    return (object * 0x9e3779b97f4a7c15) >> bucketShift;
+}
+
+// An entry that was reclaimed, or reused for another object, between
+// finding it and pinning it fails the checks after the increment
+template<unsigned maxLevel>
+bool RangeLockManager<maxLevel>::pin(Entry *entry, uint64_t object) {
+    uint64_t pins = entry->pins.fetch_add(1, std::memory_order_acq_rel);
+    if ((pins & dead) ||
+        entry->object.load(std::memory_order_acquire) != object) {
+        entry->pins.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+    if (!entry->referenced.load(std::memory_order_relaxed)) {
+        entry->referenced.store(true, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+template<unsigned maxLevel>
+void RangeLockManager<maxLevel>::unpin(Entry *entry) {
+    entry->pins.fetch_sub(1, std::memory_order_release);
+}
+
+template<unsigned maxLevel>
+typename RangeLockManager<maxLevel>::Entry *
+RangeLockManager<maxLevel>::pinEntry(uint64_t object, bool create) {
+    size_t bucket = bucketOf(object);
+    Entry *entry = buckets[bucket].load(std::memory_order_acquire);
+    for (int probes = 0; entry != nullptr && probes < maxProbe; ++probes) {
+        if (entry->object.load(std::memory_order_acquire) == object) {
+            if (pin(entry, object)) {
+                return entry;
+            }
+            break;
+        }
+        entry = entry->next.load(std::memory_order_acquire);
+    }
+
+    std::lock_guard<std::mutex> lock(stripeOf(bucket).mutex);
+    return pinEntryLocked(bucket, object, create);
+}
+
+// The chain only changes under the stripe's mutex, and an entry is never
+// dead while it is in the chain and the mutex is held
+template<unsigned maxLevel>
+typename RangeLockManager<maxLevel>::Entry *
+RangeLockManager<maxLevel>::pinEntryLocked(size_t bucket, uint64_t object,
+                                           bool create) {
+    for (Entry *entry = buckets[bucket].load(std::memory_order_relaxed);
+         entry != nullptr;
+         entry = entry->next.load(std::memory_order_relaxed)) {
+        if (entry->object.load(std::memory_order_relaxed) == object) {
+            pin(entry, object);
+            return entry;
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+
+    Stripe &stripe = stripeOf(bucket);
+    Entry *entry = stripe.freeList;
+    if (entry != nullptr) {
+        stripe.freeList = entry->next.load(std::memory_order_relaxed);
+    } else {
+        entry = new Entry();
+        allocated.fetch_add(1, std::memory_order_relaxed);
+    }
+    entry->object.store(object, std::memory_order_relaxed);
+    entry->referenced.store(true, std::memory_order_relaxed);
+    entry->next.store(buckets[bucket].load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+    // Leaves the increments of lookups that are about to back out alone
+    entry->pins.fetch_sub(dead - 1, std::memory_order_release);
+    buckets[bucket].store(entry, std::memory_order_release);
+    liveCount.fetch_add(1, std::memory_order_relaxed);
+    return entry;
+}
+
+template<unsigned maxLevel>
+bool RangeLockManager<maxLevel>::tryLock(uint64_t object, uint64_t start,
+                                         uint64_t end) {
+    if (start > end || end >= std::numeric_limits<uint64_t>::max() - 1) {
+        std::cerr << "Invalid range " << start << " " << end << std::endl;
+        return false;
+    }
+    Entry *entry = pinEntry(object, true);
+    bool locked = entry->lock.tryLock(start + 1, end + 1);
+    unpin(entry);
+    tick();
+    return locked;
+}
+
+template<unsigned maxLevel>
+bool RangeLockManager<maxLevel>::releaseLock(uint64_t object, uint64_t start,
+                                             uint64_t end) {
+    if (start > end || end >= std::numeric_limits<uint64_t>::max() - 1) {
+        std::cerr << "Invalid range " << start << " " << end << std::endl;
+        return false;
+    }
+    Entry *entry = pinEntry(object, false);
+    if (entry == nullptr) {
+        std::cerr << "Range not held. Wrong usage of releaseLock. " << object
+                  << " " << start << " " << end << std::endl;
+        return false;
+    }
+    bool released = entry->lock.releaseLock(start + 1, end + 1);
+    unpin(entry);
+    tick();
+    return released;
+}
+
+template<unsigned maxLevel>
+void RangeLockManager<maxLevel>::tick() {
+    thread_local uint64_t operations = 0;
+    if (++operations % reclaimRate != 0) {
+        return;
+    }
+    size_t first = clockHand.fetch_add(sweepBuckets, std::memory_order_relaxed);
+    for (size_t i = first; i < first + sweepBuckets; ++i) {
+        size_t bucket = i & bucketMask;
+        Stripe &stripe = stripeOf(bucket);
+        if (stripe.mutex.try_lock()) {
+            sweepLocked(bucket);
+            stripe.mutex.unlock();
+        }
+    }
+}
+
+template<unsigned maxLevel>
+size_t RangeLockManager<maxLevel>::reclaimIdle() {
+    size_t reclaimed = 0;
+    for (size_t i = 0; i <= bucketMask; ++i) {
+        std::lock_guard<std::mutex> lock(stripeOf(i).mutex);
+        reclaimed += sweepLocked(i);
+    }
+    return reclaimed;
+}
+
+// An unpinned entry is made dead before its lock is checked for ranges, so
+// that no operation can start on it meanwhile
+template<unsigned maxLevel>
+size_t RangeLockManager<maxLevel>::sweepLocked(size_t bucket) {
+    Stripe &stripe = stripeOf(bucket);
+    size_t reclaimed = 0;
+    std::atomic<Entry *> *link = &buckets[bucket];
+    Entry *entry = link->load(std::memory_order_relaxed);
+    while (entry != nullptr) {
+        Entry *next = entry->next.load(std::memory_order_relaxed);
+        uint64_t unpinned = 0;
+        if (entry->referenced.load(std::memory_order_relaxed)) {
+            entry->referenced.store(false, std::memory_order_relaxed);
+        } else if (entry->pins.compare_exchange_strong(
+                           unpinned, dead, std::memory_order_acquire,
+                           std::memory_order_relaxed)) {
+            if (entry->lock.size() == 0) {
+                // Lookups already on the entry walk on into the free list
+                // at worst, where nothing can be pinned
+                link->store(next, std::memory_order_release);
+                entry->next.store(stripe.freeList, std::memory_order_relaxed);
+                stripe.freeList = entry;
+                liveCount.fetch_sub(1, std::memory_order_relaxed);
+                ++reclaimed;
+                entry = next;
+                continue;
+            }
+            entry->pins.fetch_sub(dead, std::memory_order_release);
+        }
+        link = &entry->next;
+        entry = next;
+    }
+    return reclaimed;
+}
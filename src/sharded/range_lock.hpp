@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Front-end that partitions the key space into stripes, each served by a
+// Backend instance of its own, so that threads working in different parts of
+// the key space never share a list. Backend is any range lock over closed
+// ranges from key 0 with tryLock(start, end) and releaseLock(start, end) or
+// releaseLock(start), such as SongRangeLock (v3), or one of the adapters
+// below: ShiftedBackend over ConcurrentRangeLock (v0), and HalfOpenBackend
+// over ConcurrentRangeLock_V1 or ListRLLock (v2). A range crossing stripe
+// boundaries is locked piece by piece in stripe order, all or nothing.
+//
+// Stripe boundaries follow the load. Every SAMPLE_RATE-th acquire of a
+// thread is counted in a histogram over the key space, and after
+// REBALANCE_SAMPLES samples the boundaries are moved toward equal shares of
+// them. Moving a boundary hands the keys between its old and new position
+// to the neighbouring stripe, which is only safe while no range is held
+// there: the rebalancer holds a guard range over those keys in the stripe
+// that gives them up while it publishes the boundary, and leaves the
+// boundary in place if the guard conflicts. Acquires read the boundaries
+// under a sequence counter and retry if they moved in between.
+// Adapts a closed-range lock whose head takes key 0, like
+// ConcurrentRangeLock (v0), by shifting keys up by one. The tail takes the
+// largest key, so end has to be below the largest uint64_t minus one.
+template <typename Lock>
+class ShiftedBackend {
+   public:
+    bool tryLock(uint64_t start, uint64_t end) {
+        return Valid(start, end) && lock_.tryLock(start + 1, end + 1);
+    }
+    bool releaseLock(uint64_t start, uint64_t end) {
+        return Valid(start, end) && lock_.releaseLock(start + 1, end + 1);
+    }
+    size_t size() { return lock_.size(); }
+
+   private:
+    static bool Valid(uint64_t start, uint64_t end) {
+        if (start > end || end >= std::numeric_limits<uint64_t>::max() - 1) {
+            std::cerr << "Invalid range " << start << " " << end << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    Lock lock_;
+};
+
+// Adapts a lock over half-open ranges, like ConcurrentRangeLock_V1 or
+// ListRLLock (v2), by passing [start, end + 1). v1 keeps a tail at the
+// largest key, so end has to be below the largest uint64_t minus one. v1
+// also takes the end it is given as a key of the range when it looks for
+// conflicts, so there a range fails against one held right after it. That
+// only costs a spurious failure, never mutual exclusion.
+template <typename Lock>
+class HalfOpenBackend {
+   public:
+    bool tryLock(uint64_t start, uint64_t end) {
+        return Valid(start, end) && lock_.tryLock(start, end + 1);
+    }
+    bool releaseLock(uint64_t start, uint64_t end) {
+        return Valid(start, end) && lock_.releaseLock(start, end + 1);
+    }
+    size_t size() { return lock_.size(); }
+
+   private:
+    static bool Valid(uint64_t start, uint64_t end) {
+        if (start > end || end >= std::numeric_limits<uint64_t>::max() - 1) {
+            std::cerr << "Invalid range " << start << " " << end << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    Lock lock_;
+};
+
+template <typename Backend>
+class ShardedRangeLock {
+   public:
+    static constexpr size_t HISTOGRAM_BUCKETS = 1024;
+    static constexpr uint64_t SAMPLE_RATE = 64;
+    static constexpr uint64_t REBALANCE_SAMPLES = 1 << 12;
+
+    // Keys are expected in [0, keySpace). Larger keys all fall into the last
+    // stripe and histogram bucket. stripes is raised to at least 1, and
+    // keySpace to at least stripes, so that every stripe gets a key.
+    ShardedRangeLock(size_t stripes, uint64_t keySpace,
+                     bool autoRebalance = true);
+
+    bool tryLock(uint64_t start, uint64_t end);
+    void releaseLock(uint64_t start, uint64_t end);
+
+    // Moves the boundaries toward equal shares of the sampled acquires and
+    // halves the histogram. Returns the number of boundaries moved.
+    size_t rebalance();
+
+    size_t stripes() const { return stripes_; }
+
+    // First key of stripe i, 0 < i < stripes()
+    uint64_t boundary(size_t i) const {
+        return bounds_[i - 1].load(std::memory_order_acquire);
+    }
+
+    Backend &stripe(size_t i) { return shards_[i]; }
+
+   private:
+    size_t StripeOf(uint64_t key) const;
+    std::pair<uint64_t, uint64_t> Piece(size_t stripe, uint64_t start,
+                                        uint64_t end) const;
+    uint64_t ReadBegin() const;
+    bool Validate(uint64_t version) const;
+    void ReleasePiece(size_t stripe, uint64_t start, uint64_t end);
+    void Sample(uint64_t key);
+    size_t RebalanceLocked();
+
+    const size_t stripes_;
+    const uint64_t keySpace_;
+    const uint64_t bucketWidth_;
+    const bool autoRebalance_;
+    std::unique_ptr<Backend[]> shards_;
+    // bounds_[i] is the first key of stripe i + 1
+    std::unique_ptr<std::atomic<uint64_t>[]> bounds_;
+    std::atomic<uint64_t> version_{0};
+    std::unique_ptr<std::atomic<uint64_t>[]> histogram_;
+    std::atomic<uint64_t> samples_{0};
+    std::mutex rebalanceMutex_;
+};
+
+template <typename Backend>
+ShardedRangeLock<Backend>::ShardedRangeLock(size_t stripes, uint64_t keySpace,
+                                            bool autoRebalance)
+    : stripes_(std::max<size_t>(stripes, 1)),
+      keySpace_(std::max<uint64_t>(keySpace, stripes_)),
+      bucketWidth_(std::max<uint64_t>(keySpace_ / HISTOGRAM_BUCKETS, 1)),
+      autoRebalance_(autoRebalance),
+      shards_(new Backend[stripes_]),
+      bounds_(new std::atomic<uint64_t>[stripes_ - 1]),
+      histogram_(new std::atomic<uint64_t>[HISTOGRAM_BUCKETS]()) {
+    for (size_t i = 1; i < stripes_; ++i) {
+        bounds_[i - 1].store(keySpace_ / stripes_ * i);
+    }
+}
+
+template <typename Backend>
+size_t ShardedRangeLock<Backend>::StripeOf(uint64_t key) const {
+    size_t lo = 0, hi = stripes_ - 1;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (key < bounds_[mid].load(std::memory_order_relaxed)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// The part of [start, end] that falls into the given stripe
+template <typename Backend>
+std::pair<uint64_t, uint64_t> ShardedRangeLock<Backend>::Piece(
+    size_t stripe, uint64_t start, uint64_t end) const {
+    if (stripe > 0) {
+        start = std::max(start,
+                         bounds_[stripe - 1].load(std::memory_order_relaxed));
+    }
+    if (stripe < stripes_ - 1) {
+        end = std::min(end,
+                       bounds_[stripe].load(std::memory_order_relaxed) - 1);
+    }
+    return {start, end};
+}
+
+// Waits until no boundary is being moved and returns the sequence counter
+template <typename Backend>
+uint64_t ShardedRangeLock<Backend>::ReadBegin() const {
+    uint64_t version = version_.load(std::memory_order_acquire);
+    while (version & 1) {
+        std::this_thread::yield();
+        version = version_.load(std::memory_order_acquire);
+    }
+    return version;
+}
+
+template <typename Backend>
+bool ShardedRangeLock<Backend>::Validate(uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+}
+
+template <typename Backend>
+void ShardedRangeLock<Backend>::ReleasePiece(size_t stripe, uint64_t start,
+                                             uint64_t end) {
+    if constexpr (requires(Backend &b) { b.releaseLock(start, end); }) {
+        shards_[stripe].releaseLock(start, end);
+    } else {
+        shards_[stripe].releaseLock(start);
+    }
+}
+
+template <typename Backend>
+bool ShardedRangeLock<Backend>::tryLock(uint64_t start, uint64_t end) {
+    thread_local std::vector<std::pair<uint64_t, uint64_t>> pieces;
+    while (true) {
+        uint64_t version = ReadBegin();
+        size_t first = StripeOf(start);
+        size_t last = StripeOf(end);
+
+        pieces.clear();
+        for (size_t k = first; k <= last; ++k) {
+            pieces.push_back(Piece(k, start, end));
+        }
+        if (!Validate(version)) {
+            continue;
+        }
+
+        size_t locked = 0;
+        while (locked < pieces.size() &&
+               shards_[first + locked].tryLock(pieces[locked].first,
+                                               pieces[locked].second)) {
+            ++locked;
+        }
+
+        // A boundary that moved meanwhile may have put a piece in the wrong
+        // stripe, or a conflict may have been with a rebalancing guard
+        bool stable = Validate(version);
+        if (locked == pieces.size() && stable) {
+            Sample(start);
+            return true;
+        }
+        for (size_t k = 0; k < locked; ++k) {
+            ReleasePiece(first + k, pieces[k].first, pieces[k].second);
+        }
+        if (stable) {
+            return false;
+        }
+    }
+}
+
+// A held range pins the boundaries it lies across or next to, so the
+// pieces come out the same as when the range was locked
+template <typename Backend>
+void ShardedRangeLock<Backend>::releaseLock(uint64_t start, uint64_t end) {
+    size_t first, last;
+    uint64_t version;
+    do {
+        version = ReadBegin();
+        first = StripeOf(start);
+        last = StripeOf(end);
+    } while (!Validate(version));
+
+    for (size_t k = first; k <= last; ++k) {
+        auto piece = Piece(k, start, end);
+        ReleasePiece(k, piece.first, piece.second);
+    }
+}
+
+template <typename Backend>
+void ShardedRangeLock<Backend>::Sample(uint64_t key) {
+    thread_local uint64_t acquires = 0;
+    if (++acquires % SAMPLE_RATE != 0) {
+        return;
+    }
+
+    size_t bucket = std::min<uint64_t>(key / bucketWidth_,
+                                       HISTOGRAM_BUCKETS - 1);
+    histogram_[bucket].fetch_add(1, std::memory_order_relaxed);
+    uint64_t samples = samples_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (autoRebalance_ && samples % REBALANCE_SAMPLES == 0 &&
+        rebalanceMutex_.try_lock()) {
+        RebalanceLocked();
+        rebalanceMutex_.unlock();
+    }
+}
+
+template <typename Backend>
+size_t ShardedRangeLock<Backend>::rebalance() {
+    std::lock_guard<std::mutex> lock(rebalanceMutex_);
+    return RebalanceLocked();
+}
+
+template <typename Backend>
+size_t ShardedRangeLock<Backend>::RebalanceLocked() {
+    std::vector<uint64_t> counts(HISTOGRAM_BUCKETS);
+    uint64_t total = 0;
+    for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+        counts[b] = histogram_[b].load(std::memory_order_relaxed);
+        total += counts[b];
+        // Halving lets the boundaries follow a shifting load
+        histogram_[b].fetch_sub(counts[b] / 2, std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    size_t moved = 0;
+    uint64_t prefix = 0;
+    size_t bucket = 0;
+    for (size_t i = 1; i < stripes_; ++i) {
+        // Cut after the bucket that reaches the i-th share of the samples
+        while (bucket < HISTOGRAM_BUCKETS && prefix * stripes_ < total * i) {
+            prefix += counts[bucket++];
+        }
+        uint64_t target = bucket * bucketWidth_;
+
+        // Every stripe keeps at least one key
+        uint64_t lower = i > 1 ? boundary(i - 1) + 1 : 1;
+        uint64_t upper = i < stripes_ - 1 ? boundary(i + 1) - 1 : ~0ULL;
+        target = std::clamp(target, lower, upper);
+        uint64_t old = boundary(i);
+        if (target == old) {
+            continue;
+        }
+
+        // The keys between old and target change stripe, guard them in the
+        // stripe that gives them up. Acquires see an odd counter throughout
+        // and retry, so none of them fails on the guard.
+        size_t losing = target > old ? i : i - 1;
+        uint64_t guardStart = std::min(old, target);
+        uint64_t guardEnd = std::max(old, target) - 1;
+        uint64_t version = version_.load(std::memory_order_relaxed);
+        version_.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        if (shards_[losing].tryLock(guardStart, guardEnd)) {
+            bounds_[i - 1].store(target, std::memory_order_relaxed);
+            ReleasePiece(losing, guardStart, guardEnd);
+            ++moved;
+        }
+        version_.store(version + 2, std::memory_order_release);
+    }
+    return moved;
+}
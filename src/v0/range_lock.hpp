@@ -1,3 +1,5 @@
+#pragma once
+
 #include <atomic>
 #include <climits>
 #include <cstdlib>
@@ -31,12 +33,45 @@ public:
     Node<T> *tail;
     Node<T> *head;
 
+    /*
+    Read-only iterator over the ranges held within a window [lo, hi]. It
+    never takes a lock, never helps to snip marked nodes and never writes to
+    shared memory, so it cannot block or slow down writers. Ranges that are
+    released while iterating are skipped once their mark is visible; ranges
+    inserted behind the iterator are not seen.
+    */
+    class SnapshotIterator {
+    public:
+        SnapshotIterator(const ConcurrentRangeLock *crl, T lo, T hi);
+
+        bool valid() const;
+
+        void next();
+
+        T getStart() const;
+
+        T getEnd() const;
+
+    private:
+        const Node<T> *tail;
+        const Node<T> *curr;
+        T hi;
+
+        void skipMarked();
+    };
+
     ConcurrentRangeLock();
 
     bool tryLock(T start, T end);
 
     bool releaseLock(T start, T end);
 
+    SnapshotIterator snapshot(T lo, T hi) const;
+
+    bool anyOverlap(T start, T end) const;
+
+    bool isLocked(T key) const;
+
     size_t size();
 
     void displayList();
@@ -138,7 +173,7 @@ bool ConcurrentRangeLock<T, maxLevel>::findExact(T start, T end,
                     curr = pred->next[level]->getReference();
                     succ = curr->next[level]->get(marked);
                 }
-                if (start >= curr->getEnd()) {
+                if (start > curr->getEnd()) {
                     pred = curr;
                     curr = succ;
                 } else {
@@ -178,7 +213,7 @@ void ConcurrentRangeLock<T, maxLevel>::findDelete(T start, T end) {
                     curr = pred->next[level]->getReference();
                     succ = curr->next[level]->get(marked);
                 }
-                if (start >= curr->getEnd()) {
+                if (start > curr->getEnd()) {
                     pred = curr;
                     curr = succ;
                 } else {
@@ -283,6 +318,77 @@ bool ConcurrentRangeLock<T, maxLevel>::releaseLock(T start, T end) {
     }
 }
 
+template<typename T, unsigned maxLevel>
+typename ConcurrentRangeLock<T, maxLevel>::SnapshotIterator
+ConcurrentRangeLock<T, maxLevel>::snapshot(T lo, T hi) const {
+    return SnapshotIterator(this, lo, hi);
+}
+
+/*
+Reports whether any held range overlaps [start, end]. Like the snapshot
+iterator it does a single read-only descent: marked nodes are stepped over
+instead of snipped, so a query never writes to shared memory.
+*/
+template<typename T, unsigned maxLevel>
+bool ConcurrentRangeLock<T, maxLevel>::anyOverlap(T start, T end) const {
+    return SnapshotIterator(this, start, end).valid();
+}
+
+template<typename T, unsigned maxLevel>
+bool ConcurrentRangeLock<T, maxLevel>::isLocked(T key) const {
+    return anyOverlap(key, key);
+}
+
+template<typename T, unsigned maxLevel>
+ConcurrentRangeLock<T, maxLevel>::SnapshotIterator::SnapshotIterator(
+        const ConcurrentRangeLock *crl, T lo, T hi)
+        : tail{crl->tail}, hi{hi} {
+    // Seek to the first range ending at or after lo. Ranges are disjoint,
+    // so ordering by end is the same as ordering by start.
+    const Node<T> *pred = crl->head;
+    for (int level = maxLevel; level >= 0; level--) {
+        curr = pred->next[level]->getReference();
+        while (curr != tail && curr->getEnd() < lo) {
+            pred = curr;
+            curr = pred->next[level]->getReference();
+        }
+    }
+    skipMarked();
+}
+
+template<typename T, unsigned maxLevel>
+void ConcurrentRangeLock<T, maxLevel>::SnapshotIterator::skipMarked() {
+    bool marked[1] = {false};
+    while (curr != tail && curr->getStart() <= hi) {
+        const Node<T> *succ = curr->next[0]->get(marked);
+        if (!marked[0]) {
+            return;
+        }
+        curr = succ;
+    }
+}
+
+template<typename T, unsigned maxLevel>
+bool ConcurrentRangeLock<T, maxLevel>::SnapshotIterator::valid() const {
+    return curr != tail && curr->getStart() <= hi;
+}
+
+template<typename T, unsigned maxLevel>
+void ConcurrentRangeLock<T, maxLevel>::SnapshotIterator::next() {
+    curr = curr->next[0]->getReference();
+    skipMarked();
+}
+
+template<typename T, unsigned maxLevel>
+T ConcurrentRangeLock<T, maxLevel>::SnapshotIterator::getStart() const {
+    return curr->getStart();
+}
+
+template<typename T, unsigned maxLevel>
+T ConcurrentRangeLock<T, maxLevel>::SnapshotIterator::getEnd() const {
+    return curr->getEnd();
+}
+
 template<typename T, unsigned maxLevel>
 void ConcurrentRangeLock<T, maxLevel>::displayList() {
     std::cout << "Concurrent Range Lock" << std::endl;
@@ -1,6 +1,7 @@
 #pragma once
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <iostream>
@@ -9,20 +10,95 @@
 #include <new>
 #include <thread>
 
+// Node lock policies. Besides the lock itself, each policy owns the
+// node's marked and fullyLinked flags, which are read without holding
+// the lock and therefore have to be atomic.
+
+// std::mutex next to two atomic flags. Parks waiting threads.
+class MutexLock {
+   public:
+    void lock() { mutex.lock(); }
+
+    void unlock() { mutex.unlock(); }
+
+    bool isMarked() const { return marked.load(std::memory_order_acquire); }
+
+    void setMarked() { marked.store(true, std::memory_order_release); }
+
+    bool isFullyLinked() const {
+        return fullyLinked.load(std::memory_order_acquire);
+    }
+
+    void setFullyLinked() {
+        fullyLinked.store(true, std::memory_order_release);
+    }
+
+   private:
+    std::mutex mutex;
+    std::atomic<bool> marked{false};
+    std::atomic<bool> fullyLinked{false};
+};
+
+// Test-and-test-and-set spinlock packed into one word together with the
+// flags: bit 0 is the lock, bit 1 marked and bit 2 fullyLinked.
+class SpinLock {
+   public:
+    void lock() {
+        while (true) {
+            uint32_t expected = word.load(std::memory_order_relaxed);
+            if ((expected & LOCKED) == 0 &&
+                word.compare_exchange_weak(expected, expected | LOCKED,
+                                           std::memory_order_acquire)) {
+                return;
+            }
+            while (word.load(std::memory_order_relaxed) & LOCKED) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void unlock() { word.fetch_and(~LOCKED, std::memory_order_release); }
+
+    bool isMarked() const {
+        return word.load(std::memory_order_acquire) & MARKED;
+    }
+
+    void setMarked() { word.fetch_or(MARKED, std::memory_order_release); }
+
+    bool isFullyLinked() const {
+        return word.load(std::memory_order_acquire) & FULLY_LINKED;
+    }
+
+    void setFullyLinked() {
+        word.fetch_or(FULLY_LINKED, std::memory_order_release);
+    }
+
+   private:
+    static constexpr uint32_t LOCKED = 0x1;
+    static constexpr uint32_t MARKED = 0x2;
+    static constexpr uint32_t FULLY_LINKED = 0x4;
+
+    std::atomic<uint32_t> word{0};
+};
+
+// Version lock: one word whose low bits hold the lock and the flags, and
+// whose remaining bits count how often the node was unlocked. Readers can
+// take a version, read the node without locking it and validate that the
+// version did not change in the meantime.
 class OptimisticMutex {
    public:
     OptimisticMutex() : version(0) {}
 
     void lock() {
-        int expectedVersion;
+        uint64_t expectedVersion;
         while (true) {
             expectedVersion = version.load(std::memory_order_acquire);
 
-            // Check if the lock is free (even version number)
-            if ((expectedVersion & 1) == 0) {
-                // Try to acquire the lock by incrementing the version number
+            // Check if the lock is free
+            if ((expectedVersion & LOCKED) == 0) {
+                // Try to acquire the lock by setting the lock bit
                 if (version.compare_exchange_strong(
-                        expectedVersion, expectedVersion + 1,
+                        expectedVersion, expectedVersion | LOCKED,
                         std::memory_order_acq_rel)) {
                     break;  // Acquired the lock
                 }
@@ -34,19 +110,69 @@ class OptimisticMutex {
     }
 
     void unlock() {
-        // Increment the version number to release the lock
-        version.fetch_add(1, std::memory_order_release);
+        // Clear the lock bit and bump the version in one step
+        version.fetch_add(VERSION_STEP - LOCKED, std::memory_order_release);
+    }
+
+    // Returns the current version, waiting while the node is locked
+    uint64_t readVersion() const {
+        uint64_t current;
+        while ((current = version.load(std::memory_order_acquire)) & LOCKED) {
+            std::this_thread::yield();
+        }
+        return current & ~FLAGS;
+    }
+
+    // True if the node was not locked since readVersion returned expected
+    bool validate(uint64_t expected) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return (version.load(std::memory_order_relaxed) & ~FLAGS) == expected;
+    }
+
+    // Takes the lock only if the node was not locked since readVersion
+    // returned expected. Never waits, so it cannot deadlock.
+    bool tryUpgrade(uint64_t expected) {
+        uint64_t current = version.load(std::memory_order_relaxed);
+        while ((current & ~FLAGS) == expected) {
+            if (version.compare_exchange_weak(current, current | LOCKED,
+                                              std::memory_order_acquire)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool isMarked() const {
+        return version.load(std::memory_order_acquire) & MARKED;
+    }
+
+    void setMarked() { version.fetch_or(MARKED, std::memory_order_release); }
+
+    bool isFullyLinked() const {
+        return version.load(std::memory_order_acquire) & FULLY_LINKED;
+    }
+
+    void setFullyLinked() {
+        version.fetch_or(FULLY_LINKED, std::memory_order_release);
     }
 
    private:
-    std::atomic<int> version;
+    static constexpr uint64_t LOCKED = 0x1;
+    static constexpr uint64_t MARKED = 0x2;
+    static constexpr uint64_t FULLY_LINKED = 0x4;
+    static constexpr uint64_t FLAGS = MARKED | FULLY_LINKED;
+    static constexpr uint64_t VERSION_STEP = 0x8;
+
+    std::atomic<uint64_t> version;
 };
 
 constexpr uint64_t CacheLineSize = 64;
 
-template <typename T>
+template <typename T, typename Lock = MutexLock>
 struct alignas(CacheLineSize) Node_V1 {
-    Node_V1(T start, T end, int level);
+    // Allocates the node and its tower of next pointers as one block, so
+    // that inserting a range costs exactly one allocation.
+    static Node_V1 *create(T start, T end, int level);
     ~Node_V1();
 
     int getTopLevel() const;
@@ -54,52 +180,105 @@ struct alignas(CacheLineSize) Node_V1 {
     T getEnd() const;
 
     Node_V1 **next;
-    bool marked = false;
-    bool fullyLinked = false;
+
+    bool isMarked() const;
+    void setMarked();
+    bool isFullyLinked() const;
+    void setFullyLinked();
 
     void lock();
     void unlock();
 
+    // only available with a version lock policy such as OptimisticMutex
+    uint64_t readVersion() const;
+    bool validate(uint64_t version) const;
+    bool tryUpgrade(uint64_t version);
+
    private:
+    Node_V1(T start, T end, int level);
+
     T start;
     T end;
     int topLevel;
-    // OptimisticMutex mutex;
-    std::mutex mutex;
+    Lock mutex;
 };
 
-template <typename T>
-Node_V1<T>::Node_V1(T start, T end, int level)
+template <typename T, typename Lock>
+Node_V1<T, Lock> *Node_V1<T, Lock>::create(T start, T end, int level) {
+    void *memory = ::operator new(
+        sizeof(Node_V1<T, Lock>) + (level + 1) * sizeof(Node_V1<T, Lock> *),
+        std::align_val_t{CacheLineSize});
+    return new (memory) Node_V1<T, Lock>(start, end, level);
+}
+
+template <typename T, typename Lock>
+Node_V1<T, Lock>::Node_V1(T start, T end, int level)
     : start{start}, end{end}, topLevel{level} {
-    next = new Node_V1<T> *[level + 1];
+    // the tower lives right behind the node, see create()
+    next = reinterpret_cast<Node_V1<T, Lock> **>(this + 1);
 }
 
-template <typename T>
-Node_V1<T>::~Node_V1() {
+template <typename T, typename Lock>
+Node_V1<T, Lock>::~Node_V1() {
     // delete next;
 }
 
-template <typename T>
-void Node_V1<T>::lock() {
+template <typename T, typename Lock>
+void Node_V1<T, Lock>::lock() {
     mutex.lock();
 }
 
-template <typename T>
-void Node_V1<T>::unlock() {
+template <typename T, typename Lock>
+void Node_V1<T, Lock>::unlock() {
     mutex.unlock();
 }
 
-template <typename T>
-int Node_V1<T>::getTopLevel() const {
+template <typename T, typename Lock>
+uint64_t Node_V1<T, Lock>::readVersion() const {
+    return mutex.readVersion();
+}
+
+template <typename T, typename Lock>
+bool Node_V1<T, Lock>::validate(uint64_t version) const {
+    return mutex.validate(version);
+}
+
+template <typename T, typename Lock>
+bool Node_V1<T, Lock>::tryUpgrade(uint64_t version) {
+    return mutex.tryUpgrade(version);
+}
+
+template <typename T, typename Lock>
+bool Node_V1<T, Lock>::isMarked() const {
+    return mutex.isMarked();
+}
+
+template <typename T, typename Lock>
+void Node_V1<T, Lock>::setMarked() {
+    mutex.setMarked();
+}
+
+template <typename T, typename Lock>
+bool Node_V1<T, Lock>::isFullyLinked() const {
+    return mutex.isFullyLinked();
+}
+
+template <typename T, typename Lock>
+void Node_V1<T, Lock>::setFullyLinked() {
+    mutex.setFullyLinked();
+}
+
+template <typename T, typename Lock>
+int Node_V1<T, Lock>::getTopLevel() const {
     return topLevel;
 }
 
-template <typename T>
-T Node_V1<T>::getStart() const {
+template <typename T, typename Lock>
+T Node_V1<T, Lock>::getStart() const {
     return start;
 }
 
-template <typename T>
-T Node_V1<T>::getEnd() const {
+template <typename T, typename Lock>
+T Node_V1<T, Lock>::getEnd() const {
     return end;
-}
\ No newline at end of file
+}
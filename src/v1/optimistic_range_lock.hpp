@@ -0,0 +1,305 @@
+#pragma once
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <limits>
+
+#include "node.hpp"
+
+// Optimistic variant of ConcurrentRangeLock_V1. Nodes carry a version lock
+// (OptimisticMutex) instead of a plain mutex. tryLock and releaseLock
+// validate their predecessors by reading versions, and only upgrade the
+// ones they are about to modify to write locks once validation succeeded.
+// A failed validation retries without ever having taken a lock, and
+// readers such as searchLock never write to shared memory.
+template <typename T, unsigned maxLevel>
+struct OptimisticRangeLock_V1 {
+   public:
+    OptimisticRangeLock_V1();
+    ~OptimisticRangeLock_V1();
+    unsigned generateRandomLevel();
+
+    bool searchLock(T, T);
+    bool anyOverlap(T, T);
+    bool isLocked(T);
+    bool tryLock(T, T);
+    bool releaseLock(T, T);
+    size_t size();
+
+   private:
+    using Node = Node_V1<T, OptimisticMutex>;
+
+    std::atomic<size_t> elementsCount{0};
+
+    Node *head;
+    Node *tail;
+
+    int findInsert(T start, T end, Node **preds, Node **succs);
+    int findExact(T start, T end, Node **preds, Node **succs);
+
+    bool lockPredecessors(Node **preds, const uint64_t *versions,
+                          int topLevel);
+    void unlockPredecessors(Node **preds, int topLevel);
+};
+
+template <typename T, unsigned maxLevel>
+size_t OptimisticRangeLock_V1<T, maxLevel>::size() {
+    return this->elementsCount.load(std::memory_order_relaxed);
+}
+
+template <typename T, unsigned maxLevel>
+OptimisticRangeLock_V1<T, maxLevel>::OptimisticRangeLock_V1() {
+    std::srand(std::time(0));
+
+    auto min = std::numeric_limits<T>::min();
+    auto max = std::numeric_limits<T>::max();
+
+    head = Node::create(min, min, maxLevel);
+    tail = Node::create(max, max, maxLevel);
+
+    for (unsigned level = 0; level <= maxLevel; ++level) {
+        head->next[level] = tail;
+    }
+}
+
+template <typename T, unsigned maxLevel>
+OptimisticRangeLock_V1<T, maxLevel>::~OptimisticRangeLock_V1() {}
+
+template <typename T, unsigned maxLevel>
+unsigned OptimisticRangeLock_V1<T, maxLevel>::generateRandomLevel() {
+    unsigned level = 1;
+    while (rand() % 2 == 0 && level < maxLevel) {
+        ++level;
+    }
+    return level;
+}
+
+template <typename T, unsigned maxLevel>
+int OptimisticRangeLock_V1<T, maxLevel>::findInsert(T start, T end,
+                                                    Node **preds,
+                                                    Node **succs) {
+    int levelFound = -1;
+    Node *pred = head;
+
+    for (int level = maxLevel; level >= 0; level--) {
+        Node *curr = pred->next[level];
+
+        while (start >= curr->getEnd()) {
+            pred = curr;
+            curr = pred->next[level];
+        }
+
+        if (levelFound == -1 && end >= curr->getStart()) {
+            levelFound = level;
+        }
+
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+
+    return levelFound;
+}
+
+template <typename T, unsigned maxLevel>
+int OptimisticRangeLock_V1<T, maxLevel>::findExact(T start, T end,
+                                                   Node **preds,
+                                                   Node **succs) {
+    int levelFound = -1;
+    Node *pred = head;
+
+    for (int level = maxLevel; level >= 0; level--) {
+        Node *curr = pred->next[level];
+
+        while (start >= curr->getEnd()) {
+            pred = curr;
+            curr = pred->next[level];
+        }
+
+        if (levelFound == -1 && start == curr->getStart() &&
+            end == curr->getEnd()) {
+            levelFound = level;
+        }
+
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+
+    return levelFound;
+}
+
+// Upgrades each distinct predecessor to a write lock, provided its version
+// is still the one validation read. The same node can be the predecessor on
+// several consecutive levels, it is locked once. On failure every lock taken
+// so far is released again.
+template <typename T, unsigned maxLevel>
+bool OptimisticRangeLock_V1<T, maxLevel>::lockPredecessors(
+    Node **preds, const uint64_t *versions, int topLevel) {
+    for (int level = 0; level <= topLevel; ++level) {
+        if (level > 0 && preds[level] == preds[level - 1]) {
+            if (versions[level] == versions[level - 1]) {
+                continue;
+            }
+        } else if (preds[level]->tryUpgrade(versions[level])) {
+            continue;
+        }
+        unlockPredecessors(preds, level - 1);
+        return false;
+    }
+    return true;
+}
+
+template <typename T, unsigned maxLevel>
+void OptimisticRangeLock_V1<T, maxLevel>::unlockPredecessors(Node **preds,
+                                                             int topLevel) {
+    for (int level = topLevel; level >= 0; --level) {
+        if (level == 0 || preds[level] != preds[level - 1]) {
+            preds[level]->unlock();
+        }
+    }
+}
+
+template <typename T, unsigned maxLevel>
+bool OptimisticRangeLock_V1<T, maxLevel>::searchLock(T start, T end) {
+    Node *preds[maxLevel + 1];
+    Node *succs[maxLevel + 1];
+
+    int levelFound = findExact(start, end, preds, succs);
+
+    return (levelFound != -1 && succs[levelFound]->isFullyLinked() &&
+            !succs[levelFound]->isMarked());
+}
+
+template <typename T, unsigned maxLevel>
+bool OptimisticRangeLock_V1<T, maxLevel>::anyOverlap(T start, T end) {
+    Node *pred = head;
+    Node *curr = nullptr;
+
+    for (int level = maxLevel; level >= 0; level--) {
+        curr = pred->next[level];
+
+        while (start >= curr->getEnd()) {
+            pred = curr;
+            curr = pred->next[level];
+        }
+    }
+
+    for (; curr != tail && end >= curr->getStart(); curr = curr->next[0]) {
+        if (!curr->isMarked()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T, unsigned maxLevel>
+bool OptimisticRangeLock_V1<T, maxLevel>::isLocked(T key) {
+    return anyOverlap(key, key);
+}
+
+template <typename T, unsigned maxLevel>
+bool OptimisticRangeLock_V1<T, maxLevel>::tryLock(T start, T end) {
+    const auto topLevel = generateRandomLevel();
+    Node *preds[maxLevel + 1];
+    Node *succs[maxLevel + 1];
+    uint64_t versions[maxLevel + 1];
+
+    while (true) {
+        int levelFound = findInsert(start, end, preds, succs);
+        if (levelFound != -1) {
+            if (!succs[levelFound]->isMarked()) {
+                return false;
+            }
+            continue;
+        }
+
+        // read the version before the fields it protects, so a successful
+        // upgrade proves that they did not change after we checked them
+        bool valid = true;
+        for (unsigned level = 0; valid && (level <= topLevel); ++level) {
+            Node *pred = preds[level];
+            Node *succ = succs[level];
+
+            versions[level] = pred->readVersion();
+            valid = !pred->isMarked() && !succ->isMarked() &&
+                    pred->next[level] == succ;
+        }
+
+        if (!valid || !lockPredecessors(preds, versions, topLevel)) {
+            continue;
+        }
+
+        Node *newNode = Node::create(start, end, topLevel);
+        for (unsigned level = 0; level <= topLevel; ++level) {
+            newNode->next[level] = succs[level];
+            preds[level]->next[level] = newNode;
+        }
+        newNode->setFullyLinked();
+        unlockPredecessors(preds, topLevel);
+
+        elementsCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+}
+
+template <typename T, unsigned maxLevel>
+bool OptimisticRangeLock_V1<T, maxLevel>::releaseLock(T start, T end) {
+    Node *victim = nullptr;
+    bool isMarked = false;
+    int topLevel = -1;
+
+    Node *preds[maxLevel + 1];
+    Node *succs[maxLevel + 1];
+    uint64_t versions[maxLevel + 1];
+
+    while (true) {
+        int levelFound = findExact(start, end, preds, succs);
+
+        if (!isMarked) {
+            if (levelFound == -1) {
+                std::cerr << "Wrong usage of releaseLock" << std::endl;
+                return false;
+            }
+
+            victim = succs[levelFound];
+            if (!victim->isFullyLinked()) {
+                continue;
+            }
+            if (victim->getTopLevel() != levelFound || victim->isMarked()) {
+                return false;
+            }
+
+            // the victim stays locked until it is unlinked, which keeps
+            // inserters from using it as a predecessor meanwhile
+            victim->lock();
+            if (victim->isMarked()) {
+                victim->unlock();
+                return false;
+            }
+            victim->setMarked();
+            isMarked = true;
+            topLevel = victim->getTopLevel();
+        }
+
+        bool valid = true;
+        for (int level = 0; valid && level <= topLevel; ++level) {
+            Node *pred = preds[level];
+
+            versions[level] = pred->readVersion();
+            valid = !pred->isMarked() && pred->next[level] == victim;
+        }
+
+        if (!valid || !lockPredecessors(preds, versions, topLevel)) {
+            continue;
+        }
+
+        for (int level = topLevel; level >= 0; --level) {
+            preds[level]->next[level] = victim->next[level];
+        }
+        unlockPredecessors(preds, topLevel);
+        victim->unlock();
+
+        elementsCount.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+}
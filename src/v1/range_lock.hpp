@@ -13,75 +13,90 @@
 
 #include "node.hpp"
 
+// Runs a callable on scope exit. Templated on the callable instead of
+// holding a std::function, so it never allocates.
+template <typename F>
 class ScopeGuard {
    public:
-    explicit ScopeGuard(std::function<void()> onExitScope)
-        : onExitScope_(onExitScope) {}
+    explicit ScopeGuard(F onExitScope) : onExitScope_(onExitScope) {}
 
     ~ScopeGuard() { onExitScope_(); }
 
    private:
-    std::function<void()> onExitScope_;
+    F onExitScope_;
 };
 
-template <typename T>
+// Tracks the nodes locked during one attempt in a fixed-capacity array on
+// the stack. An attempt locks at most one victim and one predecessor per
+// level, so capacity is maxLevel + 2 and a linear search is cheap.
+template <typename T, typename Lock, unsigned capacity>
 class Node_V1Locker {
    public:
-    void trackAndLock(Node_V1<T> *Node_V1) {
+    void trackAndLock(Node_V1<T, Lock> *Node_V1) {
         // Lock the Node_V1 if it's not already tracked and locked
-        if (std::find(trackedNode_V1s.begin(), trackedNode_V1s.end(),
-                      Node_V1) == trackedNode_V1s.end()) {
-            Node_V1->lock();
-            trackedNode_V1s.push_back(Node_V1);
+        for (unsigned i = 0; i < trackedCount; ++i) {
+            if (trackedNode_V1s[i] == Node_V1) {
+                return;
+            }
         }
+        Node_V1->lock();
+        trackedNode_V1s[trackedCount++] = Node_V1;
     }
 
     void unlockAll() {
         // Unlock all tracked Node_V1s in reverse order
-        for (auto it = trackedNode_V1s.rbegin(); it != trackedNode_V1s.rend();
-             ++it) {
-            (*it)->unlock();
+        while (trackedCount > 0) {
+            trackedNode_V1s[--trackedCount]->unlock();
         }
-        // Clear the vector after unlocking
-        trackedNode_V1s.clear();
     }
 
    private:
-    std::vector<Node_V1<T> *> trackedNode_V1s;
+    Node_V1<T, Lock> *trackedNode_V1s[capacity];
+    unsigned trackedCount = 0;
 };
 
-template <typename T, unsigned maxLevel>
+template <typename T, unsigned maxLevel, typename Lock = MutexLock>
 struct ConcurrentRangeLock_V1 {
    public:
-    ConcurrentRangeLock_V1();
+    explicit ConcurrentRangeLock_V1(bool deferUnlink = false);
     ~ConcurrentRangeLock_V1();
     unsigned generateRandomLevel();
-    Node_V1<T> *createNode_V1(T, T, int);
+    Node_V1<T, Lock> *createNode_V1(T, T, int);
 
     bool searchLock(T, T);
+    bool anyOverlap(T, T);
+    bool isLocked(T);
     bool tryLock(T, T);
     bool releaseLock(T, T);
+    size_t unlinkMarked();
     void displayList();
     size_t size();
 
    private:
     unsigned currentLevel{maxLevel};
     std::atomic<size_t> elementsCount{0};
+    const bool deferUnlink;
 
-    Node_V1<T> *head;
-    Node_V1<T> *tail;
+    Node_V1<T, Lock> *head;
+    Node_V1<T, Lock> *tail;
 
-    int findInsert(T start, T end, Node_V1<T> **preds, Node_V1<T> **succs);
-    int findExact(T start, T end, Node_V1<T> **preds, Node_V1<T> **succs);
+    int findInsert(T start, T end, Node_V1<T, Lock> **preds,
+                   Node_V1<T, Lock> **succs);
+    int findExact(T start, T end, Node_V1<T, Lock> **preds,
+                  Node_V1<T, Lock> **succs);
+    bool tryUnlink(Node_V1<T, Lock> *victim, Node_V1<T, Lock> *&blocker);
+    bool helpUnlink(Node_V1<T, Lock> *victim);
 };
 
-template <typename T, unsigned maxLevel>
-size_t ConcurrentRangeLock_V1<T, maxLevel>::size() {
+template <typename T, unsigned maxLevel, typename Lock>
+size_t ConcurrentRangeLock_V1<T, maxLevel, Lock>::size() {
     return this->elementsCount.load(std::memory_order_relaxed);
 }
 
-template <typename T, unsigned maxLevel>
-ConcurrentRangeLock_V1<T, maxLevel>::ConcurrentRangeLock_V1() {
+template <typename T, unsigned maxLevel, typename Lock>
+ConcurrentRangeLock_V1<T, maxLevel, Lock>::ConcurrentRangeLock_V1(
+    bool deferUnlink)
+    : deferUnlink(deferUnlink) {
     std::srand(std::time(0));
 
     auto min = std::numeric_limits<T>::min();
@@ -95,11 +110,11 @@ ConcurrentRangeLock_V1<T, maxLevel>::ConcurrentRangeLock_V1() {
     }
 }
 
-template <typename T, unsigned maxLevel>
-ConcurrentRangeLock_V1<T, maxLevel>::~ConcurrentRangeLock_V1() {}
+template <typename T, unsigned maxLevel, typename Lock>
+ConcurrentRangeLock_V1<T, maxLevel, Lock>::~ConcurrentRangeLock_V1() {}
 
-template <typename T, unsigned maxLevel>
-unsigned ConcurrentRangeLock_V1<T, maxLevel>::generateRandomLevel() {
+template <typename T, unsigned maxLevel, typename Lock>
+unsigned ConcurrentRangeLock_V1<T, maxLevel, Lock>::generateRandomLevel() {
     unsigned level = 1;
     while (rand() % 2 == 0 && level < maxLevel) {
         ++level;
@@ -107,21 +122,20 @@ unsigned ConcurrentRangeLock_V1<T, maxLevel>::generateRandomLevel() {
     return level;
 }
 
-template <typename T, unsigned maxLevel>
-Node_V1<T> *ConcurrentRangeLock_V1<T, maxLevel>::createNode_V1(T start, T end,
-                                                               int level) {
-    return new Node_V1<T>(start, end, level);
+template <typename T, unsigned maxLevel, typename Lock>
+Node_V1<T, Lock> *ConcurrentRangeLock_V1<T, maxLevel, Lock>::createNode_V1(
+    T start, T end, int level) {
+    return Node_V1<T, Lock>::create(start, end, level);
 }
 
-template <typename T, unsigned maxLevel>
-int ConcurrentRangeLock_V1<T, maxLevel>::findInsert(T start, T end,
-                                                    Node_V1<T> **preds,
-                                                    Node_V1<T> **succs) {
+template <typename T, unsigned maxLevel, typename Lock>
+int ConcurrentRangeLock_V1<T, maxLevel, Lock>::findInsert(
+    T start, T end, Node_V1<T, Lock> **preds, Node_V1<T, Lock> **succs) {
     int levelFound = -1;
-    Node_V1<T> *pred = head;
+    Node_V1<T, Lock> *pred = head;
 
     for (int level = maxLevel; level >= 0; level--) {
-        Node_V1<T> *curr = pred->next[level];
+        Node_V1<T, Lock> *curr = pred->next[level];
 
         while (start >= curr->getEnd()) {
             pred = curr;
@@ -139,15 +153,14 @@ int ConcurrentRangeLock_V1<T, maxLevel>::findInsert(T start, T end,
     return levelFound;
 }
 
-template <typename T, unsigned maxLevel>
-int ConcurrentRangeLock_V1<T, maxLevel>::findExact(T start, T end,
-                                                   Node_V1<T> **preds,
-                                                   Node_V1<T> **succs) {
+template <typename T, unsigned maxLevel, typename Lock>
+int ConcurrentRangeLock_V1<T, maxLevel, Lock>::findExact(
+    T start, T end, Node_V1<T, Lock> **preds, Node_V1<T, Lock> **succs) {
     int levelFound = -1;
-    Node_V1<T> *pred = head;
+    Node_V1<T, Lock> *pred = head;
 
     for (int level = maxLevel; level >= 0; level--) {
-        Node_V1<T> *curr = pred->next[level];
+        Node_V1<T, Lock> *curr = pred->next[level];
 
         while (start >= curr->getEnd()) {
             pred = curr;
@@ -166,75 +179,141 @@ int ConcurrentRangeLock_V1<T, maxLevel>::findExact(T start, T end,
     return levelFound;
 }
 
-template <typename T, unsigned maxLevel>
-bool ConcurrentRangeLock_V1<T, maxLevel>::searchLock(T start, T end) {
-    Node_V1<T> *preds[maxLevel + 1];
-    Node_V1<T> *succs[maxLevel + 1];
+template <typename T, unsigned maxLevel, typename Lock>
+bool ConcurrentRangeLock_V1<T, maxLevel, Lock>::searchLock(T start, T end) {
+    Node_V1<T, Lock> *preds[maxLevel + 1];
+    Node_V1<T, Lock> *succs[maxLevel + 1];
 
     int levelFound = findExact(start, end, preds, succs);
 
-    return (levelFound != -1 && succs[levelFound]->fullyLinked &&
-            !succs[levelFound]->marked);
+    return (levelFound != -1 && succs[levelFound]->isFullyLinked() &&
+            !succs[levelFound]->isMarked());
+}
+
+// Reports whether a held range conflicts with [start, end], using the same
+// predicate as tryLock. Ranges that are still being linked count as held,
+// marked ones as already released. One descent, no locks, no writes.
+template <typename T, unsigned maxLevel, typename Lock>
+bool ConcurrentRangeLock_V1<T, maxLevel, Lock>::anyOverlap(T start, T end) {
+    Node_V1<T, Lock> *pred = head;
+    Node_V1<T, Lock> *curr = nullptr;
+
+    for (int level = maxLevel; level >= 0; level--) {
+        curr = pred->next[level];
+
+        while (start >= curr->getEnd()) {
+            pred = curr;
+            curr = pred->next[level];
+        }
+    }
+
+    for (; curr != tail && end >= curr->getStart(); curr = curr->next[0]) {
+        if (!curr->isMarked()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T, unsigned maxLevel, typename Lock>
+bool ConcurrentRangeLock_V1<T, maxLevel, Lock>::isLocked(T key) {
+    return anyOverlap(key, key);
 }
 
-template <typename T, unsigned maxLevel>
-bool ConcurrentRangeLock_V1<T, maxLevel>::tryLock(T start, T end) {
+template <typename T, unsigned maxLevel, typename Lock>
+bool ConcurrentRangeLock_V1<T, maxLevel, Lock>::tryLock(T start, T end) {
     const auto topLevel = generateRandomLevel();
-    Node_V1<T> *preds[maxLevel + 1];
-    Node_V1<T> *succs[maxLevel + 1];
+    Node_V1<T, Lock> *preds[maxLevel + 1];
+    Node_V1<T, Lock> *succs[maxLevel + 1];
 
     while (true) {
         int levelFound = findInsert(start, end, preds, succs);
         if (levelFound != -1) {
-            Node_V1<T> *Node_V1Found = succs[levelFound];
-            if (!Node_V1Found->marked) {
+            Node_V1<T, Lock> *Node_V1Found = succs[levelFound];
+            if (!Node_V1Found->isMarked()) {
                 return false;
             }
+            if (deferUnlink) {
+                helpUnlink(Node_V1Found);
+            }
             // std::this_thread::yield();
             continue;
         }
 
         bool valid = true;
-        Node_V1Locker<T> Node_V1Locker;
+        Node_V1<T, Lock> *stale = nullptr;
+        Node_V1Locker<T, Lock, maxLevel + 2> Node_V1Locker;
         ScopeGuard unlockGuard(
             [&Node_V1Locker]() { Node_V1Locker.unlockAll(); });
 
         for (int level = 0; valid && (level <= topLevel); ++level) {
-            Node_V1<T> *pred = preds[level];
-            Node_V1<T> *succ = succs[level];
+            Node_V1<T, Lock> *pred = preds[level];
+            Node_V1<T, Lock> *succ = succs[level];
 
             Node_V1Locker.trackAndLock(pred);
 
-            valid = !pred->marked && !succ->marked && pred->next[level] == succ;
+            valid = !pred->isMarked() && !succ->isMarked() &&
+                    pred->next[level] == succ;
+            if (!valid && deferUnlink) {
+                stale = pred->isMarked()   ? pred
+                        : succ->isMarked() ? succ
+                                           : nullptr;
+            }
         }
 
         if (!valid) {
+            // A released neighbour nobody has unlinked yet would fail
+            // validation forever, so unlink it before retrying.
+            if (stale != nullptr) {
+                Node_V1Locker.unlockAll();
+                helpUnlink(stale);
+            }
             continue;
         }
 
-        Node_V1<T> *newNode_V1 = createNode_V1(start, end, topLevel);
+        Node_V1<T, Lock> *newNode_V1 = createNode_V1(start, end, topLevel);
         for (int level = 0; level <= topLevel; ++level) {
             newNode_V1->next[level] = succs[level];
             preds[level]->next[level] = newNode_V1;
         }
-        newNode_V1->fullyLinked = true;
+        newNode_V1->setFullyLinked();
 
         elementsCount.fetch_add(1, std::memory_order_relaxed);
         return true;
     }
 }
-template <typename T, unsigned maxLevel>
+template <typename T, unsigned maxLevel, typename Lock>
 
-bool ConcurrentRangeLock_V1<T, maxLevel>::releaseLock(T start, T end) {
-    Node_V1<T> *victim = nullptr;
+bool ConcurrentRangeLock_V1<T, maxLevel, Lock>::releaseLock(T start, T end) {
+    Node_V1<T, Lock> *victim = nullptr;
     bool isMarked = false;
     int topLevel = -1;
 
-    Node_V1<T> *preds[maxLevel + 1];
-    Node_V1<T> *succs[maxLevel + 1];
+    Node_V1<T, Lock> *preds[maxLevel + 1];
+    Node_V1<T, Lock> *succs[maxLevel + 1];
+
+    // Deferred mode only does the logical delete under the victim lock. The
+    // node stays linked until a later tryLock runs into it or unlinkMarked()
+    // sweeps it, so no predecessor locks are taken on the release path.
+    if (deferUnlink) {
+        int levelFound = findExact(start, end, preds, succs);
+        if (levelFound == -1) {
+            std::cerr << "Wrong usage of releaseLock" << std::endl;
+            return false;
+        }
+        victim = succs[levelFound];
+
+        std::lock_guard<Node_V1<T, Lock>> guard(*victim);
+        if (victim->isMarked()) {
+            return false;
+        }
+        victim->setMarked();
+        elementsCount.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
 
     while (true) {
-        Node_V1Locker<T> Node_V1Locker;
+        Node_V1Locker<T, Lock, maxLevel + 2> Node_V1Locker;
         ScopeGuard unlockGuard(
             [&Node_V1Locker]() { Node_V1Locker.unlockAll(); });
 
@@ -243,31 +322,31 @@ bool ConcurrentRangeLock_V1<T, maxLevel>::releaseLock(T start, T end) {
             victim = succs[levelFound];
         } else {
             std::cerr << "Wrong usage of releaseLock" << std::endl;
-            exit(0);
+            return false;
         }
 
         if (isMarked ||
             (levelFound != -1 && victim->getTopLevel() == levelFound &&
-             !victim->marked)) {
+             !victim->isMarked())) {
             if (!isMarked) {
                 topLevel = victim->getTopLevel();
 
                 Node_V1Locker.trackAndLock(victim);
 
-                if (victim->marked) {
+                if (victim->isMarked()) {
                     return false;
                 }
-                victim->marked = true;
+                victim->setMarked();
                 isMarked = true;
             }
 
             bool valid = true;
-            Node_V1<T> *pred, *succ;
+            Node_V1<T, Lock> *pred, *succ;
 
             for (int level = 0; valid && level <= topLevel; ++level) {
                 pred = preds[level];
                 Node_V1Locker.trackAndLock(pred);
-                valid = !pred->marked && pred->next[level] == victim;
+                valid = !pred->isMarked() && pred->next[level] == victim;
             }
 
             if (!valid) {
@@ -284,14 +363,98 @@ bool ConcurrentRangeLock_V1<T, maxLevel>::releaseLock(T start, T end) {
             return true;
         } else {
             std::cout << isMarked << levelFound << victim->getTopLevel()
-                      << levelFound << victim->marked << std::endl;
+                      << levelFound << victim->isMarked() << std::endl;
             return false;
         }
     }
 }
-template <typename T, unsigned maxLevel>
+// Physically unlinks a node released in deferred mode. The victim lock is
+// held throughout, so at most one thread unlinks a given node; if the node
+// is no longer reachable someone else already did. Returns true if this
+// call unlinked it. If a predecessor is itself marked it has to go first,
+// it is handed back through blocker and nothing is changed.
+template <typename T, unsigned maxLevel, typename Lock>
+bool ConcurrentRangeLock_V1<T, maxLevel, Lock>::tryUnlink(
+    Node_V1<T, Lock> *victim, Node_V1<T, Lock> *&blocker) {
+    Node_V1<T, Lock> *preds[maxLevel + 1];
+    Node_V1<T, Lock> *succs[maxLevel + 1];
+    const int topLevel = victim->getTopLevel();
+
+    while (true) {
+        Node_V1Locker<T, Lock, maxLevel + 2> Node_V1Locker;
+        ScopeGuard unlockGuard(
+            [&Node_V1Locker]() { Node_V1Locker.unlockAll(); });
+
+        Node_V1Locker.trackAndLock(victim);
+        int levelFound =
+            findExact(victim->getStart(), victim->getEnd(), preds, succs);
+        if (levelFound == -1 || succs[levelFound] != victim) {
+            return false;
+        }
+
+        bool valid = true;
+        for (int level = 0; valid && level <= topLevel; ++level) {
+            Node_V1<T, Lock> *pred = preds[level];
+            Node_V1Locker.trackAndLock(pred);
+            if (pred->isMarked()) {
+                blocker = pred;
+                return false;
+            }
+            valid = pred->next[level] == victim;
+        }
+
+        if (!valid) {
+            continue;
+        }
+
+        for (int level = topLevel; level >= 0; --level) {
+            preds[level]->next[level] = victim->next[level];
+        }
+        return true;
+    }
+}
+
+// Unlinks victim, first clearing any run of marked predecessors in front of
+// it. Iterative rather than recursive, since a batch of adjacent releases
+// can leave long runs of marked nodes.
+template <typename T, unsigned maxLevel, typename Lock>
+bool ConcurrentRangeLock_V1<T, maxLevel, Lock>::helpUnlink(
+    Node_V1<T, Lock> *victim) {
+    Node_V1<T, Lock> *target = victim;
+
+    while (true) {
+        Node_V1<T, Lock> *blocker = nullptr;
+        bool unlinked = tryUnlink(target, blocker);
+        if (blocker != nullptr) {
+            target = blocker;
+        } else if (target == victim) {
+            return unlinked;
+        } else {
+            target = victim;
+        }
+    }
+}
+
+// Batch unlink for deferred mode, meant to be called periodically by a
+// maintenance thread. Walks the bottom level once and unlinks every marked
+// node it meets. Nodes are never freed, so following next from a node that
+// was just unlinked is safe. Returns the number of nodes this call unlinked.
+template <typename T, unsigned maxLevel, typename Lock>
+size_t ConcurrentRangeLock_V1<T, maxLevel, Lock>::unlinkMarked() {
+    size_t unlinked = 0;
+
+    for (Node_V1<T, Lock> *curr = head->next[0]; curr != tail;
+         curr = curr->next[0]) {
+        if (curr->isMarked() && helpUnlink(curr)) {
+            ++unlinked;
+        }
+    }
+    return unlinked;
+}
+
+template <typename T, unsigned maxLevel, typename Lock>
 
-void ConcurrentRangeLock_V1<T, maxLevel>::displayList() {
+void ConcurrentRangeLock_V1<T, maxLevel, Lock>::displayList() {
     std::cout << "Concurrent Range Lock" << std::endl;
 
     if (head->next[0] == nullptr) {
@@ -304,7 +467,7 @@ void ConcurrentRangeLock_V1<T, maxLevel>::displayList() {
     std::vector<std::vector<std::string>> builder(
         len, std::vector<std::string>(this->currentLevel + 1));
 
-    Node_V1<T> *current = head->next[0];
+    Node_V1<T, Lock> *current = head->next[0];
 
     for (int i = 0; i < len; ++i) {
         for (int j = 0; j < this->currentLevel + 1; ++j) {
@@ -334,8 +497,9 @@ void ConcurrentRangeLock_V1<T, maxLevel>::displayList() {
     }
 }
 
-template <typename T>
-void trackAndLock(Node_V1<T> *pred, std::vector<Node_V1<T> *> &toUnlock) {
+template <typename T, typename Lock>
+void trackAndLock(Node_V1<T, Lock> *pred,
+                  std::vector<Node_V1<T, Lock> *> &toUnlock) {
     if (std::find(toUnlock.begin(), toUnlock.end(), pred) == toUnlock.end()) {
         pred->lock();
         toUnlock.push_back(pred);
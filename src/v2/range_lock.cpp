@@ -1,6 +1,8 @@
 #include <atomic>
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <vector>
 
 // Node structure for the linked list
@@ -8,16 +10,38 @@ struct LNode {
     uint64_t start;
     uint64_t end;
     std::atomic<LNode *> next;
+    bool reader;
 
-    LNode(uint64_t s, uint64_t e) : start(s), end(e), next(nullptr) {}
+    LNode(uint64_t s, uint64_t e, bool r = false)
+        : start(s), end(e), next(nullptr), reader(r) {}
 };
 
-// List structure for range locks
+// Number of buckets below the target one that are tried for a hint
+constexpr uint64_t HINT_PROBES = 4;
+
+// Rounds a waiting acquire spins on a conflicting node before parking
+constexpr int WAIT_SPINS = 100;
+
+// List structure for range locks. Besides the list itself it keeps a sparse
+// skip-ahead index: one hint per key bucket of 2^hintShift keys, pointing at
+// the node most recently inserted there. Hints are updated lazily and are
+// only ever a starting point for InsertNode, a missing or stale one falls
+// back to walking from head. hintBuckets must be a power of two, 0 turns
+// the index off. The index relies on live nodes never overlapping, which
+// readers break, so it is no longer used once a reader has been acquired.
 struct ListRL {
     std::atomic<LNode *> head;
     std::atomic<size_t> elementsCount{0};
+    std::atomic<bool> hasReaders{false};
+    size_t hintBuckets;
+    unsigned hintShift;
+    std::unique_ptr<std::atomic<LNode *>[]> hints;
 
-    ListRL() : head(nullptr) {}
+    explicit ListRL(size_t hintBuckets = 1 << 16, unsigned hintShift = 6)
+        : head(nullptr),
+          hintBuckets(hintBuckets),
+          hintShift(hintShift),
+          hints(new std::atomic<LNode *>[hintBuckets]()) {}
 
     size_t size() { return elementsCount.load(); }
 };
@@ -42,6 +66,8 @@ LNode *unmark(LNode *node) {
 // Compare the range of two node
 int compare(LNode *lock1, LNode *lock2) {
     if (!lock1) return 1;  // lock1 is end of the list, no overlap
+    if (lock1->reader && lock2->reader)  // readers never conflict,
+        return lock2->start >= lock1->start ? -1 : 1;  // sort them by start
     if (lock1->start >= lock2->end)
         return 1;  // lock1 comes after lock2, no overlap
     if (lock2->start >= lock1->end)
@@ -49,10 +75,111 @@ int compare(LNode *lock1, LNode *lock2) {
     return 0;       // lock1 and lock2 overlap
 }
 
-// Insert node into the list
-bool InsertNode(ListRL *listrl, LNode *lock) {
+// Pick the node InsertNode starts walking from: a hinted node that is still
+// live and lies entirely before lock, or nullptr for head. Every live node
+// in front of such a node also precedes lock, so starting there sees the
+// same conflicts as a walk from head. Nodes are never freed, so a stale
+// hint is still safe to read; it is cleared when found marked.
+LNode *findStart(ListRL *listrl, LNode *lock) {
+    if (listrl->hintBuckets == 0 || listrl->hasReaders.load()) return nullptr;
+
+    uint64_t bucket = lock->start >> listrl->hintShift;
+    for (uint64_t probe = 0; probe < HINT_PROBES && probe <= bucket; ++probe) {
+        std::atomic<LNode *> &slot =
+                listrl->hints[(bucket - probe) & (listrl->hintBuckets - 1)];
+        LNode *hint = slot.load(std::memory_order_acquire);
+
+        // Empty, or a node from another key region sharing the slot
+        if (!hint || (hint->start >> listrl->hintShift) != bucket - probe)
+            continue;
+
+        if (isMarked(hint->next.load())) {  // hint is logically deleted
+            slot.compare_exchange_strong(hint, nullptr);
+            continue;
+        }
+        if (compare(hint, lock) == -1) return hint;
+    }
+    return nullptr;
+}
+
+// Offer a live node as the hint for its bucket. The lowest live node of a
+// bucket is the most useful starting point, so a live hint of the same
+// bucket is only replaced by a node in front of it.
+void publishHint(ListRL *listrl, LNode *node) {
+    if (listrl->hintBuckets == 0 || listrl->hasReaders.load()) return;
+
+    uint64_t bucket = node->start >> listrl->hintShift;
+    std::atomic<LNode *> &slot =
+            listrl->hints[bucket & (listrl->hintBuckets - 1)];
+    LNode *hint = slot.load(std::memory_order_acquire);
+
+    if (!hint || (hint->start >> listrl->hintShift) != bucket ||
+        isMarked(hint->next.load()) || node->start < hint->start) {
+        slot.compare_exchange_strong(hint, node, std::memory_order_release);
+    }
+}
+
+// Delete node from the list. The mark is set with a CAS so that a
+// concurrent insert right behind lock is not overwritten.
+void DeleteNode(ListRL *listrl, LNode *lock) {
+    LNode *currentNext = lock->next.load();
+    LNode *markedNext;
+    do {
+        markedNext = reinterpret_cast<LNode *>(
+                reinterpret_cast<uintptr_t>(currentNext) | 1);
+    } while (!lock->next.compare_exchange_weak(currentNext, markedNext));
+    listrl->elementsCount.fetch_sub(1, std::memory_order_relaxed);
+    lock->next.notify_all();  // wake acquires parked on this node
+
+}
+
+// Wait until node is logically deleted, spinning on the mark bit of its next
+// field for a while and then parking on it
+void waitForDelete(LNode *node) {
+    LNode *next = node->next.load();
+    for (int i = 0; i < WAIT_SPINS && !isMarked(next); ++i) {
+        std::this_thread::yield();
+        next = node->next.load();
+    }
+    while (!isMarked(next)) {
+        node->next.wait(next);
+        next = node->next.load();
+    }
+}
+
+// Check that no live writer after a freshly inserted reader overlaps it
+bool r_validate(LNode *lock) {
+    LNode *cur = unmark(lock->next.load());
+    while (cur && cur->start < lock->end) {
+        LNode *next = cur->next.load();
+        if (!isMarked(next) && !cur->reader) return false;
+        cur = unmark(next);
+    }
+    return true;
+}
+
+// Check that no live reader before a freshly inserted writer overlaps it.
+// The insert traversal has already ruled out everything else.
+bool w_validate(ListRL *listrl, LNode *lock) {
+    LNode *cur = listrl->head.load();
+    while (cur != lock) {
+        LNode *next = cur->next.load();
+        if (!isMarked(next) && cur->reader && cur->end > lock->start)
+            return false;
+        cur = unmark(next);
+    }
+    return true;
+}
+
+// Insert node into the list. With wait set, an overlapping node is waited
+// out in place and the walk continues from the same position. It then only
+// fails if a reader-writer validation backs the node out again.
+bool InsertNode(ListRL *listrl, LNode *lock, bool wait = false) {
+    if (lock->reader) listrl->hasReaders.store(true);
+
     while (true) {
-        std::atomic<LNode *> *prev = &(listrl->head);
+        LNode *pred = findStart(listrl, lock);
+        std::atomic<LNode *> *prev = pred ? &(pred->next) : &(listrl->head);
         LNode *cur = prev->load();
         while (true) {
             if (isMarked(cur)) break;  // prev is logically deleted
@@ -66,14 +193,30 @@ bool InsertNode(ListRL *listrl, LNode *lock) {
             } else {  // cur is currently protecting a range
                 int ret = compare(cur, lock);
                 if (ret == -1) {  // lock succeeds cur
+                    pred = cur;
                     prev = &(cur->next);
                     cur = prev->load();
                 } else if (ret == 0) {  // lock overlaps with cur
-                    return false;
+                    if (!wait) return false;
+                    waitForDelete(cur);  // the next round unlinks cur
+                    cur = prev->load();
                 } else {  // lock precedes cur or reached end of list
                     lock->next.store(cur);
                     if (std::atomic_compare_exchange_strong(prev, &cur, lock)) {
                         listrl->elementsCount.fetch_add(1, std::memory_order_relaxed);
+                        // Overlapping readers and writers may have been
+                        // inserted concurrently, the later one backs out
+                        bool valid = lock->reader ? r_validate(lock)
+                                     : listrl->hasReaders.load()
+                                             ? w_validate(listrl, lock)
+                                             : true;
+                        if (!valid) {
+                            DeleteNode(listrl, lock);
+                            return false;
+                        }
+                        // The predecessor usually outlives lock, offer both
+                        publishHint(listrl, lock);
+                        if (pred) publishHint(listrl, pred);
                         return true;  // success - the range is acquired now
                     }
                     cur =
@@ -84,16 +227,6 @@ bool InsertNode(ListRL *listrl, LNode *lock) {
     }
 }
 
-// Delete node from the list
-void DeleteNode(ListRL *listrl, LNode *lock) {
-    LNode *currentNext = lock->next.load();
-    LNode *markedNext =
-            reinterpret_cast<LNode *>(reinterpret_cast<uintptr_t>(currentNext) | 1);
-    lock->next.store(markedNext);
-    listrl->elementsCount.fetch_sub(1, std::memory_order_relaxed);
-
-}
-
 // Acquire a range lock
 RangeLock *MutexRangeAcquire(ListRL *listrl, uint64_t start, uint64_t end) {
     RangeLock *rl = new RangeLock(new LNode(start, end));
@@ -104,9 +237,84 @@ RangeLock *MutexRangeAcquire(ListRL *listrl, uint64_t start, uint64_t end) {
     return nullptr;
 }
 
+// Acquire a range lock, waiting for overlapping ranges to be released
+RangeLock *MutexRangeAcquireWait(ListRL *listrl, uint64_t start,
+                                 uint64_t end) {
+    LNode *node = new LNode(start, end);
+    while (!InsertNode(listrl, node, true)) {  // only after readers were used
+        node = new LNode(start, end);
+    }
+    return new RangeLock(node);
+}
+
 // Release a range lock
 void MutexRangeRelease(ListRL *listrl, RangeLock *rl) { DeleteNode(listrl, rl->node); }
 
+// Acquire a range lock in shared (reader) or exclusive (writer) mode.
+// Overlapping readers coexist, a writer conflicts with any overlap.
+RangeLock *RWRangeAcquire(ListRL *listrl, uint64_t start, uint64_t end,
+                          bool reader) {
+    RangeLock *rl = new RangeLock(new LNode(start, end, reader));
+    if (InsertNode(listrl, rl->node)) {
+        return rl;
+    }
+    delete rl;
+    return nullptr;
+}
+
+// Acquire a range lock in shared or exclusive mode, waiting for conflicting
+// ranges to be released. A node backed out by validation is already linked
+// and marked, so the retry needs a fresh one.
+RangeLock *RWRangeAcquireWait(ListRL *listrl, uint64_t start, uint64_t end,
+                              bool reader) {
+    LNode *node = new LNode(start, end, reader);
+    while (!InsertNode(listrl, node, true)) {
+        node = new LNode(start, end, reader);
+    }
+    return new RangeLock(node);
+}
+
+// Release a range lock acquired with RWRangeAcquire or RWRangeAcquireWait
+void RWRangeRelease(ListRL *listrl, RangeLock *rl) { DeleteNode(listrl, rl->node); }
+
+// Release the live range [start, end) without its handle, found by a walk
+// from the closest hint. Returns false if no such range is held.
+bool MutexRangeReleaseRange(ListRL *listrl, uint64_t start, uint64_t end) {
+    LNode probe(start, end);
+    LNode *cur = findStart(listrl, &probe);
+    cur = cur ? cur : listrl->head.load();
+    while (cur) {
+        LNode *next = cur->next.load();
+        if (!isMarked(next) && cur->start == start && cur->end == end) {
+            DeleteNode(listrl, cur);
+            return true;
+        }
+        if (!isMarked(next) && cur->start > start) return false;
+        cur = unmark(next);
+    }
+    return false;
+}
+
+// The list behind tryLock(start, end) and releaseLock(start, end), which
+// release by range instead of by handle, for front-ends written against the
+// other versions. Ranges are half-open like everywhere else in this file.
+struct ListRLLock {
+    ListRL list;
+
+    bool tryLock(uint64_t start, uint64_t end) {
+        RangeLock *rl = MutexRangeAcquire(&list, start, end);
+        bool locked = rl != nullptr;
+        delete rl;
+        return locked;
+    }
+
+    bool releaseLock(uint64_t start, uint64_t end) {
+        return MutexRangeReleaseRange(&list, start, end);
+    }
+
+    size_t size() { return list.size(); }
+};
+
 // Print the range lock
 void printList(ListRL *listrl) {
     LNode *cur = listrl->head.load();
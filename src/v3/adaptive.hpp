@@ -0,0 +1,293 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../v0/range_lock.hpp"
+#include "range_lock.hpp"
+
+// Range lock that runs on SongRangeLock while few threads use it and on the
+// lock-free ConcurrentRangeLock (v0) once they get in each other's way. The
+// global lock of SongRangeLock is a SampledMutex, and the share of its
+// acquisitions over a window that had to wait, and the time they waited,
+// tell when the coarse mode is contended. In lock-free mode there is no lock
+// to watch, so every SAMPLE_RATE-th operation in an activity slot counts the
+// other operations in flight instead, and the coarse mode comes back once
+// they get rare. All of this is kept per instance.
+//
+// Every operation marks itself in flight in an activity slot of its own
+// while it runs. A switch announces itself in state_, waits until every
+// slot is idle, so that no operation runs in either implementation, and then
+// transfers the held ranges. Operations that start meanwhile wait for it.
+// Ranges are closed, and keys are shifted up by one in v0, whose head takes
+// 0, so end has to be below the largest uint64_t minus one.
+class AdaptiveRangeLock {
+   public:
+    enum class Mode : uint8_t { COARSE, LOCK_FREE };
+
+    static constexpr size_t ACTIVITY_SLOTS = 64;
+    static constexpr uint64_t SAMPLE_RATE = 64;
+    static constexpr uint64_t WINDOW_OPS = 1 << 14;
+    // The coarse mode gives way once this many acquisitions per thousand
+    // found the global lock taken, or once they waited this long per
+    // acquisition on average
+    static constexpr uint64_t CONTENDED_PER_MILLE = 125;
+    static constexpr uint64_t WAIT_NANOS_PER_OP = 1000;
+    // The lock-free mode gives way once sampled operations see fewer than
+    // this many others in flight, in hundredths
+    static constexpr uint64_t CONCURRENCY_PERCENT = 25;
+
+    // With adapt unset the mode only changes through switchTo
+    explicit AdaptiveRangeLock(Mode initial = Mode::COARSE, bool adapt = true);
+
+    bool tryLock(uint64_t start, uint64_t end);
+    void releaseLock(uint64_t start, uint64_t end);
+
+    // Moves all held ranges to the implementation of mode. Returns false,
+    // and stays in the current mode, if they could not all be moved.
+    bool switchTo(Mode mode);
+
+    Mode mode() const;
+    size_t migrations() const { return migrations_.load(); }
+    size_t size() { return coarse_.size() + lockFree_.size(); }
+
+   private:
+    using LockFree = ConcurrentRangeLock<uint64_t, 16>;
+
+    static constexpr uint8_t MIGRATING = 2;
+
+    struct alignas(64) ActivitySlot {
+        std::atomic<uint32_t> active{0};
+        std::atomic<uint64_t> operations{0};
+    };
+
+    Mode Enter(ActivitySlot &slot);
+    void Exit(ActivitySlot &slot);
+    void Sample(ActivitySlot &slot, Mode mode);
+    void EvaluateLocked();
+    bool MigrateLocked(Mode to);
+    void ResetWindow();
+    static size_t PreferredSlot();
+
+    SongRangeLock<SampledMutex> coarse_;
+    LockFree lockFree_;
+    std::unique_ptr<ActivitySlot[]> slots_;
+    std::atomic<uint8_t> state_;
+    const bool adapt_;
+
+    std::mutex adaptMutex_;
+    // Statistics of the global lock when the window started, guarded by
+    // adaptMutex_
+    SampledMutex::Stats windowStart_;
+    std::atomic<uint64_t> windowOps_{0};
+    std::atomic<uint64_t> windowSamples_{0};
+    std::atomic<uint64_t> windowConcurrency_{0};
+    std::atomic<size_t> migrations_{0};
+};
+
+inline AdaptiveRangeLock::AdaptiveRangeLock(Mode initial, bool adapt)
+    : slots_(new ActivitySlot[ACTIVITY_SLOTS]),
+      state_(static_cast<uint8_t>(initial)),
+      adapt_(adapt) {}
+
+inline AdaptiveRangeLock::Mode AdaptiveRangeLock::mode() const {
+    uint8_t state = state_.load(std::memory_order_acquire);
+    // A switch in progress is reported as the mode it switches away from
+    return state == MIGRATING ? Mode::COARSE : static_cast<Mode>(state);
+}
+
+// Threads share a slot only beyond ACTIVITY_SLOTS threads
+inline size_t AdaptiveRangeLock::PreferredSlot() {
+    static std::atomic<size_t> nextSlot{0};
+    thread_local size_t slot = nextSlot.fetch_add(1) % ACTIVITY_SLOTS;
+    return slot;
+}
+
+// Marks the slot in flight and returns the mode to run in. The seq_cst
+// increment and the load of state_ pair with the store of MIGRATING and
+// the loads of the slots in MigrateLocked: either the switch sees the slot
+// in flight, or the operation sees the switch.
+inline AdaptiveRangeLock::Mode AdaptiveRangeLock::Enter(ActivitySlot &slot) {
+    while (true) {
+        slot.active.fetch_add(1, std::memory_order_seq_cst);
+        uint8_t state = state_.load(std::memory_order_seq_cst);
+        if (state != MIGRATING) {
+            return static_cast<Mode>(state);
+        }
+        slot.active.fetch_sub(1, std::memory_order_release);
+        while (state_.load(std::memory_order_acquire) == MIGRATING) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+inline void AdaptiveRangeLock::Exit(ActivitySlot &slot) {
+    slot.active.fetch_sub(1, std::memory_order_release);
+}
+
+inline bool AdaptiveRangeLock::tryLock(uint64_t start, uint64_t end) {
+    if (start > end || end >= std::numeric_limits<uint64_t>::max() - 1) {
+        std::cerr << "Invalid range " << start << " " << end << std::endl;
+        return false;
+    }
+    ActivitySlot &slot = slots_[PreferredSlot()];
+    Mode mode = Enter(slot);
+    bool result = mode == Mode::COARSE ? coarse_.tryLock(start, end)
+                                       : lockFree_.tryLock(start + 1, end + 1);
+    Exit(slot);
+    Sample(slot, mode);
+    return result;
+}
+
+inline void AdaptiveRangeLock::releaseLock(uint64_t start, uint64_t end) {
+    ActivitySlot &slot = slots_[PreferredSlot()];
+    Mode mode = Enter(slot);
+    if (mode == Mode::COARSE) {
+        coarse_.releaseLock(start);
+    } else {
+        lockFree_.releaseLock(start + 1, end + 1);
+    }
+    Exit(slot);
+    Sample(slot, mode);
+}
+
+// Counts SAMPLE_RATE operations of the slot at a time into the window, and
+// evaluates the window once it is full. Runs outside of any operation, so
+// that a switch it starts does not wait for itself.
+inline void AdaptiveRangeLock::Sample(ActivitySlot &slot, Mode mode) {
+    if (!adapt_ ||
+        slot.operations.fetch_add(1, std::memory_order_relaxed) %
+                SAMPLE_RATE !=
+            SAMPLE_RATE - 1) {
+        return;
+    }
+
+    // The global lock keeps its own counts in coarse mode
+    if (mode == Mode::LOCK_FREE) {
+        uint64_t others = 0;
+        for (size_t i = 0; i < ACTIVITY_SLOTS; ++i) {
+            others += slots_[i].active.load(std::memory_order_relaxed);
+        }
+        windowSamples_.fetch_add(1, std::memory_order_relaxed);
+        windowConcurrency_.fetch_add(others, std::memory_order_relaxed);
+    }
+
+    uint64_t ops = windowOps_.fetch_add(SAMPLE_RATE,
+                                        std::memory_order_relaxed) +
+                   SAMPLE_RATE;
+    if (ops >= WINDOW_OPS && adaptMutex_.try_lock()) {
+        EvaluateLocked();
+        adaptMutex_.unlock();
+    }
+}
+
+inline void AdaptiveRangeLock::EvaluateLocked() {
+    uint64_t ops = windowOps_.load(std::memory_order_relaxed);
+    if (ops < WINDOW_OPS) {
+        return;
+    }
+    SampledMutex::Stats start = windowStart_;
+    SampledMutex::Stats now = coarse_.globalLock().stats();
+    uint64_t acquisitions = now.acquisitions - start.acquisitions;
+    uint64_t contended = now.contended - start.contended;
+    uint64_t waitNanos = now.waitNanos - start.waitNanos;
+    uint64_t samples = windowSamples_.load(std::memory_order_relaxed);
+    uint64_t concurrency =
+        windowConcurrency_.load(std::memory_order_relaxed);
+    ResetWindow();
+
+    if (mode() == Mode::COARSE) {
+        if (acquisitions > 0 &&
+            (contended * 1000 >= acquisitions * CONTENDED_PER_MILLE ||
+             waitNanos >= acquisitions * WAIT_NANOS_PER_OP)) {
+            MigrateLocked(Mode::LOCK_FREE);
+        }
+    } else if (samples > 0 &&
+               concurrency * 100 < samples * CONCURRENCY_PERCENT) {
+        MigrateLocked(Mode::COARSE);
+    }
+}
+
+inline void AdaptiveRangeLock::ResetWindow() {
+    windowStart_ = coarse_.globalLock().stats();
+    windowOps_.store(0, std::memory_order_relaxed);
+    windowSamples_.store(0, std::memory_order_relaxed);
+    windowConcurrency_.store(0, std::memory_order_relaxed);
+}
+
+inline bool AdaptiveRangeLock::switchTo(Mode mode) {
+    std::lock_guard<std::mutex> lock(adaptMutex_);
+    return MigrateLocked(mode);
+}
+
+inline bool AdaptiveRangeLock::MigrateLocked(Mode to) {
+    Mode from = mode();
+    if (from == to) {
+        return true;
+    }
+
+    state_.store(MIGRATING, std::memory_order_seq_cst);
+    for (size_t i = 0; i < ACTIVITY_SLOTS; ++i) {
+        while (slots_[i].active.load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Both lists hold disjoint ranges in order, which is what the batch
+    // calls of SongRangeLock need. The implementation switched to is empty,
+    // so a transfer only fails on a range it cannot take, and then every
+    // range stays where it was.
+    std::vector<std::pair<uint64_t, uint64_t>> held;
+    bool moved = true;
+    if (from == Mode::COARSE) {
+        for (SkipListNode *node = coarse_.head_->forward[0];
+             node != coarse_.tail_; node = node->forward[0]) {
+            held.emplace_back(node->start, node->end);
+        }
+        size_t taken = 0;
+        while (taken < held.size() &&
+               lockFree_.tryLock(held[taken].first + 1,
+                                 held[taken].second + 1)) {
+            ++taken;
+        }
+        moved = taken == held.size();
+        if (moved) {
+            coarse_.releaseLockBatch(held);
+        } else {
+            for (size_t i = 0; i < taken; ++i) {
+                lockFree_.releaseLock(held[i].first + 1, held[i].second + 1);
+            }
+        }
+    } else {
+        for (auto it = lockFree_.snapshot(0,
+                                          std::numeric_limits<uint64_t>::max());
+             it.valid(); it.next()) {
+            held.emplace_back(it.getStart() - 1, it.getEnd() - 1);
+        }
+        moved = coarse_.tryLockBatch(held);
+        if (moved) {
+            for (auto &range : held) {
+                lockFree_.releaseLock(range.first + 1, range.second + 1);
+            }
+        }
+    }
+
+    ResetWindow();
+    if (!moved) {
+        std::cerr << "Failed to move the held ranges, staying in the "
+                     "current mode"
+                  << std::endl;
+        state_.store(static_cast<uint8_t>(from), std::memory_order_release);
+        return false;
+    }
+    migrations_.fetch_add(1, std::memory_order_relaxed);
+    state_.store(static_cast<uint8_t>(to), std::memory_order_release);
+    return true;
+}
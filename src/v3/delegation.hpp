@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "range_lock.hpp"
+
+// Delegation front-end for SongRangeLock in the style of ffwd. A dedicated
+// server thread owns the skip list, so it runs without any global lock and
+// its nodes stay in the cache of one core. Clients write a request into a
+// slot of their own and spin on the matching response until the server,
+// which polls all slots in turn, has applied it.
+class DelegatedRangeLock {
+   public:
+    static constexpr size_t CLIENT_SLOTS = 64;
+
+    // The server thread is left to the scheduler by default. A serverCpu of
+    // zero or more pins it to that CPU where the platform allows it.
+    explicit DelegatedRangeLock(int serverCpu = -1);
+    ~DelegatedRangeLock();
+
+    bool tryLock(uint64_t start, uint64_t end);
+    void releaseLock(uint64_t start);
+
+    size_t size() { return rl_.size(); }
+
+   private:
+    // Written by the client and read by the server. seq is bumped last and
+    // publishes the request.
+    struct alignas(64) Request {
+        std::atomic<bool> claimed{false};
+        std::atomic<uint64_t> seq{0};
+        bool release;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // Written only by the server, on a line of its own so that polling
+    // requests and handing back results do not contend
+    struct alignas(64) Response {
+        std::atomic<uint64_t> seq{0};
+        bool result;
+    };
+
+    bool Delegate(bool release, uint64_t start, uint64_t end);
+    void Serve();
+    static size_t PreferredSlot();
+
+    SongRangeLock<NoLock> rl_;
+    std::unique_ptr<Request[]> requests_;
+    std::unique_ptr<Response[]> responses_;
+    std::atomic<bool> stop_{false};
+    std::thread server_;
+};
+
+inline DelegatedRangeLock::DelegatedRangeLock(int serverCpu)
+    : requests_(new Request[CLIENT_SLOTS]),
+      responses_(new Response[CLIENT_SLOTS]),
+      server_(&DelegatedRangeLock::Serve, this) {
+#if defined(__linux__)
+    if (serverCpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(serverCpu, &cpus);
+        if (pthread_setaffinity_np(server_.native_handle(), sizeof(cpus),
+                                   &cpus) != 0) {
+            std::cerr << "Failed to pin the lock server to CPU " << serverCpu
+                      << std::endl;
+        }
+    }
+#else
+    (void)serverCpu;
+#endif
+}
+
+inline DelegatedRangeLock::~DelegatedRangeLock() {
+    stop_.store(true, std::memory_order_relaxed);
+    server_.join();
+}
+
+// Slot a thread tries first. Handing them out round robin keeps up to
+// CLIENT_SLOTS threads from ever sharing one.
+inline size_t DelegatedRangeLock::PreferredSlot() {
+    static std::atomic<size_t> nextSlot{0};
+    thread_local size_t slot = nextSlot.fetch_add(1);
+    return slot;
+}
+
+inline bool DelegatedRangeLock::tryLock(uint64_t start, uint64_t end) {
+    return Delegate(false, start, end);
+}
+
+inline void DelegatedRangeLock::releaseLock(uint64_t start) {
+    Delegate(true, start, 0);
+}
+
+inline bool DelegatedRangeLock::Delegate(bool release, uint64_t start,
+                                         uint64_t end) {
+    size_t i = PreferredSlot() % CLIENT_SLOTS;
+    while (requests_[i].claimed.load(std::memory_order_relaxed) ||
+           requests_[i].claimed.exchange(true, std::memory_order_acquire)) {
+        i = (i + 1) % CLIENT_SLOTS;
+    }
+
+    Request &request = requests_[i];
+    Response &response = responses_[i];
+    request.release = release;
+    request.start = start;
+    request.end = end;
+    uint64_t seq = request.seq.load(std::memory_order_relaxed) + 1;
+    request.seq.store(seq, std::memory_order_release);
+
+    spinThenWait<false>(response.seq, seq - 1);
+    bool result = response.result;
+    request.claimed.store(false, std::memory_order_release);
+    return result;
+}
+
+// Polls every slot in turn and applies the requests whose seq is ahead of
+// the response. A pass that finds no work yields, so that the server does
+// not starve clients when it shares a core with them.
+inline void DelegatedRangeLock::Serve() {
+    while (!stop_.load(std::memory_order_relaxed)) {
+        bool served = false;
+        for (size_t i = 0; i < CLIENT_SLOTS; ++i) {
+            Request &request = requests_[i];
+            Response &response = responses_[i];
+            uint64_t seq = request.seq.load(std::memory_order_acquire);
+            if (seq == response.seq.load(std::memory_order_relaxed)) {
+                continue;
+            }
+
+            if (request.release) {
+                rl_.releaseLock(request.start);
+                response.result = true;
+            } else {
+                response.result = rl_.tryLock(request.start, request.end);
+            }
+            response.seq.store(seq, std::memory_order_release);
+            served = true;
+        }
+        if (!served) {
+            std::this_thread::yield();
+        }
+    }
+}
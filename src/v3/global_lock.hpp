@@ -0,0 +1,238 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Policies for the global lock of SongRangeLock. Besides std::mutex, every
+// policy here is Lockable (lock, try_lock, unlock) and takes a Park flag:
+// waiters spin for SPIN_LIMIT rounds and then either keep spinning with a
+// yield in between (Park = false) or block on the lock word with
+// std::atomic::wait until the holder hands over (Park = true).
+
+constexpr int SPIN_LIMIT = 1024;
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Waits until word no longer holds value
+template <bool Park, typename T>
+void spinThenWait(const std::atomic<T> &word, T value) {
+    for (int i = 0; word.load(std::memory_order_acquire) == value; ++i) {
+        if (i < SPIN_LIMIT) {
+            cpuRelax();
+        } else if (Park) {
+            word.wait(value, std::memory_order_acquire);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Test-and-test-and-set lock on a single word
+template <bool Park = false>
+class TTASLock {
+   public:
+    void lock() {
+        while (!try_lock()) {
+            spinThenWait<Park>(locked, true);
+        }
+    }
+
+    bool try_lock() {
+        return !locked.load(std::memory_order_relaxed) &&
+               !locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+        if (Park) {
+            locked.notify_one();
+        }
+    }
+
+   private:
+    std::atomic<bool> locked{false};
+};
+
+// FIFO ticket lock
+template <bool Park = false>
+class TicketLock {
+   public:
+    void lock() {
+        uint32_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+        for (uint32_t serving = nowServing.load(std::memory_order_acquire);
+             serving != ticket;
+             serving = nowServing.load(std::memory_order_acquire)) {
+            spinThenWait<Park>(nowServing, serving);
+        }
+    }
+
+    bool try_lock() {
+        uint32_t serving = nowServing.load(std::memory_order_acquire);
+        uint32_t expected = serving;
+        return next.compare_exchange_strong(expected, serving + 1,
+                                            std::memory_order_acquire);
+    }
+
+    void unlock() {
+        nowServing.fetch_add(1, std::memory_order_release);
+        if (Park) {
+            // Only the next ticket may proceed, but waiters cannot be told
+            // apart on a shared word
+            nowServing.notify_all();
+        }
+    }
+
+   private:
+    alignas(64) std::atomic<uint32_t> next{0};
+    alignas(64) std::atomic<uint32_t> nowServing{0};
+};
+
+// MCS queue lock. Every waiter spins on its own queue node, and the holder
+// hands the lock directly to its successor. Queue nodes are thread_local,
+// so a thread may hold at most one MCSLock at a time, which holds for the
+// global lock of SongRangeLock.
+template <bool Park = false>
+class MCSLock {
+   public:
+    void lock() {
+        QNode *node = &localNode;
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->locked.store(true, std::memory_order_relaxed);
+
+        QNode *pred = tail.exchange(node, std::memory_order_acq_rel);
+        if (pred != nullptr) {
+            pred->next.store(node, std::memory_order_release);
+            spinThenWait<Park>(node->locked, true);
+        }
+    }
+
+    bool try_lock() {
+        QNode *node = &localNode;
+        node->next.store(nullptr, std::memory_order_relaxed);
+        QNode *expected = nullptr;
+        return tail.compare_exchange_strong(expected, node,
+                                            std::memory_order_acq_rel);
+    }
+
+    void unlock() {
+        QNode *node = &localNode;
+        QNode *succ = node->next.load(std::memory_order_acquire);
+        if (succ == nullptr) {
+            QNode *expected = node;
+            if (tail.compare_exchange_strong(expected, nullptr,
+                                             std::memory_order_acq_rel)) {
+                return;
+            }
+            // A successor swapped itself in but has not linked yet
+            spinThenWait<false>(node->next, static_cast<QNode *>(nullptr));
+            succ = node->next.load(std::memory_order_acquire);
+        }
+        succ->locked.store(false, std::memory_order_release);
+        if (Park) {
+            succ->locked.notify_one();
+        }
+    }
+
+   private:
+    struct alignas(64) QNode {
+        std::atomic<QNode *> next{nullptr};
+        std::atomic<bool> locked{false};
+    };
+
+    static thread_local QNode localNode;
+    alignas(64) std::atomic<QNode *> tail{nullptr};
+};
+
+template <bool Park>
+thread_local typename MCSLock<Park>::QNode MCSLock<Park>::localNode;
+
+// std::mutex that tries to get the lock for SPIN_LIMIT rounds before
+// blocking in the kernel
+class SpinThenParkMutex {
+   public:
+    void lock() {
+        for (int i = 0; i < SPIN_LIMIT; ++i) {
+            if (mutex.try_lock()) {
+                return;
+            }
+            cpuRelax();
+        }
+        mutex.lock();
+    }
+
+    bool try_lock() { return mutex.try_lock(); }
+
+    void unlock() { mutex.unlock(); }
+
+   private:
+    std::mutex mutex;
+};
+
+// std::mutex that counts its acquisitions, those that found it taken and the
+// time spent waiting for those, so that its owner can read how contended
+// it was. The counts belong to the instance and are only written while it
+// is held, so an uncontended lock costs no more than a std::mutex.
+class SampledMutex {
+   public:
+    struct Stats {
+        uint64_t acquisitions = 0;
+        uint64_t contended = 0;
+        uint64_t waitNanos = 0;
+    };
+
+    Stats stats() const {
+        return {acquisitions.load(std::memory_order_relaxed),
+                contended.load(std::memory_order_relaxed),
+                waitNanos.load(std::memory_order_relaxed)};
+    }
+
+    void lock() {
+        if (mutex.try_lock()) {
+            Add(acquisitions, 1);
+            return;
+        }
+        auto begin = std::chrono::steady_clock::now();
+        mutex.lock();
+        Add(acquisitions, 1);
+        Add(contended, 1);
+        Add(waitNanos, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - begin)
+                           .count());
+    }
+
+    bool try_lock() { return mutex.try_lock(); }
+
+    void unlock() { mutex.unlock(); }
+
+   private:
+    // Only the holder writes, readers may see a count that is behind
+    static void Add(std::atomic<uint64_t> &count, uint64_t n) {
+        count.store(count.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+    }
+
+    std::mutex mutex;
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> contended{0};
+    std::atomic<uint64_t> waitNanos{0};
+};
+
+// No locking at all, for a SongRangeLock that only a single thread ever
+// touches, such as the one owned by the delegation server
+class NoLock {
+   public:
+    void lock() {}
+
+    bool try_lock() { return true; }
+
+    void unlock() {}
+};
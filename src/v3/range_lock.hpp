@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <iomanip>
 #include <iostream>
 #include <memory>
@@ -9,6 +11,8 @@
 #include <sstream>
 #include <vector>
 
+#include "global_lock.hpp"
+
 class SkipListNode {
    public:
     uint64_t start;
@@ -27,29 +31,400 @@ class SkipListNode {
     ~SkipListNode() { free(forward); }
 };
 
+// With flatCombining set, threads do not queue on the global lock. They
+// publish their request in a slot, and whichever thread holds the lock
+// applies all published requests in one go and hands the results back
+// through the slots. Lock is the policy of the global lock, see
+// global_lock.hpp.
+template <typename Lock = std::mutex>
 class SongRangeLock {
    public:
     static constexpr uint8_t MAX_LEVEL = 3;
     static constexpr uint64_t MAX_VALUE = ~0ULL;
+    static constexpr size_t COMBINING_SLOTS = 64;
 
-    explicit SongRangeLock();
+    explicit SongRangeLock(bool flatCombining = false);
     ~SongRangeLock();
 
     bool tryLock(uint64_t start, uint64_t end);
     void releaseLock(uint64_t start);
 
+    // Batch versions for callers holding many ranges. ranges must be sorted
+    // by start and disjoint, or both calls return false and change nothing.
+    // Each call takes the global lock once and walks the list once for the
+    // whole batch. tryLockBatch is all-or-nothing, releaseLockBatch releases
+    // every held range of the batch and returns false if one was not held.
+    bool tryLockBatch(const std::vector<std::pair<uint64_t, uint64_t>>& ranges);
+    bool releaseLockBatch(
+        const std::vector<std::pair<uint64_t, uint64_t>>& ranges);
+
     size_t size();
     void displayList();
 
+    // For reading statistics a Lock keeps, such as those of SampledMutex
+    const Lock& globalLock() const { return globalLock_; }
+
     SkipListNode* head_;
     SkipListNode* tail_;
 
    private:
+    // A request published in flat-combining mode, one per cache line
+    struct alignas(64) CombiningSlot {
+        enum State : uint8_t { EMPTY, PENDING, DONE };
+
+        std::atomic<bool> claimed{false};
+        std::atomic<uint8_t> state{EMPTY};
+        bool release;
+        bool result;
+        uint64_t start;
+        uint64_t end;
+    };
+
     SkipListNode* AllocNode(uint64_t start, uint64_t end, uint8_t level);
     bool FindNodes(uint64_t start, uint64_t end, SkipListNode** out_nodes);
+    bool FindNodesFrom(uint64_t start, uint64_t end, SkipListNode** nodes);
     void InsertRange(SkipListNode** nodes, uint64_t start, uint64_t end);
     int randomLevel();
+    static size_t PreferredSlot();
+    static bool SortedAndDisjoint(
+        const std::vector<std::pair<uint64_t, uint64_t>>& ranges);
+
+    bool TryLockLocked(uint64_t start, uint64_t end);
+    void ReleaseLocked(uint64_t start);
+    bool ReleaseFrom(uint64_t start, SkipListNode** preds);
+    bool Combine(bool release, uint64_t start, uint64_t end);
+    void ApplyCombined();
 
-    std::mutex spinlock_;
+    Lock globalLock_;
     std::atomic<size_t> elementsCount{0};
-};
\ No newline at end of file
+    const bool flatCombining_;
+    std::unique_ptr<CombiningSlot[]> slots_;
+};
+
+// Slot a thread tries first in flat-combining mode. Handing them out round
+// robin keeps up to COMBINING_SLOTS threads from ever sharing one.
+template <typename Lock>
+size_t SongRangeLock<Lock>::PreferredSlot() {
+    static std::atomic<size_t> nextSlot{0};
+    thread_local size_t slot = nextSlot.fetch_add(1);
+    return slot;
+}
+
+template <typename Lock>
+SongRangeLock<Lock>::SongRangeLock(bool flatCombining)
+    : head_(AllocNode(0, 0, MAX_LEVEL)),
+      tail_(AllocNode(MAX_VALUE, MAX_VALUE, MAX_LEVEL)),
+      flatCombining_(flatCombining),
+      slots_(flatCombining ? new CombiningSlot[COMBINING_SLOTS] : nullptr) {
+    for (auto i = 0; i <= MAX_LEVEL; ++i) {
+        head_->forward[i] = tail_;
+    }
+}
+
+template <typename Lock>
+SongRangeLock<Lock>::~SongRangeLock() {
+    auto p = head_;
+    do {
+        auto q = p->forward[0];
+        free(p);
+        p = q;
+    } while (p != nullptr);
+}
+
+template <typename Lock>
+SkipListNode *SongRangeLock<Lock>::AllocNode(uint64_t start, uint64_t end,
+                                   uint8_t level) {
+    return new SkipListNode(start, end, level);
+}
+
+template <typename Lock>
+bool SongRangeLock<Lock>::FindNodes(uint64_t start, uint64_t end,
+                          SkipListNode **out_nodes) {
+    std::fill(out_nodes, out_nodes + MAX_LEVEL + 1, head_);
+    return FindNodesFrom(start, end, out_nodes);
+}
+
+// FindNodes that resumes from the predecessors already in nodes, which must
+// all precede start. On every level the walk starts from whichever is
+// further along, the node from the level above or nodes[k], so a sorted
+// batch walks the list once instead of once per range.
+template <typename Lock>
+bool SongRangeLock<Lock>::FindNodesFrom(uint64_t start, uint64_t end,
+                                        SkipListNode **nodes) {
+    SkipListNode *curr;
+    auto pred = head_;
+    for (int k = MAX_LEVEL; k >= 0; k--) {
+        if (nodes[k]->start > pred->start) {
+            pred = nodes[k];
+        }
+        while (curr = pred->forward[k], curr->end < start) {
+            pred = curr;
+        }
+        nodes[k] = pred;
+    }
+
+    if (pred == head_) {
+        return !(start >= pred->end && end < curr->start);
+    } else {
+        return !(start > pred->end && end < curr->start);
+    }
+}
+
+template <typename Lock>
+void SongRangeLock<Lock>::InsertRange(SkipListNode **nodes, uint64_t start,
+                            uint64_t end) {
+    auto lv = randomLevel();
+
+    /* Insert start and end */
+    auto q = AllocNode(start, end, lv);  //
+    for (auto k = 0; k <= lv; k++) {
+        auto p = nodes[k];
+        q->forward[k] = p->forward[k];
+        p->forward[k] = q;
+    }
+}
+
+template <typename Lock>
+bool SongRangeLock<Lock>::tryLock(uint64_t start, uint64_t end) {
+    if (flatCombining_) {
+        return Combine(false, start, end);
+    }
+    std::lock_guard<Lock> lock(globalLock_);
+    return TryLockLocked(start, end);
+}
+
+template <typename Lock>
+void SongRangeLock<Lock>::releaseLock(uint64_t start) {
+    if (flatCombining_) {
+        Combine(true, start, 0);
+        return;
+    }
+    std::lock_guard<Lock> lock(globalLock_);
+    ReleaseLocked(start);
+}
+
+template <typename Lock>
+bool SongRangeLock<Lock>::TryLockLocked(uint64_t start, uint64_t end) {
+    SkipListNode *nodes[MAX_LEVEL + 1];
+
+    if (FindNodes(start, end, nodes)) {
+        return false;
+    }
+
+    InsertRange(nodes, start, end);
+    elementsCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+template <typename Lock>
+bool SongRangeLock<Lock>::tryLockBatch(
+    const std::vector<std::pair<uint64_t, uint64_t>> &ranges) {
+    if (!SortedAndDisjoint(ranges)) {
+        return false;
+    }
+
+    // Flat-combining mode only ever try_locks, so the batch can take the
+    // global lock directly in both modes
+    std::lock_guard<Lock> lock(globalLock_);
+    SkipListNode *nodes[MAX_LEVEL + 1];
+
+    std::fill(nodes, nodes + MAX_LEVEL + 1, head_);
+    for (auto &range : ranges) {
+        if (FindNodesFrom(range.first, range.second, nodes)) {
+            return false;
+        }
+    }
+
+    std::fill(nodes, nodes + MAX_LEVEL + 1, head_);
+    for (auto &range : ranges) {
+        FindNodesFrom(range.first, range.second, nodes);
+        InsertRange(nodes, range.first, range.second);
+    }
+    elementsCount.fetch_add(ranges.size(), std::memory_order_relaxed);
+    return true;
+}
+
+// ReleaseFrom only walks forward, so an unsorted batch would skip ranges
+template <typename Lock>
+bool SongRangeLock<Lock>::releaseLockBatch(
+    const std::vector<std::pair<uint64_t, uint64_t>> &ranges) {
+    if (!SortedAndDisjoint(ranges)) {
+        std::cerr << "Batch not sorted and disjoint. Wrong usage of "
+                     "releaseLockBatch."
+                  << std::endl;
+        return false;
+    }
+
+    std::lock_guard<Lock> lock(globalLock_);
+    SkipListNode *preds[MAX_LEVEL + 1];
+    bool released = true;
+
+    std::fill(preds, preds + MAX_LEVEL + 1, head_);
+    for (auto &range : ranges) {
+        released &= ReleaseFrom(range.first, preds);
+    }
+    return released;
+}
+
+template <typename Lock>
+bool SongRangeLock<Lock>::SortedAndDisjoint(
+    const std::vector<std::pair<uint64_t, uint64_t>> &ranges) {
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        if (ranges[i].first <= ranges[i - 1].second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Lock>
+void SongRangeLock<Lock>::ReleaseLocked(uint64_t start) {
+    SkipListNode *preds[MAX_LEVEL + 1];
+
+    std::fill(preds, preds + MAX_LEVEL + 1, head_);
+    ReleaseFrom(start, preds);
+}
+
+// Unlinks the range starting at start, resuming from the predecessors in
+// preds like FindNodesFrom. preds is left pointing in front of the next
+// range, so a sorted batch can pass it on. Returns false, and leaves the
+// list alone, if no held range starts at start.
+template <typename Lock>
+bool SongRangeLock<Lock>::ReleaseFrom(uint64_t start, SkipListNode **preds) {
+    SkipListNode *curr;
+    SkipListNode *succ;
+
+    auto pred = head_;
+    for (int level = static_cast<int>(MAX_LEVEL); level >= 0; level--) {
+        if (preds[level]->start > pred->start) {
+            pred = preds[level];
+        }
+        while ((succ = pred->forward[level]) && succ->start < start) {
+            pred = succ;
+        }
+        preds[level] = pred;
+    }
+    curr = preds[0]->forward[0];
+    if (curr == tail_ || curr->start != start) {
+        std::cerr << "Range not held. Wrong usage of releaseLock. " << start
+                  << std::endl;
+        return false;
+    }
+
+    for (int level = 0;
+         level <= MAX_LEVEL && (pred = preds[level])->forward[level] == curr;
+         level++) {
+        pred->forward[level] = curr->forward[level];
+    }
+
+    elementsCount.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Publishes one request and waits for it to be applied. While waiting, the
+// thread tries to become the combiner itself, so a request never waits on a
+// combiner that has already finished its pass.
+template <typename Lock>
+bool SongRangeLock<Lock>::Combine(bool release, uint64_t start, uint64_t end) {
+    size_t i = PreferredSlot() % COMBINING_SLOTS;
+    while (slots_[i].claimed.load(std::memory_order_relaxed) ||
+           slots_[i].claimed.exchange(true, std::memory_order_acquire)) {
+        i = (i + 1) % COMBINING_SLOTS;
+    }
+
+    CombiningSlot &slot = slots_[i];
+    slot.release = release;
+    slot.start = start;
+    slot.end = end;
+    slot.state.store(CombiningSlot::PENDING, std::memory_order_release);
+
+    while (slot.state.load(std::memory_order_acquire) !=
+           CombiningSlot::DONE) {
+        if (globalLock_.try_lock()) {
+            ApplyCombined();
+            globalLock_.unlock();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    bool result = slot.result;
+    slot.state.store(CombiningSlot::EMPTY, std::memory_order_relaxed);
+    slot.claimed.store(false, std::memory_order_release);
+    return result;
+}
+
+// One combining pass over all slots, called with the global lock held
+template <typename Lock>
+void SongRangeLock<Lock>::ApplyCombined() {
+    for (size_t i = 0; i < COMBINING_SLOTS; ++i) {
+        CombiningSlot &slot = slots_[i];
+        if (slot.state.load(std::memory_order_acquire) !=
+            CombiningSlot::PENDING) {
+            continue;
+        }
+        if (slot.release) {
+            ReleaseLocked(slot.start);
+            slot.result = true;
+        } else {
+            slot.result = TryLockLocked(slot.start, slot.end);
+        }
+        slot.state.store(CombiningSlot::DONE, std::memory_order_release);
+    }
+}
+
+template <typename Lock>
+void SongRangeLock<Lock>::displayList() {
+    std::cout << "Concurrent Range Lock" << std::endl;
+
+    if (elementsCount == 0) {
+        std::cout << "List is empty" << std::endl;
+        return;
+    }
+
+    int len = static_cast<int>(elementsCount);
+
+    std::vector<std::vector<std::string>> builder(
+        len, std::vector<std::string>(MAX_LEVEL + 1));
+
+    auto *current = head_->forward[0];
+
+    for (int i = 0; i < len; ++i) {
+        for (int j = 0; j <= MAX_LEVEL; ++j) {
+            if (j <= current->level) {
+                std::ostringstream oss;
+                oss << "[" << std::setw(2) << std::setfill('0')
+                    << current->start << "," << std::setw(2)
+                    << std::setfill('0') << current->end << "]";
+                builder[i][j] = oss.str();
+            } else {
+                builder[i][j] = "---------";
+            }
+        }
+        current = current->forward[0];
+    }
+
+    for (int i = MAX_LEVEL; i >= 0; --i) {
+        std::cout << "Level " << i << ": head ";
+        for (int j = 0; j < len; ++j) {
+            if (builder[j][i] == "---------") {
+                std::cout << "---------";
+            } else {
+                std::cout << "->" << builder[j][i];
+            }
+        }
+        std::cout << "---> tail" << std::endl;
+    }
+}
+
+template <typename Lock>
+size_t SongRangeLock<Lock>::size() { return elementsCount.load(); }
+
+template <typename Lock>
+int SongRangeLock<Lock>::randomLevel() {
+    int level = 0;
+    while (rand() % 2 && level < MAX_LEVEL) {
+        level++;
+    }
+    return level;
+}
\ No newline at end of file
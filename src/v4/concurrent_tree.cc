@@ -11,7 +11,7 @@ void concurrent_tree::destroy(void) { m_root.destroy_root(); }
 bool concurrent_tree::is_empty(void) { return m_root.is_empty(); }
 
 uint64_t concurrent_tree::get_insertion_memory_overhead(void) {
-    return sizeof(treenode);
+    return treenode::get_alloc_footprint();
 }
 
 void concurrent_tree::locked_keyrange::prepare(concurrent_tree *tree) {
@@ -42,16 +42,37 @@ void concurrent_tree::locked_keyrange::acquire(uint64_t left, uint64_t right) {
     m_subtree = subtree;
 }
 
+void concurrent_tree::locked_keyrange::acquire_optimistic(
+    concurrent_tree *tree, uint64_t left, uint64_t right) {
+    keyrange range;
+    range.create(left, right);
+
+    const int attempts = treenode::is_pooling() ? MAX_OPTIMISTIC_ATTEMPTS : 0;
+    for (int attempt = 0; attempt < attempts; attempt++) {
+        treenode *subtree = tree->m_root.find_and_lock_optimistic(range);
+        if (subtree != nullptr) {
+            m_tree = tree;
+            m_range = range;
+            m_subtree = subtree;
+            return;
+        }
+    }
+
+    prepare(tree);
+    acquire(left, right);
+}
+
 void concurrent_tree::locked_keyrange::release(void) {
     m_subtree->mutex_unlock();
 }
 
-void concurrent_tree::locked_keyrange::insert(const keyrange &range) {
+void concurrent_tree::locked_keyrange::insert(const keyrange &range,
+                                              TXNID txnid) {
     // empty means no children, and only the root should ever be empty
     if (m_subtree->is_empty()) {
-        m_subtree->set_range_and_txnid(range);
+        m_subtree->set_range_and_txnid(range, txnid);
     } else {
-        m_subtree->insert(range);
+        m_subtree->insert(range, txnid);
     }
 }
 
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "keyrange.h"
 #include "treenode.h"
 
@@ -14,6 +16,10 @@ class concurrent_tree {
     // - user breaks the serialzation point by acquiring a range, or releasing.
     // - one thread operates on a certain locked_keyrange object at a time.
     // - when the thread is finished, it releases
+    //
+    // acquire_optimistic() skips the serialization point: it reads node
+    // versions down to the subtree covering the range and latches only
+    // that, and behaves like prepare() followed by acquire() otherwise.
 
     class locked_keyrange {
        public:
@@ -37,14 +43,34 @@ class concurrent_tree {
         //         by the given range
         void acquire(uint64_t left, uint64_t right);
 
+        // effect: acquire a locked keyrange over the given concurrent_tree
+        //         without prepare(), by an optimistic descent that takes no
+        //         locks above the subtree it latches. falls back to
+        //         prepare() and acquire() after MAX_OPTIMISTIC_ATTEMPTS
+        //         descents that ran into concurrent changes, and always
+        //         with the treenode pool off, since the descent relies on
+        //         freed nodes staying treenodes.
+        // rationale: threads working on disjoint ranges do not queue
+        //            behind the root mutex.
+        void acquire_optimistic(concurrent_tree *tree, uint64_t left,
+                                uint64_t right);
+
         // effect: releases a locked keyrange and the mutex it holds
         void release(void);
 
+        // effect: calls function->fn() on each range, txnid pair in this
+        //         locked_keyrange that overlaps its range, in key order.
+        //         the iteration stops early if fn() returns false.
+        // rationale: this is how callers check for conflicts, and how a
+        //            prepared keyrange can visit every range in the tree.
+        template <class F>
+        void iterate(F *function) const;
+
         // inserts the given range into the tree, with an associated txnid.
         // requires: range does not overlap with anything in this
         // locked_keyrange rationale: caller is responsible for only inserting
         // unique ranges
-        void insert(const keyrange &range);
+        void insert(const keyrange &range, TXNID txnid);
 
         // effect: removes the given range from the tree
         // requires: range exists exactly in this locked_keyrange
@@ -52,6 +78,8 @@ class concurrent_tree {
         void remove(const keyrange &range);
 
        private:
+        static const int MAX_OPTIMISTIC_ATTEMPTS = 8;
+
         // the concurrent tree this locked keyrange is for
         concurrent_tree *m_tree;
 
@@ -72,7 +100,9 @@ class concurrent_tree {
     // returns: true if the tree is empty
     bool is_empty(void);
 
-    // returns: the memory overhead of a single insertion into the tree
+    // returns: the memory overhead of a single insertion into the tree,
+    //          one treenode with its share of the slab and allocator
+    //          overhead
     static uint64_t get_insertion_memory_overhead(void);
 
    private:
@@ -81,3 +111,12 @@ class concurrent_tree {
     // here and not a pointer to one.
     treenode m_root;
 };
+
+template <class F>
+void concurrent_tree::locked_keyrange::iterate(F *function) const {
+    // if the subtree is non-empty, traverse it by calling the given
+    // function on each range, txnid pair found that overlaps.
+    if (!m_subtree->is_empty()) {
+        m_subtree->traverse_overlaps(m_range, function);
+    }
+}
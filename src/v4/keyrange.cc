@@ -13,7 +13,7 @@ keyrange::comparison keyrange::compare(const keyrange &range) const {
         return comparison::LESS_THAN;
     } else if (m_left_key > range.m_right_key) {
         return comparison::GREATER_THAN;
-    } else if ((m_right_key == m_right_key) &&
+    } else if ((m_right_key == range.m_right_key) &&
                (m_left_key == range.m_left_key)) {
         return comparison::EQUALS;
     } else {
@@ -30,7 +30,7 @@ bool keyrange::overlaps(const keyrange &range) const {
 
 keyrange keyrange::get_infinite_range(void) {
     keyrange range;
-    range.create(UINT64_MAX, UINT64_MAX);
+    range.create(0, UINT64_MAX);
     return range;
 }
 
@@ -0,0 +1,167 @@
+#include "locktree.h"
+
+namespace {
+
+// collects the ranges overlapping an acquire request and notes
+// whether any of them belongs to another owner.
+struct conflict_collector {
+    TXNID m_txnid;
+    bool m_conflict;
+    std::vector<keyrange> m_ranges;
+
+    bool fn(const keyrange &range, TXNID txnid) {
+        if (txnid != m_txnid) {
+            m_conflict = true;
+            return false;
+        }
+        m_ranges.push_back(range);
+        return true;
+    }
+};
+
+// collects every range, txnid pair in key order.
+struct range_collector {
+    std::vector<std::pair<keyrange, TXNID>> m_ranges;
+
+    bool fn(const keyrange &range, TXNID txnid) {
+        m_ranges.emplace_back(range, txnid);
+        return true;
+    }
+};
+
+// collects only the ranges that belong to a single owner.
+struct owner_collector {
+    TXNID m_txnid;
+    std::vector<keyrange> m_ranges;
+
+    bool fn(const keyrange &range, TXNID txnid) {
+        if (txnid == m_txnid) {
+            m_ranges.push_back(range);
+        }
+        return true;
+    }
+};
+
+}  // namespace
+
+void locktree::create(uint64_t escalation_threshold) {
+    m_escalation_threshold = escalation_threshold;
+    m_rangetree.create();
+}
+
+void locktree::destroy(void) {
+    m_rangetree.destroy();
+    m_range_counts.clear();
+}
+
+uint64_t locktree::update_range_count(TXNID txnid, int64_t delta) {
+    std::lock_guard<std::mutex> lock(m_counts_mutex);
+    uint64_t &count = m_range_counts[txnid];
+    count += delta;
+    return count;
+}
+
+uint64_t locktree::get_range_count(TXNID txnid) {
+    std::lock_guard<std::mutex> lock(m_counts_mutex);
+    auto it = m_range_counts.find(txnid);
+    return it == m_range_counts.end() ? 0 : it->second;
+}
+
+bool locktree::acquire_write_lock(TXNID txnid, uint64_t left,
+                                  uint64_t right) {
+    keyrange range;
+    range.create(left, right);
+
+    concurrent_tree::locked_keyrange lkr;
+    lkr.prepare(&m_rangetree);
+    lkr.acquire(left, right);
+
+    conflict_collector overlaps{txnid, false, {}};
+    lkr.iterate(&overlaps);
+    if (overlaps.m_conflict) {
+        lkr.release();
+        return false;
+    }
+
+    // consolidate the ranges txnid already holds here with the new one,
+    // so that the tree stays non-overlapping.
+    keyrange merged = range;
+    for (const keyrange &overlap : overlaps.m_ranges) {
+        lkr.remove(overlap);
+        if (overlap.m_left_key < merged.m_left_key) {
+            merged.m_left_key = overlap.m_left_key;
+        }
+        if (overlap.m_right_key > merged.m_right_key) {
+            merged.m_right_key = overlap.m_right_key;
+        }
+    }
+    lkr.insert(merged, txnid);
+    lkr.release();
+
+    const int64_t delta = 1 - static_cast<int64_t>(overlaps.m_ranges.size());
+    if (update_range_count(txnid, delta) > m_escalation_threshold) {
+        escalate(txnid);
+    }
+    return true;
+}
+
+void locktree::release_locks(TXNID txnid) {
+    // a prepared keyrange covers the whole tree, so one traversal
+    // finds every range txnid holds.
+    concurrent_tree::locked_keyrange lkr;
+    lkr.prepare(&m_rangetree);
+
+    owner_collector owned{txnid, {}};
+    lkr.iterate(&owned);
+    for (const keyrange &range : owned.m_ranges) {
+        lkr.remove(range);
+    }
+    lkr.release();
+
+    std::lock_guard<std::mutex> lock(m_counts_mutex);
+    m_range_counts.erase(txnid);
+}
+
+void locktree::escalate(TXNID txnid) {
+    // preparing serializes us behind every thread that is still inside
+    // the tree, and the traversal waits for each of them to release
+    // before it passes their subtree. once it completes, nobody else can
+    // insert into a gap between txnid's ranges until we release.
+    concurrent_tree::locked_keyrange lkr;
+    lkr.prepare(&m_rangetree);
+
+    range_collector all;
+    lkr.iterate(&all);
+
+    uint64_t escalated_count = 0;
+    const size_t n = all.m_ranges.size();
+    for (size_t i = 0; i < n;) {
+        if (all.m_ranges[i].second != txnid) {
+            i++;
+            continue;
+        }
+
+        // extend the run while the next range in key order is also ours
+        size_t j = i;
+        while (j + 1 < n && all.m_ranges[j + 1].second == txnid) {
+            j++;
+        }
+
+        if (j > i) {
+            for (size_t k = i; k <= j; k++) {
+                lkr.remove(all.m_ranges[k].first);
+            }
+            keyrange covering;
+            covering.create(all.m_ranges[i].first.m_left_key,
+                            all.m_ranges[j].first.m_right_key);
+            lkr.insert(covering, txnid);
+        }
+
+        escalated_count++;
+        i = j + 1;
+    }
+    lkr.release();
+
+    std::lock_guard<std::mutex> lock(m_counts_mutex);
+    m_range_counts[txnid] = escalated_count;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "concurrent_tree.h"
+
+// A locktree hands out write locks over key ranges to owners (txnids),
+// in the style of the TokuDB locktree. Every held range lives in a
+// concurrent_tree tagged with the txnid that owns it.
+//
+// Owners that lock many small ranges bloat the tree and slow down every
+// other thread's descent. Once an owner holds more than the escalation
+// threshold, its adjacent ranges are merged into covering ranges, as long
+// as no other owner holds a range in between.
+class locktree {
+   public:
+    // effect: initialize an empty locktree. an owner's ranges are escalated
+    //         once it holds more than escalation_threshold of them.
+    void create(uint64_t escalation_threshold);
+
+    // effect: destroy the locktree.
+    // requires: every owner has released its locks
+    void destroy(void);
+
+    // effect: acquires a write lock over [left, right] for txnid. ranges
+    //         already held by txnid that overlap are consolidated with it.
+    // returns: true if the lock was granted, false if a range held by
+    //          another txnid overlaps [left, right]
+    bool acquire_write_lock(TXNID txnid, uint64_t left, uint64_t right);
+
+    // effect: releases every range held by txnid in one pass over the tree
+    void release_locks(TXNID txnid);
+
+    // effect: merges each run of ranges held by txnid that are adjacent in
+    //         key order, i.e. no other owner holds a range in between, into
+    //         one range covering the whole run.
+    void escalate(TXNID txnid);
+
+    // returns: the number of ranges txnid currently holds in the tree
+    uint64_t get_range_count(TXNID txnid);
+
+   private:
+    concurrent_tree m_rangetree;
+
+    uint64_t m_escalation_threshold;
+
+    // number of ranges held per owner. guarded by m_counts_mutex since
+    // threads in disjoint subtrees update it concurrently.
+    std::mutex m_counts_mutex;
+    std::unordered_map<TXNID, uint64_t> m_range_counts;
+
+    // effect: adds delta to the range count of txnid
+    // returns: the new range count of txnid
+    uint64_t update_range_count(TXNID txnid, int64_t delta);
+};
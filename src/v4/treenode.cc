@@ -1,10 +1,147 @@
 #include "treenode.h"
 
-void treenode::mutex_lock(void) { m_mutex.lock(); }
+// treenodes are carved out of per-thread slabs of SLAB_NODES nodes. freed
+// nodes go on an intrusive free list of the freeing thread, linked through
+// their left child pointer, and are handed out again before the slab is
+// carved any further. slabs are never returned to the system, so a pointer
+// to a freed node always points at a treenode, which optimistic descents
+// rely on. when a thread exits, its free nodes and the rest of its slab
+// move to a shared list that other threads take over once theirs is empty.
+struct treenode::pool {
+    static const size_t SLAB_NODES = 64;
+
+    struct slab {
+        treenode nodes[SLAB_NODES];
+    };
+
+    treenode *free_nodes = nullptr;
+    slab *current = nullptr;
+    size_t carved = SLAB_NODES;
+
+    ~pool();
+
+    // returns: a freed node, or null if there is none
+    treenode *pop(void);
+
+    void push(treenode *node);
+
+    // returns: an unused node from the current slab, starting a new slab
+    //          if it is used up
+    treenode *carve(void);
+
+    static std::atomic<bool> enabled;
+    static std::mutex shared_mutex;
+    static treenode *shared_nodes;
+    static std::atomic<bool> shared_nonempty;
+    static thread_local pool local;
+};
+
+std::atomic<bool> treenode::pool::enabled{true};
+std::mutex treenode::pool::shared_mutex;
+treenode *treenode::pool::shared_nodes = nullptr;
+std::atomic<bool> treenode::pool::shared_nonempty{false};
+thread_local treenode::pool treenode::pool::local;
+
+treenode::pool::~pool() {
+    while (current != nullptr && carved < SLAB_NODES) {
+        treenode *node = &current->nodes[carved++];
+        node->m_pooled = true;
+        push(node);
+    }
+    if (free_nodes == nullptr) {
+        return;
+    }
+
+    treenode *tail = free_nodes;
+    while (tail->m_left_child.ptr != nullptr) {
+        tail = tail->m_left_child.ptr;
+    }
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    tail->m_left_child.ptr = shared_nodes;
+    shared_nodes = free_nodes;
+    shared_nonempty.store(true, std::memory_order_relaxed);
+}
+
+treenode *treenode::pool::pop(void) {
+    if (free_nodes == nullptr &&
+        shared_nonempty.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(shared_mutex);
+        free_nodes = shared_nodes;
+        shared_nodes = nullptr;
+        shared_nonempty.store(false, std::memory_order_relaxed);
+    }
+    treenode *node = free_nodes;
+    if (node != nullptr) {
+        free_nodes = node->m_left_child.ptr;
+    }
+    return node;
+}
 
-void treenode::mutex_unlock(void) { m_mutex.unlock(); }
+void treenode::pool::push(treenode *node) {
+    node->m_left_child.ptr = free_nodes;
+    free_nodes = node;
+}
+
+treenode *treenode::pool::carve(void) {
+    if (carved == SLAB_NODES) {
+        current = new slab();
+        carved = 0;
+    }
+    treenode *node = &current->nodes[carved++];
+    node->m_pooled = true;
+    return node;
+}
+
+namespace {
+
+// returns: the bytes malloc takes for a request of the given size, for a
+//          glibc-style allocator with an 8 byte chunk header, 16 byte
+//          granularity and 32 byte chunks at least
+uint64_t malloc_footprint(uint64_t bytes) {
+    const uint64_t chunk = (bytes + sizeof(size_t) + 15) & ~uint64_t(15);
+    return chunk < 32 ? 32 : chunk;
+}
+
+}  // namespace
+
+void treenode::set_pooling(bool enabled) {
+    pool::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool treenode::is_pooling(void) {
+    return pool::enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t treenode::get_alloc_footprint(void) {
+    if (!is_pooling()) {
+        return malloc_footprint(sizeof(treenode));
+    }
+    // a slab is one malloc shared by SLAB_NODES nodes, rounded up
+    const uint64_t slab_bytes = malloc_footprint(sizeof(pool::slab));
+    return (slab_bytes + pool::SLAB_NODES - 1) / pool::SLAB_NODES;
+}
+
+void treenode::mutex_lock(void) {
+    m_mutex.lock();
+    m_version.store(m_version.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    // keep the writes made under the lock from passing the odd version
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void treenode::mutex_unlock(void) {
+    m_version.store(m_version.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    m_mutex.unlock();
+}
+
+bool treenode::validate_version(uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return m_version.load(std::memory_order_relaxed) == version;
+}
 
 void treenode::init() {
+    m_txnid = TXNID_NONE;
     m_is_root = false;
     m_is_empty = true;
     m_left_child.set(nullptr);
@@ -21,10 +158,11 @@ void treenode::destroy_root(void) {
     // invariant(is_empty());
 }
 
-void treenode::set_range_and_txnid(const keyrange &range) {
+void treenode::set_range_and_txnid(const keyrange &range, TXNID txnid) {
     // allocates a new copy of the range for this node
     // m_range.create_copy(range);
     m_range.create_copy(range);
+    m_txnid = txnid;
     m_is_empty = false;
 }
 
@@ -36,10 +174,28 @@ bool treenode::range_overlaps(const keyrange &range) {
     return m_range.overlaps(range);
 }
 
-treenode *treenode::alloc(const keyrange &range) {
-    treenode *node = new treenode();
+treenode *treenode::alloc(const keyrange &range, TXNID txnid) {
+    if (!is_pooling()) {
+        treenode *node = new treenode();
+        node->init();
+        node->set_range_and_txnid(range, txnid);
+        return node;
+    }
+
+    treenode *node = pool::local.pop();
+    if (node == nullptr) {
+        node = pool::local.carve();
+        node->init();
+        node->set_range_and_txnid(range, txnid);
+        return node;
+    }
+
+    // a stale optimistic reader may still hold a pointer to this node,
+    // so reinitialize it under the lock to move its version on
+    node->mutex_lock();
     node->init();
-    node->set_range_and_txnid(range);
+    node->set_range_and_txnid(range, txnid);
+    node->mutex_unlock();
     return node;
 }
 
@@ -47,6 +203,11 @@ void treenode::free(treenode *node) {
     // the root is simply marked as empty.
     if (node->is_root()) {
         node->m_is_empty = true;
+        node->m_txnid = TXNID_NONE;
+    } else if (node->m_pooled) {
+        pool::local.push(node);
+    } else {
+        delete node;
     }
 }
 
@@ -94,53 +255,114 @@ treenode *treenode::find_node_with_overlapping_child(
     }
 }
 
-void treenode::insert(const keyrange &range) {
+treenode *treenode::find_and_lock_optimistic(const keyrange &range) {
+    const uint64_t root_version = m_version.load(std::memory_order_acquire);
+    if (root_version & 1) {
+        return nullptr;
+    }
+
+    // the same descent as find_node_with_overlapping_child, except that
+    // every step reads the child's version before validating the parent,
+    // so the child was still linked when it was read. freed nodes are
+    // never deleted, so following a stale pointer is harmless.
+    treenode *node = this;
+    uint64_t version = root_version;
+    if (!m_is_empty && !m_range.overlaps(range)) {
+        for (uint32_t depth = 0;; depth++) {
+            if (depth == OPTIMISTIC_MAX_DEPTH) {
+                node = this;
+                version = root_version;
+                break;
+            }
+
+            keyrange::comparison c = range.compare(node->m_range);
+            treenode *child = c == keyrange::comparison::LESS_THAN
+                                  ? node->m_left_child.ptr
+                                  : node->m_right_child.ptr;
+            if (child == nullptr) {
+                break;
+            }
+
+            const uint64_t child_version =
+                child->m_version.load(std::memory_order_acquire);
+            const bool overlaps = child->m_range.overlaps(range);
+            if (!node->validate_version(version) || (child_version & 1) ||
+                !child->validate_version(child_version)) {
+                return nullptr;
+            }
+            if (overlaps) {
+                break;
+            }
+            node = child;
+            version = child_version;
+        }
+    }
+
+    // the node is ours if nobody touched it since it was read. the root
+    // must not have been locked either, since a thread that prepared the
+    // whole tree expects to be alone in it until it releases.
+    node->mutex_lock();
+    const uint64_t expected_root = node == this ? version + 1 : root_version;
+    if (node->m_version.load(std::memory_order_relaxed) != version + 1 ||
+        m_version.load(std::memory_order_acquire) != expected_root) {
+        node->mutex_unlock();
+        return nullptr;
+    }
+    return node;
+}
+
+void treenode::insert(const keyrange &range, TXNID txnid) {
     // choose a child to check. if that child is null, then insert the new
     // node there. otherwise recur down that child's subtree
     keyrange::comparison c = range.compare(m_range);
     if (c == keyrange::comparison::LESS_THAN) {
         treenode *left_child = lock_and_rebalance_left();
         if (left_child == nullptr) {
-            left_child = treenode::alloc(range);
+            left_child = treenode::alloc(range, txnid);
             m_left_child.set(left_child);
         } else {
-            left_child->insert(range);
+            left_child->insert(range, txnid);
             left_child->mutex_unlock();
         }
     } else {
         // invariant(c == keyrange::comparison::GREATER_THAN);
         treenode *right_child = lock_and_rebalance_right();
         if (right_child == nullptr) {
-            right_child = treenode::alloc(range);
+            right_child = treenode::alloc(range, txnid);
             m_right_child.set(right_child);
         } else {
-            right_child->insert(range);
+            right_child->insert(range, txnid);
             right_child->mutex_unlock();
         }
     }
 }
 
-treenode *treenode::find_child_at_extreme(int direction, treenode **parent) {
-    treenode *child =
-        direction > 0 ? m_right_child.get_locked() : m_left_child.get_locked();
-
-    if (child) {
-        *parent = this;
-        treenode *child_extreme =
-            child->find_child_at_extreme(direction, parent);
-        child->mutex_unlock();
-        return child_extreme;
-    } else {
-        return this;
+treenode *treenode::detach_neighbour(bool left) {
+    // step to the given side once, then follow the opposite side down to
+    // its end, keeping the parent of the current node locked
+    treenode *parent = this;
+    child_ptr *link = left ? &m_left_child : &m_right_child;
+    treenode *node = link->get_locked();
+    for (;;) {
+        child_ptr *next_link =
+            left ? &node->m_right_child : &node->m_left_child;
+        if (next_link->ptr == nullptr) {
+            break;
+        }
+        treenode *next = next_link->get_locked();
+        if (parent != this) {
+            parent->mutex_unlock();
+        }
+        parent = node;
+        link = next_link;
+        node = next;
     }
-}
-
-treenode *treenode::find_leftmost_child(treenode **parent) {
-    return find_child_at_extreme(-1, parent);
-}
 
-treenode *treenode::find_rightmost_child(treenode **parent) {
-    return find_child_at_extreme(1, parent);
+    *link = left ? node->m_left_child : node->m_right_child;
+    if (parent != this) {
+        parent->mutex_unlock();
+    }
+    return node;
 }
 
 treenode *treenode::remove_root_of_subtree() {
@@ -154,39 +376,13 @@ treenode *treenode::remove_root_of_subtree() {
         return nullptr;
     }
 
-    // we have a child, so get either the in-order successor or
-    // predecessor of this node to be our replacement.
-    // replacement_parent is updated by the find functions as
-    // they recur down the tree, so initialize it to this.
-    treenode *child, *replacement;
-    treenode *replacement_parent = this;
-    if (m_left_child.ptr != nullptr) {
-        child = m_left_child.get_locked();
-        replacement = child->find_rightmost_child(&replacement_parent);
-        // invariant(replacement == child || replacement_parent != this);
-
-        // detach the replacement from its parent
-        if (replacement_parent == this) {
-            m_left_child = replacement->m_left_child;
-        } else {
-            replacement_parent->m_right_child = replacement->m_left_child;
-        }
-    } else {
-        child = m_right_child.get_locked();
-        replacement = child->find_leftmost_child(&replacement_parent);
-        // invariant(replacement == child || replacement_parent != this);
-
-        // detach the replacement from its parent
-        if (replacement_parent == this) {
-            m_right_child = replacement->m_right_child;
-        } else {
-            replacement_parent->m_left_child = replacement->m_right_child;
-        }
-    }
-    child->mutex_unlock();
+    // we have a child, so get either the in-order predecessor or
+    // successor of this node to be our replacement.
+    treenode *replacement = detach_neighbour(m_left_child.ptr != nullptr);
 
     // swap in place with the detached replacement, then destroy it
     treenode::swap_in_place(replacement, this);
+    replacement->mutex_unlock();
     treenode::free(replacement);
 
     return this;
@@ -345,4 +541,8 @@ void treenode::swap_in_place(treenode *node1, treenode *node2) {
     keyrange tmp_range = node1->m_range;
     node1->m_range = node2->m_range;
     node2->m_range = tmp_range;
+
+    TXNID tmp_txnid = node1->m_txnid;
+    node1->m_txnid = node2->m_txnid;
+    node2->m_txnid = tmp_txnid;
 }
\ No newline at end of file
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <mutex>
 #include <string>
 
 #include "keyrange.h"
 
+// identifies the owner (transaction) of a range held in the tree
+typedef uint64_t TXNID;
+static const TXNID TXNID_NONE = 0;
+
 class treenode {
    public:
     // every treenode function has some common requirements:
@@ -16,7 +21,7 @@ class treenode {
     void destroy_root(void);
 
     // effect: sets the txnid and copies the given range for this node
-    void set_range_and_txnid(const keyrange &range);
+    void set_range_and_txnid(const keyrange &range, TXNID txnid);
 
     // returns: true iff this node is marked as empty
     bool is_empty(void);
@@ -27,10 +32,10 @@ class treenode {
     // returns: true if the given range overlaps with this node's range
     bool range_overlaps(const keyrange &range);
 
-    // effect: locks the node
+    // effect: locks the node and makes its version odd
     void mutex_lock(void);
 
-    // effect: unlocks the node
+    // effect: unlocks the node and moves its version to the next even value
     void mutex_unlock(void);
 
     // return: node whose child overlaps, or a child that is empty
@@ -40,16 +45,47 @@ class treenode {
     treenode *find_node_with_overlapping_child(
         const keyrange &range, const keyrange::comparison *cmp_hint);
 
+    // requires: this is the root, and the caller holds no node locks
+    // effect: descends without taking any locks, reading node versions
+    //         instead, to the node acquire() would settle on, and locks only
+    //         that node. the root is locked instead once the descent is
+    //         deeper than OPTIMISTIC_MAX_DEPTH.
+    // returns: the locked node, or null if a concurrent change was seen
+    //          and the caller should retry
+    treenode *find_and_lock_optimistic(const keyrange &range);
+
+    // effect: performs an in-order traversal of the ranges that overlap the
+    //         given range, calling function->fn() on each range, txnid pair.
+    //         the traversal stops early if fn() returns false.
+    // requires: node is locked. children are locked hand-over-hand.
+    template <class F>
+    void traverse_overlaps(const keyrange &range, F *function);
+
     // effect: inserts the given range and txnid into a subtree, recursively
     // requires: range does not overlap with any node below the subtree
-    void insert(const keyrange &range);
+    void insert(const keyrange &range, TXNID txnid);
 
     // effect: removes the given range from the subtree
     // requires: range exists in the subtree
     // returns: the root of the resulting subtree
     treenode *remove(const keyrange &range);
 
+    // effect: turns the per-thread slab pool behind alloc() on or off. with
+    //         the pool off, nodes are allocated and deleted one by one.
+    // requires: no tree is in use
+    static void set_pooling(bool enabled);
+
+    // returns: true iff alloc() takes nodes from the pool
+    static bool is_pooling(void);
+
+    // returns: the memory one alloc() takes, including its share of the
+    //          slab and of the allocator's own overhead
+    static uint64_t get_alloc_footprint(void);
+
    private:
+    // per-thread slab pool behind alloc and free, see treenode.cc
+    struct pool;
+
     // the child_ptr is a light abstraction for the locking of
     // a child and the maintenence of its depth estimate.
 
@@ -67,11 +103,22 @@ class treenode {
     // the balance factor at which a node is considered imbalanced
     static const int32_t IMBALANCE_THRESHOLD = 2;
 
+    // optimistic descents never rebalance, so a path this long means the
+    // tree needs the rotations done by a locked descent from the root
+    static const uint32_t OPTIMISTIC_MAX_DEPTH = 64;
+
     // node-level mutex
     std::mutex m_mutex;
 
+    // odd while the node is locked, bumped on every lock and unlock.
+    // optimistic readers validate what they read against it.
+    std::atomic<uint64_t> m_version{0};
+
     keyrange m_range;
 
+    // the owner of m_range
+    TXNID m_txnid;
+
     // two child pointers
     child_ptr m_left_child;
     child_ptr m_right_child;
@@ -83,30 +130,27 @@ class treenode {
     // marked for an empty node. only valid for the root.
     bool m_is_empty;
 
+    // marked for a node that came from the pool, not from new
+    bool m_pooled = false;
+
     // effect: initializes an empty node with the given comparator
     void init();
 
-    // requires: *parent is initialized to something meaningful.
-    // requires: subtree is non-empty
-    // returns: the leftmost child of the given subtree
-    // returns: a pointer to the parent of said child in *parent, only
-    //          if this function recurred, otherwise it is untouched.
-    treenode *find_leftmost_child(treenode **parent);
-
-    // requires: *parent is initialized to something meaningful.
-    // requires: subtree is non-empty
-    // returns: the rightmost child of the given subtree
-    // returns: a pointer to the parent of said child in *parent, only
-    //          if this function recurred, otherwise it is untouched.
-    treenode *find_rightmost_child(treenode **parent);
+    // returns: true iff the version is still the given one
+    bool validate_version(uint64_t version) const;
 
     // effect: remove the root of this subtree, destroying the old root
     // returns: the new root of the subtree
     treenode *remove_root_of_subtree(void);
 
-    // requires: subtree is non-empty, direction is not 0
-    // returns: the child of the subtree at either the left or rightmost extreme
-    treenode *find_child_at_extreme(int direction, treenode **parent);
+    // requires: node is locked and has a child on the given side
+    // effect: detaches the in-order neighbour of this node on that side, the
+    //         rightmost node of the left subtree or the leftmost node of the
+    //         right subtree, and links its only child in its place. the path
+    //         is locked hand-over-hand, so that threads which latched a node
+    //         below this one never see it change underneath them.
+    // returns: the detached node, locked
+    treenode *detach_neighbour(bool left);
 
     // effect: retrieves and possibly rebalances the left child
     // returns: a locked left child, if it exists
@@ -133,11 +177,49 @@ class treenode {
     treenode *maybe_rebalance(void);
 
     // returns: allocated treenode populated with a copy of the range and txnid
-    static treenode *alloc(const keyrange &range);
+    static treenode *alloc(const keyrange &range, TXNID txnid);
 
     // requires: node is a locked root node, or an unlocked non-root node
+    // note: pooled nodes are kept for reuse by alloc and never deleted,
+    //       since an optimistic reader may still be looking at them
     static void free(treenode *node);
 
     // effect: swaps the range/txnid pairs for node1 and node2.
     static void swap_in_place(treenode *node1, treenode *node2);
 };
+
+template <class F>
+void treenode::traverse_overlaps(const keyrange &range, F *function) {
+    keyrange::comparison c = range.compare(m_range);
+    if (c == keyrange::comparison::EQUALS) {
+        // the tree is non-overlapping, so nothing else can overlap
+        // a range that is equal to this node's range.
+        function->fn(m_range, m_txnid);
+        return;
+    }
+
+    treenode *left = m_left_child.get_locked();
+    if (left) {
+        if (c != keyrange::comparison::GREATER_THAN) {
+            // the target range is less than or overlaps this node,
+            // so there may be something on the left.
+            left->traverse_overlaps(range, function);
+        }
+        left->mutex_unlock();
+    }
+
+    if (c == keyrange::comparison::OVERLAPS) {
+        bool keep_going = function->fn(m_range, m_txnid);
+        if (!keep_going) {
+            return;
+        }
+    }
+
+    treenode *right = m_right_child.get_locked();
+    if (right) {
+        if (c != keyrange::comparison::LESS_THAN) {
+            right->traverse_overlaps(range, function);
+        }
+        right->mutex_unlock();
+    }
+}
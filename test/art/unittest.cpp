@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../../src/art/range_lock.hpp"
+#include "../key_holders.hpp"
+
+// Test case for the radix tree backend against a reference set of ranges
+TEST(ArtRangeLock, AgainstReference) {
+    ArtRangeLock arl{};
+    std::map<uint64_t, uint64_t> held;
+    std::mt19937_64 rng(7);
+
+    for (int i = 0; i < 200000; i++) {
+        // Keys spread over a few prefixes grow, split and refill nodes
+        uint64_t base = (rng() % 4) << 40 | (rng() % 3) << 20;
+        uint64_t start = base + rng() % 100000;
+        uint64_t end = start + rng() % 300;
+        if (rng() % 3 == 0 && !held.empty()) {
+            auto it = held.lower_bound(start);
+            if (it == held.end()) {
+                it = held.begin();
+            }
+            ASSERT_TRUE(arl.releaseLock(it->first, it->second));
+            held.erase(it);
+        } else {
+            bool expected = !overlapsHeld(held, start, end);
+            ASSERT_EQ(arl.tryLock(start, end), expected);
+            if (expected) {
+                held[start] = end;
+            }
+        }
+    }
+
+    ASSERT_EQ(arl.size(), held.size());
+    ASSERT_LE(arl.depth(held.begin()->first), 8);
+    ASSERT_FALSE(arl.tryLock(0, std::numeric_limits<uint64_t>::max()));
+    ASSERT_EQ(arl.tryLock(0, 0), !overlapsHeld(held, 0, 0));
+}
+
+// Test case for mutual exclusion of the radix tree backend
+TEST(ArtRangeLock, Concurrently) {
+    const int num_threads = 8;
+    const int num_ops = 20000;
+    const uint64_t num_keys = 4000;
+    ArtRangeLock arl{};
+    KeyHolders holders(num_keys + 16);
+
+    // Ranges far apart in the key space keep the upper levels busy
+    for (uint64_t i = 1; i <= 1000; i++) {
+        ASSERT_TRUE(arl.tryLock(i << 32, (i << 32) + 10));
+    }
+
+    auto lockReleaseFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        for (int i = 0; i < num_ops; i++) {
+            uint64_t start = rng() % num_keys;
+            uint64_t end = start + rng() % 16;
+            if (!arl.tryLock(start, end)) {
+                continue;
+            }
+            ASSERT_TRUE(holders.claim(start, end));
+            holders.drop(start, end);
+            ASSERT_TRUE(arl.releaseLock(start, end));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(arl.size(), 1000);
+    ASSERT_TRUE(arl.tryLock(0, (1ULL << 32) - 1));
+    ASSERT_FALSE(arl.tryLock(5ULL << 32, 5ULL << 32));
+}
+
+// Test case for unlinking nodes that released ranges leave empty
+TEST(ArtRangeLock, ReleaseShrinksTree) {
+    ArtRangeLock arl{};
+    std::mt19937_64 rng(13);
+
+    ASSERT_TRUE(arl.tryLock(1000, 2000));
+    ASSERT_TRUE(arl.tryLock(5ULL << 40, (5ULL << 40) + 10));
+    size_t nodes = arl.nodeCount();
+    size_t depth = arl.depth(1000);
+
+    // Every start is new, so nothing is left to reuse the nodes it needed
+    for (int i = 0; i < 100000; i++) {
+        uint64_t start = rng() >> 1;
+        std::vector<uint64_t> starts{start, start + 3, start + 300,
+                                     start + (1 << 20)};
+        for (uint64_t key : starts) {
+            ASSERT_TRUE(arl.tryLock(key, key + 1));
+        }
+        for (uint64_t key : starts) {
+            ASSERT_TRUE(arl.releaseLock(key, key + 1));
+        }
+    }
+
+    ASSERT_EQ(arl.size(), 2);
+    ASSERT_EQ(arl.nodeCount(), nodes);
+    ASSERT_EQ(arl.depth(1000), depth);
+    ASSERT_LT(arl.retiredCount(), 1024);
+    ASSERT_FALSE(arl.tryLock(1500, 1500));
+    ASSERT_TRUE(arl.releaseLock(1000, 2000));
+    ASSERT_TRUE(arl.releaseLock(5ULL << 40, (5ULL << 40) + 10));
+    ASSERT_EQ(arl.nodeCount(), 1);
+}
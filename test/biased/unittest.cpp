@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../../src/biased/range_lock.hpp"
+#include "../key_holders.hpp"
+
+// Predefined maxLevel
+constexpr unsigned maxLevel = 4;
+
+// Test case for granting a region lease and revoking it from another thread
+TEST(BiasedRangeLock, LeaseRevocation) {
+    const uint64_t region = 1000;
+    BiasedRangeLock<maxLevel> brl(region, 4);
+
+    for (uint32_t i = 0; i < BiasedRangeLock<maxLevel>::leaseThreshold; i++) {
+        ASSERT_TRUE(brl.tryLock(10, 20));
+        ASSERT_TRUE(brl.releaseLock(10, 20));
+    }
+    ASSERT_TRUE(brl.isLeased(0));
+    ASSERT_FALSE(brl.isLeased(region));
+
+    ASSERT_TRUE(brl.tryLock(100, 200));
+    ASSERT_TRUE(brl.tryLock(300, 300));
+    ASSERT_FALSE(brl.tryLock(150, 250));
+    ASSERT_EQ(brl.size(), 2);
+    ASSERT_EQ(brl.revocations(), 0);
+
+    std::thread other([&]() {
+        ASSERT_FALSE(brl.tryLock(190, 210));
+        ASSERT_TRUE(brl.tryLock(500, 600));
+    });
+    other.join();
+
+    ASSERT_FALSE(brl.isLeased(0));
+    ASSERT_EQ(brl.revocations(), 1);
+    ASSERT_EQ(brl.size(), 3);
+    ASSERT_FALSE(brl.tryLock(550, 550));
+    ASSERT_TRUE(brl.tryLock(region - 10, region + 10));
+    ASSERT_TRUE(brl.releaseLock(100, 200));
+    ASSERT_TRUE(brl.releaseLock(300, 300));
+    ASSERT_TRUE(brl.releaseLock(500, 600));
+    ASSERT_TRUE(brl.releaseLock(region - 10, region + 10));
+    ASSERT_FALSE(brl.releaseLock(100, 200));
+    ASSERT_EQ(brl.size(), 0);
+}
+
+// Test case for mutual exclusion while leases are granted and revoked
+TEST(BiasedRangeLock, Concurrently) {
+    const int num_threads = 8;
+    const int num_ops = 20000;
+    const uint64_t region = 256;
+    BiasedRangeLock<maxLevel> brl(region, num_threads);
+    KeyHolders holders(num_threads * region + 16);
+
+    // Threads mostly stay in their own region, now and then they lock in a
+    // neighbour's region or across the border to it
+    auto lockReleaseFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        std::vector<std::pair<uint64_t, uint64_t>> mine;
+        for (int i = 0; i <= num_ops; i++) {
+            if (mine.size() == 8 || i == num_ops) {
+                for (auto &range : mine) {
+                    holders.drop(range.first, range.second);
+                    ASSERT_TRUE(brl.releaseLock(range.first, range.second));
+                }
+                mine.clear();
+                continue;
+            }
+            uint64_t home = thread_id;
+            if (rng() % 50 == 0) {
+                home = (home + 1) % num_threads;
+            }
+            uint64_t start = home * region + rng() % region;
+            uint64_t end = start + rng() % 16;
+            if (!brl.tryLock(start, end)) {
+                continue;
+            }
+            ASSERT_TRUE(holders.claim(start, end));
+            mine.emplace_back(start, end);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(brl.size(), 0);
+    ASSERT_TRUE(brl.tryLock(0, num_threads * region + 15));
+}
+
+// Test case for ranges at the top of the key space, past the regions
+TEST(BiasedRangeLock, TopKeys) {
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    BiasedRangeLock<maxLevel> brl(1000, 4);
+
+    ASSERT_FALSE(brl.tryLock(10, max));
+    ASSERT_FALSE(brl.tryLock(10, max - 1));
+    ASSERT_EQ(brl.size(), 0);
+    ASSERT_TRUE(brl.tryLock(20, 30));
+
+    ASSERT_TRUE(brl.tryLock(100000, max - 2));
+    ASSERT_FALSE(brl.tryLock(max - 2, max - 2));
+    ASSERT_FALSE(brl.releaseLock(100000, max));
+    ASSERT_TRUE(brl.releaseLock(100000, max - 2));
+    ASSERT_TRUE(brl.releaseLock(20, 30));
+    ASSERT_EQ(brl.size(), 0);
+}
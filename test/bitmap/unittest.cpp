@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../../src/bitmap/range_lock.hpp"
+#include "../key_holders.hpp"
+
+// Test case for the bitmap backend on ranges within and across words
+TEST(BitmapRangeLock, Ranges) {
+    BitmapRangeLock<uint16_t> brl{};
+
+    ASSERT_TRUE(brl.tryLock(0, 0));
+    ASSERT_TRUE(brl.tryLock(60, 70));
+    ASSERT_TRUE(brl.tryLock(128, 1000));
+    ASSERT_TRUE(brl.tryLock(65535, 65535));
+    ASSERT_EQ(brl.size(), 4);
+
+    // A conflict in a later word backs out the words already set
+    ASSERT_FALSE(brl.tryLock(1, 130));
+    ASSERT_FALSE(brl.anyOverlap(1, 59));
+    ASSERT_FALSE(brl.anyOverlap(71, 127));
+    ASSERT_FALSE(brl.tryLock(2000, 100));
+    ASSERT_TRUE(brl.tryLock(71, 127));
+
+    ASSERT_TRUE(brl.isLocked(1000));
+    ASSERT_FALSE(brl.isLocked(1001));
+    ASSERT_TRUE(brl.releaseLock(128, 1000));
+    ASSERT_FALSE(brl.releaseLock(128, 1000));
+    ASSERT_FALSE(brl.anyOverlap(128, 65534));
+    ASSERT_EQ(brl.size(), 4);
+}
+
+// Test case for mutual exclusion of the bitmap backend
+TEST(BitmapRangeLock, Concurrently) {
+    const int num_threads = 8;
+    const int num_ops = 20000;
+    BitmapRangeLock<uint16_t> brl{};
+    KeyHolders holders(1 << 16);
+
+    auto lockReleaseFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        for (int i = 0; i < num_ops; i++) {
+            uint16_t start = rng() % 2000;
+            uint16_t end = start + rng() % 200;
+            if (!brl.tryLock(start, end)) {
+                continue;
+            }
+            ASSERT_TRUE(holders.claim(start, end));
+            holders.drop(start, end);
+            ASSERT_TRUE(brl.releaseLock(start, end));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(brl.size(), 0);
+    ASSERT_FALSE(brl.anyOverlap(0, 65535));
+}
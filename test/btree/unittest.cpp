@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../../src/btree/range_lock.hpp"
+#include "../key_holders.hpp"
+
+// Test case for the B+-tree backend against a reference set of ranges
+TEST(BTreeRangeLock, AgainstReference) {
+    BTreeRangeLock<16> btl{};
+    std::map<uint64_t, uint64_t> held;
+    std::mt19937_64 rng(11);
+
+    // Fill up to split into several levels, then drain to merge back
+    for (int phase = 0; phase < 2; phase++) {
+        for (int i = 0; i < 100000; i++) {
+            bool release = rng() % 4 < (phase == 0 ? 1u : 3u);
+            if (release && !held.empty()) {
+                auto it = held.lower_bound(rng() % 1000000);
+                if (it == held.end()) {
+                    it = held.begin();
+                }
+                ASSERT_TRUE(btl.releaseLock(it->first, it->second));
+                held.erase(it);
+            } else {
+                uint64_t start = rng() % 1000000;
+                uint64_t end = start + rng() % 500;
+                bool expected = !overlapsHeld(held, start, end);
+                ASSERT_EQ(btl.tryLock(start, end), expected);
+                if (expected) {
+                    held[start] = end;
+                }
+            }
+        }
+        ASSERT_EQ(btl.size(), held.size());
+        if (phase == 0) {
+            ASSERT_GE(btl.height(), 3);
+        }
+    }
+
+    for (auto &range : held) {
+        ASSERT_TRUE(btl.releaseLock(range.first, range.second));
+    }
+    ASSERT_EQ(btl.size(), 0);
+    ASSERT_EQ(btl.height(), 1);
+    ASSERT_TRUE(btl.tryLock(0, std::numeric_limits<uint64_t>::max()));
+}
+
+// Test case for mutual exclusion of the B+-tree backend
+TEST(BTreeRangeLock, Concurrently) {
+    const int num_threads = 8;
+    const int num_ops = 20000;
+    const uint64_t num_keys = 4000;
+    BTreeRangeLock<16> btl{};
+    KeyHolders holders(num_keys + 16);
+
+    // Long-lived ranges interleaved with the working set keep the tree deep
+    for (uint64_t i = 0; i < 2000; i++) {
+        ASSERT_TRUE(btl.tryLock(num_keys + 16 + i * 4, num_keys + 17 + i * 4));
+    }
+
+    // Every thread holds up to 32 ranges at a time, so that leaves split
+    // and merge while others search them
+    auto lockReleaseFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        std::vector<std::pair<uint64_t, uint64_t>> mine;
+        for (int i = 0; i <= num_ops; i++) {
+            if (mine.size() == 32 || i == num_ops) {
+                for (auto &range : mine) {
+                    holders.drop(range.first, range.second);
+                    ASSERT_TRUE(btl.releaseLock(range.first, range.second));
+                }
+                mine.clear();
+                continue;
+            }
+            uint64_t start = rng() % num_keys;
+            uint64_t end = start + rng() % 16;
+            if (!btl.tryLock(start, end)) {
+                continue;
+            }
+            ASSERT_TRUE(holders.claim(start, end));
+            mine.emplace_back(start, end);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(btl.size(), 2000);
+    ASSERT_TRUE(btl.tryLock(0, num_keys + 15));
+    ASSERT_FALSE(btl.tryLock(num_keys + 17, num_keys + 17));
+}
+
+// Test case for freeing the nodes that merges take out of the tree
+TEST(BTreeRangeLock, ChurnFreesMergedNodes) {
+    const uint64_t num_ranges = 50000;
+    BTreeRangeLock<16> btl{};
+
+    // Every cycle splits the tree up to several levels and merges it back
+    for (int cycle = 0; cycle < 20; cycle++) {
+        for (uint64_t i = 0; i < num_ranges; i++) {
+            ASSERT_TRUE(btl.tryLock(i * 4, i * 4 + 1));
+        }
+        ASSERT_GT(btl.height(), 2);
+        for (uint64_t i = 0; i < num_ranges; i++) {
+            ASSERT_TRUE(btl.releaseLock(i * 4, i * 4 + 1));
+        }
+        ASSERT_EQ(btl.size(), 0);
+        ASSERT_LT(btl.retiredCount(), 1024);
+    }
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../../src/hybrid/range_lock.hpp"
+#include "../key_holders.hpp"
+
+// Predefined maxLevel
+constexpr unsigned maxLevel = 4;
+
+// Test case for aligned and unaligned ranges of the hybrid lock
+TEST(HybridRangeLock, Paths) {
+    const uint64_t page = HybridRangeLock<maxLevel>::pageSize;
+    HybridRangeLock<maxLevel> hrl(16);
+
+    ASSERT_TRUE(hrl.isFastPath(0, page - 1));
+    ASSERT_FALSE(hrl.isFastPath(0, page));
+    ASSERT_FALSE(hrl.isFastPath(0, 16 * page));
+
+    // Aligned pages exclude unaligned ranges on them and the other way round
+    ASSERT_TRUE(hrl.tryLock(0, 2 * page - 1));
+    ASSERT_FALSE(hrl.tryLock(page + 10, page + 20));
+    ASSERT_TRUE(hrl.tryLock(2 * page + 10, 2 * page + 20));
+    ASSERT_FALSE(hrl.tryLock(2 * page, 3 * page - 1));
+    ASSERT_TRUE(hrl.tryLock(2 * page + 30, 2 * page + 40));
+    ASSERT_TRUE(hrl.tryLock(3 * page, 4 * page - 1));
+    ASSERT_EQ(hrl.skipList().size(), 2);
+    ASSERT_EQ(hrl.size(), 4);
+
+    // A failed multi-page claim leaves no page behind
+    ASSERT_FALSE(hrl.tryLock(4 * page - page, 6 * page - 1));
+    ASSERT_TRUE(hrl.tryLock(4 * page, 5 * page - 1));
+
+    ASSERT_TRUE(hrl.releaseLock(2 * page + 10, 2 * page + 20));
+    ASSERT_FALSE(hrl.tryLock(2 * page, 3 * page - 1));
+    ASSERT_TRUE(hrl.releaseLock(2 * page + 30, 2 * page + 40));
+    ASSERT_TRUE(hrl.tryLock(2 * page, 3 * page - 1));
+
+    // Large ranges and keys past the page array go to the skip list
+    ASSERT_TRUE(hrl.releaseLock(0, 2 * page - 1));
+    ASSERT_FALSE(hrl.tryLock(0, 20 * page - 1));
+    ASSERT_TRUE(hrl.tryLock(8 * page, 20 * page - 1));
+    ASSERT_FALSE(hrl.tryLock(10 * page, 11 * page - 1));
+    ASSERT_FALSE(hrl.tryLock(19 * page, 19 * page));
+    ASSERT_EQ(hrl.skipList().size(), 1);
+}
+
+// Test case for mutual exclusion across the two paths of the hybrid lock
+TEST(HybridRangeLock, Concurrently) {
+    const int num_threads = 8;
+    const int num_ops = 20000;
+    const uint64_t page = HybridRangeLock<maxLevel>::pageSize;
+    const uint64_t num_pages = 8;
+    HybridRangeLock<maxLevel> hrl(num_pages);
+    KeyHolders holders(num_pages * page);
+
+    auto lockReleaseFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        for (int i = 0; i < num_ops; i++) {
+            uint64_t start, end;
+            if (rng() % 4 != 0) {
+                start = rng() % num_pages * page;
+                end = std::min(start + (1 + rng() % 2) * page,
+                               num_pages * page) - 1;
+            } else {
+                start = rng() % (num_pages * page - 64);
+                end = start + rng() % 64;
+            }
+            if (!hrl.tryLock(start, end)) {
+                continue;
+            }
+            // Only the ends are counted, whole pages would take too long
+            ASSERT_TRUE(holders.claim(start, start));
+            ASSERT_TRUE(start == end || holders.claim(end, end));
+            holders.drop(start, start);
+            if (start != end) {
+                holders.drop(end, end);
+            }
+            ASSERT_TRUE(hrl.releaseLock(start, end));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(hrl.size(), 0);
+    ASSERT_TRUE(hrl.tryLock(0, num_pages * page - 1));
+}
+
+// Test case for releasing a part of an aligned range, or more than it
+TEST(HybridRangeLock, MismatchedRelease) {
+    const uint64_t page = HybridRangeLock<maxLevel>::pageSize;
+    HybridRangeLock<maxLevel> hrl(16);
+
+    ASSERT_TRUE(hrl.tryLock(0, 2 * page - 1));
+    ASSERT_TRUE(hrl.tryLock(2 * page, 3 * page - 1));
+    ASSERT_FALSE(hrl.releaseLock(0, page - 1));
+    ASSERT_FALSE(hrl.releaseLock(page, 2 * page - 1));
+    ASSERT_FALSE(hrl.releaseLock(0, 3 * page - 1));
+    ASSERT_FALSE(hrl.releaseLock(4 * page, 5 * page - 1));
+    ASSERT_EQ(hrl.size(), 2);
+    ASSERT_FALSE(hrl.tryLock(0, page - 1));
+
+    ASSERT_TRUE(hrl.releaseLock(0, 2 * page - 1));
+    ASSERT_FALSE(hrl.releaseLock(0, 2 * page - 1));
+    ASSERT_TRUE(hrl.tryLock(0, page - 1));
+    ASSERT_TRUE(hrl.tryLock(page, 2 * page - 1));
+    ASSERT_FALSE(hrl.releaseLock(0, 2 * page - 1));
+    ASSERT_EQ(hrl.size(), 3);
+}
+
+// Test case for ranges at the top of the key space, past the page words
+TEST(HybridRangeLock, TopKeys) {
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    HybridRangeLock<maxLevel> hrl(16);
+
+    ASSERT_FALSE(hrl.tryLock(10, max));
+    ASSERT_FALSE(hrl.tryLock(10, max - 1));
+    ASSERT_EQ(hrl.size(), 0);
+    ASSERT_TRUE(hrl.tryLock(20, 30));
+
+    ASSERT_TRUE(hrl.tryLock(100000, max - 2));
+    ASSERT_FALSE(hrl.tryLock(max - 2, max - 2));
+    ASSERT_FALSE(hrl.releaseLock(100000, max));
+    ASSERT_TRUE(hrl.releaseLock(100000, max - 2));
+    ASSERT_TRUE(hrl.releaseLock(20, 30));
+    ASSERT_EQ(hrl.size(), 0);
+}
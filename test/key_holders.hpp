@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <vector>
+
+// Counts the holders of every key in [0, keys), so that a test can check
+// that a range lock never hands a key to two threads at once
+class KeyHolders {
+public:
+    explicit KeyHolders(uint64_t keys) : counts(keys) {}
+
+    // Marks every key of [start, end] held and returns false if one of them
+    // already was
+    bool claim(uint64_t start, uint64_t end) {
+        bool exclusive = true;
+        for (uint64_t key = start; key <= end; key++) {
+            exclusive &= counts[key].fetch_add(1) == 0;
+        }
+        return exclusive;
+    }
+
+    void drop(uint64_t start, uint64_t end) {
+        for (uint64_t key = start; key <= end; key++) {
+            counts[key].fetch_sub(1);
+        }
+    }
+
+private:
+    std::vector<std::atomic<int>> counts;
+};
+
+// Whether [start, end] overlaps a range of held, a map of disjoint closed
+// ranges by start, for tests that check a range lock against a reference
+inline bool overlapsHeld(const std::map<uint64_t, uint64_t> &held,
+                         uint64_t start, uint64_t end) {
+    auto next = held.lower_bound(start);
+    if (next != held.end() && next->first <= end) {
+        return true;
+    }
+    return next != held.begin() && std::prev(next)->second >= start;
+}
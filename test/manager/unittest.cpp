@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../../src/manager/range_lock.hpp"
+#include "../key_holders.hpp"
+
+// Predefined maxLevel
+constexpr unsigned maxLevel = 4;
+
+// Test case for lazily created per-object locks and their reclamation
+TEST(RangeLockManager, Reclaim) {
+    RangeLockManager<maxLevel> manager(64);
+
+    ASSERT_FALSE(manager.releaseLock(1, 0, 10));
+    ASSERT_EQ(manager.objectCount(), 0);
+    for (uint64_t object = 0; object < 100; object++) {
+        ASSERT_TRUE(manager.tryLock(object, 0, 10));
+        ASSERT_FALSE(manager.tryLock(object, 5, 15));
+    }
+    ASSERT_EQ(manager.objectCount(), 100);
+
+    for (uint64_t object = 0; object < 100; object += 2) {
+        ASSERT_TRUE(manager.releaseLock(object, 0, 10));
+    }
+    // The first sweep only clears the referenced marks
+    ASSERT_EQ(manager.reclaimIdle(), 0);
+    ASSERT_TRUE(manager.tryLock(98, 20, 30));
+    ASSERT_EQ(manager.reclaimIdle(), 49);
+    ASSERT_EQ(manager.objectCount(), 51);
+    ASSERT_FALSE(manager.releaseLock(0, 0, 10));
+
+    // Objects coming back reuse the reclaimed entries of their buckets
+    for (uint64_t object = 0; object < 98; object += 2) {
+        ASSERT_TRUE(manager.tryLock(object, 0, 0));
+    }
+    ASSERT_EQ(manager.objectCount(), 100);
+    ASSERT_EQ(manager.allocatedCount(), 100);
+    for (uint64_t object = 1; object < 100; object += 2) {
+        ASSERT_FALSE(manager.tryLock(object, 10, 10));
+        ASSERT_TRUE(manager.releaseLock(object, 0, 10));
+    }
+    ASSERT_TRUE(manager.tryLock(98, 0, 19));
+}
+
+// Test case for mutual exclusion per object while entries are reclaimed
+TEST(RangeLockManager, Concurrently) {
+    const int num_threads = 8;
+    const int num_ops = 20000;
+    const uint64_t num_objects = 32;
+    const uint64_t num_keys = 64;
+    RangeLockManager<maxLevel> manager(16);
+    KeyHolders holders(num_objects * (num_keys + 8));
+    std::atomic<bool> done{false};
+
+    auto lockReleaseFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        for (int i = 0; i < num_ops; i++) {
+            uint64_t object = rng() % num_objects;
+            uint64_t start = rng() % num_keys;
+            uint64_t end = start + rng() % 8;
+            if (!manager.tryLock(object, start, end)) {
+                continue;
+            }
+            uint64_t offset = object * (num_keys + 8);
+            ASSERT_TRUE(holders.claim(offset + start, offset + end));
+            holders.drop(offset + start, offset + end);
+            ASSERT_TRUE(manager.releaseLock(object, start, end));
+        }
+    };
+
+    std::thread sweeper([&]() {
+        while (!done.load()) {
+            manager.reclaimIdle();
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    done.store(true);
+    sweeper.join();
+
+    manager.reclaimIdle();
+    manager.reclaimIdle();
+    ASSERT_EQ(manager.objectCount(), 0);
+    ASSERT_LE(manager.allocatedCount(), num_objects);
+}
+
+// Test case for ranges at the top of the key space
+TEST(RangeLockManager, TopKeys) {
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    RangeLockManager<maxLevel> manager(64);
+
+    ASSERT_FALSE(manager.tryLock(1, 10, max));
+    ASSERT_FALSE(manager.tryLock(1, 10, max - 1));
+    ASSERT_TRUE(manager.tryLock(1, 20, 30));
+
+    ASSERT_TRUE(manager.tryLock(1, 100, max - 2));
+    ASSERT_FALSE(manager.tryLock(1, max - 2, max - 2));
+    ASSERT_TRUE(manager.tryLock(2, max - 2, max - 2));
+    ASSERT_FALSE(manager.releaseLock(1, 100, max));
+    ASSERT_TRUE(manager.releaseLock(1, 100, max - 2));
+    ASSERT_TRUE(manager.releaseLock(1, 20, 30));
+    ASSERT_TRUE(manager.releaseLock(2, max - 2, max - 2));
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../../src/sharded/range_lock.hpp"
+#include "../../src/v0/range_lock.hpp"
+#include "../../src/v1/range_lock.hpp"
+#include "../../src/v2/range_lock.cpp"
+#include "../../src/v3/range_lock.hpp"
+#include "../key_holders.hpp"
+
+// Predefined maxLevel
+constexpr unsigned maxLevel = 4;
+
+using V0 = ShiftedBackend<ConcurrentRangeLock<uint64_t, maxLevel>>;
+using V1 = HalfOpenBackend<ConcurrentRangeLock_V1<uint64_t, maxLevel>>;
+using V2 = HalfOpenBackend<ListRLLock>;
+
+// Locks ranges from key 0 to the top key across stripe boundaries of a
+// front-end over Backend
+template <typename Backend>
+void expectClosedRanges() {
+    const uint64_t top = std::numeric_limits<uint64_t>::max() - 2;
+    ShardedRangeLock<Backend> srl(4, 1000, false);
+
+    ASSERT_TRUE(srl.tryLock(0, 5));
+    ASSERT_FALSE(srl.tryLock(0, 0));
+    ASSERT_FALSE(srl.tryLock(5, 7));
+    ASSERT_TRUE(srl.tryLock(6, 260));
+    ASSERT_FALSE(srl.tryLock(260, 270));
+    ASSERT_TRUE(srl.tryLock(999, top));
+    ASSERT_FALSE(srl.tryLock(top, top));
+
+    srl.releaseLock(0, 5);
+    srl.releaseLock(6, 260);
+    srl.releaseLock(999, top);
+    for (size_t i = 0; i < srl.stripes(); ++i) {
+        ASSERT_EQ(srl.stripe(i).size(), 0);
+    }
+    ASSERT_TRUE(srl.tryLock(0, 999));
+}
+
+// Test case for ranges crossing stripe boundaries of the sharded front-end
+TEST(ShardedRangeLock, CrossingRanges) {
+    ShardedRangeLock<V0> srl(4, 1000, false);
+    ASSERT_EQ(srl.boundary(1), 250);
+
+    ASSERT_TRUE(srl.tryLock(240, 510));
+    ASSERT_EQ(srl.stripe(0).size(), 1);
+    ASSERT_EQ(srl.stripe(1).size(), 1);
+    ASSERT_EQ(srl.stripe(2).size(), 1);
+    ASSERT_EQ(srl.stripe(3).size(), 0);
+
+    // A conflict in a later stripe leaves nothing locked in earlier ones
+    ASSERT_FALSE(srl.tryLock(100, 505));
+    ASSERT_EQ(srl.stripe(0).size(), 1);
+    ASSERT_TRUE(srl.tryLock(100, 239));
+
+    srl.releaseLock(240, 510);
+    ASSERT_TRUE(srl.tryLock(250, 250));
+    ASSERT_EQ(srl.stripe(0).size(), 1);
+    ASSERT_EQ(srl.stripe(1).size(), 1);
+    ASSERT_EQ(srl.stripe(2).size(), 0);
+}
+
+// Test case for a backend that releases by start, with single-key pieces at
+// the stripe edges
+TEST(ShardedRangeLock, ReleaseByStart) {
+    ShardedRangeLock<SongRangeLock<>> srl(4, 1000, false);
+
+    ASSERT_TRUE(srl.tryLock(249, 500));
+    ASSERT_FALSE(srl.tryLock(500, 510));
+    ASSERT_FALSE(srl.tryLock(240, 249));
+    ASSERT_EQ(srl.stripe(0).size(), 1);
+    ASSERT_EQ(srl.stripe(2).size(), 1);
+
+    srl.releaseLock(249, 500);
+    for (size_t i = 0; i < srl.stripes(); ++i) {
+        ASSERT_EQ(srl.stripe(i).size(), 0);
+    }
+    ASSERT_TRUE(srl.tryLock(0, 999));
+}
+
+// Test case for online rebalancing under a skewed load
+TEST(ShardedRangeLock, Rebalance) {
+    const int num_threads = 8;
+    const int num_ops = 20000;
+    const uint64_t key_space = 100000;
+    const uint64_t hot_keys = 1000;
+    ShardedRangeLock<V0> srl(8, key_space);
+    KeyHolders holders(hot_keys + 8);
+
+    auto lockReleaseFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        for (int i = 0; i < num_ops; i++) {
+            uint64_t start = rng() % hot_keys;
+            uint64_t end = start + rng() % 8;
+            if (!srl.tryLock(start, end)) {
+                continue;
+            }
+            ASSERT_TRUE(holders.claim(start, end));
+            holders.drop(start, end);
+            srl.releaseLock(start, end);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // Every boundary has moved into the hot keys
+    srl.rebalance();
+    for (size_t i = 1; i < srl.stripes(); ++i) {
+        ASSERT_LT(srl.boundary(i), 2 * hot_keys);
+    }
+    for (size_t i = 0; i < srl.stripes(); ++i) {
+        ASSERT_EQ(srl.stripe(i).size(), 0);
+    }
+}
+
+// Test case for the closed ranges of every backend, through its adapter
+TEST(ShardedRangeLock, Backends) {
+    expectClosedRanges<V0>();
+    expectClosedRanges<V1>();
+    expectClosedRanges<V2>();
+    expectClosedRanges<SongRangeLock<>>();
+
+    // The adapters add one to end, which leaves out the two largest keys
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    ASSERT_FALSE(V0().tryLock(10, max - 1));
+    ASSERT_FALSE(V1().tryLock(10, max - 1));
+    ASSERT_FALSE(V2().tryLock(max, max));
+}
+
+// Test case for fewer keys than stripes, and no stripes at all
+TEST(ShardedRangeLock, SmallKeySpace) {
+    ShardedRangeLock<V0> srl(8, 3, false);
+    for (size_t i = 1; i < srl.stripes(); ++i) {
+        ASSERT_EQ(srl.boundary(i), i);
+    }
+    for (uint64_t i = 0; i < 64 * srl.SAMPLE_RATE; ++i) {
+        ASSERT_TRUE(srl.tryLock(i % 8, i % 8));
+        srl.releaseLock(i % 8, i % 8);
+    }
+
+    // Every stripe keeps at least one key
+    srl.rebalance();
+    ASSERT_GE(srl.boundary(1), 1);
+    for (size_t i = 2; i < srl.stripes(); ++i) {
+        ASSERT_LT(srl.boundary(i - 1), srl.boundary(i));
+    }
+
+    ShardedRangeLock<V0> single(0, 1000);
+    ASSERT_EQ(single.stripes(), 1);
+    ASSERT_TRUE(single.tryLock(0, 999));
+    ASSERT_FALSE(single.tryLock(500, 500));
+}
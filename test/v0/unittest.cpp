@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <random>
 #include <set>
 #include <thread>
@@ -178,4 +179,119 @@ TEST(ConcurrentRangeLock, CorrectOrderOfInsertion) {
         pred = curr;
         curr = pred->next[0]->getReference();
     }
-}
\ No newline at end of file
+}
+// Test case for iterating the held ranges within a window
+TEST(ConcurrentRangeLock, SnapshotWindow) {
+    ConcurrentRangeLock<int, maxLevel> crl{};
+
+    for (int i = 0; i < 1000; i += 10) {
+        crl.tryLock(i, i + 5);
+    }
+    for (int i = 0; i < 1000; i += 20) {
+        crl.releaseLock(i, i + 5);
+    }
+
+    std::vector<std::pair<int, int>> seen;
+    for (auto it = crl.snapshot(103, 252); it.valid(); it.next()) {
+        seen.emplace_back(it.getStart(), it.getEnd());
+    }
+
+    std::vector<std::pair<int, int>> expected;
+    for (int i = 110; i <= 250; i += 20) {
+        expected.emplace_back(i, i + 5);
+    }
+    ASSERT_EQ(seen, expected);
+
+    ASSERT_FALSE(crl.snapshot(1000, 2000).valid());
+}
+
+// Test case for iterating while other threads lock and release
+TEST(ConcurrentRangeLock, SnapshotConcurrently) {
+    const int num_threads = 8;
+    const int num_operations_per_thread = 1000;
+    ConcurrentRangeLock<int, maxLevel> crl{};
+    std::atomic<bool> done{false};
+
+    auto mixedOpFunc = [&](int thread_id) {
+        for (int i = 0; i < num_operations_per_thread; i += 2) {
+            int value = thread_id * num_operations_per_thread + i;
+
+            crl.tryLock(value, value);
+            crl.releaseLock(value, value);
+            crl.tryLock(value, value);
+        }
+    };
+
+    auto scanFunc = [&]() {
+        while (!done.load()) {
+            int last = -1;
+            for (auto it = crl.snapshot(1000, 5000); it.valid(); it.next()) {
+                ASSERT_GT(it.getStart(), last);
+                ASSERT_GE(it.getEnd(), 1000);
+                ASSERT_LE(it.getStart(), 5000);
+                last = it.getEnd();
+            }
+        }
+    };
+
+    std::thread scanner(scanFunc);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(mixedOpFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    done.store(true);
+    scanner.join();
+
+    int count = 0;
+    for (auto it = crl.snapshot(1000, 4999); it.valid(); it.next()) {
+        count++;
+    }
+    ASSERT_EQ(count, 2000);
+}
+
+// Test case for overlap queries
+TEST(ConcurrentRangeLock, OverlapQueries) {
+    ConcurrentRangeLock<int, maxLevel> crl{};
+
+    crl.tryLock(10, 20);
+    crl.tryLock(30, 40);
+    crl.tryLock(50, 60);
+    crl.releaseLock(30, 40);
+
+    ASSERT_TRUE(crl.isLocked(10));
+    ASSERT_TRUE(crl.isLocked(20));
+    ASSERT_FALSE(crl.isLocked(21));
+    ASSERT_FALSE(crl.isLocked(35));
+    ASSERT_TRUE(crl.anyOverlap(0, 10));
+    ASSERT_TRUE(crl.anyOverlap(25, 55));
+    ASSERT_FALSE(crl.anyOverlap(21, 49));
+    ASSERT_FALSE(crl.anyOverlap(61, 100));
+    ASSERT_EQ(crl.size(), 2);
+}
+
+// Test case for releasing single-key ranges, including one that touches the
+// end of its predecessor
+TEST(ConcurrentRangeLock, SingleKeyRanges) {
+    ConcurrentRangeLock<int, maxLevel> crl{};
+
+    ASSERT_TRUE(crl.tryLock(5, 5));
+    ASSERT_TRUE(crl.tryLock(6, 10));
+    ASSERT_TRUE(crl.tryLock(11, 11));
+    ASSERT_FALSE(crl.tryLock(5, 5));
+    ASSERT_FALSE(crl.tryLock(10, 11));
+
+    ASSERT_TRUE(crl.releaseLock(5, 5));
+    ASSERT_TRUE(crl.releaseLock(11, 11));
+    ASSERT_EQ(crl.size(), 1);
+    ASSERT_TRUE(crl.isLocked(10));
+    ASSERT_TRUE(crl.tryLock(5, 5));
+    ASSERT_TRUE(crl.tryLock(11, 11));
+    ASSERT_TRUE(crl.releaseLock(6, 10));
+    ASSERT_TRUE(crl.releaseLock(5, 5));
+    ASSERT_TRUE(crl.releaseLock(11, 11));
+    ASSERT_EQ(crl.size(), 0);
+}
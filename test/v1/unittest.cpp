@@ -1,19 +1,85 @@
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+#include <new>
+#include <random>
 #include <set>
 #include <thread>
 #include <vector>
 
+#include "../../src/v1/optimistic_range_lock.hpp"
 #include "../../src/v1/range_lock.hpp"
 
 // Predefined maxLevel
 constexpr unsigned maxLevel = 4;
 
+// Global operator new is hooked to count the allocations of each thread
+thread_local size_t allocationCount = 0;
+
+void* countedAlloc(std::size_t size, std::size_t alignment) {
+    allocationCount++;
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, std::max(alignment, sizeof(void*)),
+                       size ? size : 1) != 0) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(std::size_t size) {
+    return countedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new[](std::size_t size) {
+    return countedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    free(ptr);
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    free(ptr);
+}
+
+// Acquire allocates the node and nothing else, every other path nothing
+template <typename RangeLock>
+void expectHotPathAllocations() {
+    RangeLock crl{};
+
+    for (int i = 0; i < 1000; i += 10) {
+        size_t before = allocationCount;
+        ASSERT_TRUE(crl.tryLock(i, i + 5));
+        ASSERT_EQ(allocationCount - before, 1);
+
+        before = allocationCount;
+        ASSERT_FALSE(crl.tryLock(i + 2, i + 3));
+        ASSERT_TRUE(crl.searchLock(i, i + 5));
+        ASSERT_TRUE(crl.anyOverlap(i, i));
+        ASSERT_EQ(allocationCount - before, 0);
+    }
+
+    for (int i = 0; i < 1000; i += 10) {
+        size_t before = allocationCount;
+        ASSERT_TRUE(crl.releaseLock(i, i + 5));
+        ASSERT_EQ(allocationCount - before, 0);
+    }
+}
+
 // Test case for concurrent insertions
 TEST(ConcurrentRangeLock, ConcurrentInsertions) {
     int num_threads = 10;
     int num_elements_per_thread = 100;
-    ConcurrentRangeLock<int, maxLevel> crl{};
+    ConcurrentRangeLock_V1<int, maxLevel> crl{};
 
     auto tryLockFunc = [&](int thread_id) {
         for (int i = 0; i < num_elements_per_thread; i += 2) {
@@ -38,7 +104,7 @@ TEST(ConcurrentRangeLock, ConcurrentInsertions) {
 // Test case for concurrent deletions
 TEST(ConcurrentRangeLock, ConcurrentDeletions) {
     int num_elements = 1000;
-    ConcurrentRangeLock<int, maxLevel> crl{};
+    ConcurrentRangeLock_V1<int, maxLevel> crl{};
 
     for (int i = 0; i < num_elements; i += 2) {
         crl.tryLock(i, i + 1);
@@ -66,7 +132,7 @@ TEST(ConcurrentRangeLock, ConcurrentDeletions) {
 // Test case for concurrent searches
 TEST(ConcurrentRangeLock, ConcurrentSearches) {
     int num_elements = 100;
-    ConcurrentRangeLock<int, maxLevel> crl{};
+    ConcurrentRangeLock_V1<int, maxLevel> crl{};
 
     for (int i = 0; i < num_elements; i += 2) {
         crl.tryLock(i, i + 1);
@@ -87,11 +153,208 @@ TEST(ConcurrentRangeLock, ConcurrentSearches) {
     }
 }
 
+// Test case for overlap queries
+TEST(ConcurrentRangeLock, OverlapQueries) {
+    ConcurrentRangeLock_V1<int, maxLevel> crl{};
+
+    crl.tryLock(10, 20);
+    crl.tryLock(30, 40);
+    crl.tryLock(50, 60);
+    crl.releaseLock(30, 40);
+
+    ASSERT_TRUE(crl.isLocked(10));
+    ASSERT_TRUE(crl.isLocked(19));
+    ASSERT_FALSE(crl.isLocked(20));
+    ASSERT_FALSE(crl.isLocked(35));
+    ASSERT_TRUE(crl.anyOverlap(0, 10));
+    ASSERT_TRUE(crl.anyOverlap(25, 55));
+    ASSERT_FALSE(crl.anyOverlap(20, 49));
+    ASSERT_FALSE(crl.anyOverlap(60, 100));
+    ASSERT_EQ(crl.size(), 2);
+}
+
+// Concurrent insertions followed by concurrent deletions for a lock policy
+template <typename Lock>
+void insertAndDeleteConcurrently() {
+    const int num_threads = 8;
+    const int num_elements_per_thread = 1000;
+    ConcurrentRangeLock_V1<int, maxLevel, Lock> crl{};
+
+    auto opFunc = [&](int thread_id) {
+        for (int i = 0; i < num_elements_per_thread; i += 2) {
+            int value = thread_id * num_elements_per_thread + i;
+            ASSERT_TRUE(crl.tryLock(value, value + 1));
+        }
+        for (int i = 0; i < num_elements_per_thread; i += 2) {
+            int value = thread_id * num_elements_per_thread + i;
+            ASSERT_TRUE(crl.releaseLock(value, value + 1));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(opFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(crl.size(), 0);
+}
+
+// Test case for the node lock policies
+TEST(ConcurrentRangeLock, LockPolicies) {
+    insertAndDeleteConcurrently<MutexLock>();
+    insertAndDeleteConcurrently<SpinLock>();
+    insertAndDeleteConcurrently<OptimisticMutex>();
+
+    ASSERT_LT(sizeof(Node_V1<int, SpinLock>), sizeof(Node_V1<int, MutexLock>));
+}
+
+// Test case for the optimistic variant with disjoint ranges
+TEST(OptimisticRangeLock, ConcurrentInsertionsAndDeletions) {
+    const int num_threads = 8;
+    const int num_elements_per_thread = 1000;
+    OptimisticRangeLock_V1<int, maxLevel> crl{};
+
+    auto opFunc = [&](int thread_id) {
+        for (int i = 0; i < num_elements_per_thread; i += 2) {
+            int value = thread_id * num_elements_per_thread + i;
+            ASSERT_TRUE(crl.tryLock(value, value + 1));
+        }
+        for (int i = 0; i < num_elements_per_thread; i += 2) {
+            int value = thread_id * num_elements_per_thread + i;
+            ASSERT_TRUE(crl.searchLock(value, value + 1));
+            ASSERT_TRUE(crl.releaseLock(value, value + 1));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(opFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(crl.size(), 0);
+}
+
+// Test case for mutual exclusion of the optimistic variant
+TEST(OptimisticRangeLock, OverlappingRanges) {
+    const int num_threads = 8;
+    const int num_operations_per_thread = 20000;
+    const int num_keys = 64;
+    OptimisticRangeLock_V1<int, maxLevel> crl{};
+    std::vector<std::atomic<int>> holders(num_keys);
+
+    auto opFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        std::uniform_int_distribution<int> dist(0, num_keys - 4);
+
+        for (int i = 0; i < num_operations_per_thread; ++i) {
+            int start = dist(rng);
+            int end = start + 3;
+            if (!crl.tryLock(start, end)) {
+                continue;
+            }
+            for (int key = start; key < end; ++key) {
+                ASSERT_EQ(holders[key].fetch_add(1), 0);
+            }
+            for (int key = start; key < end; ++key) {
+                holders[key].fetch_sub(1);
+            }
+            ASSERT_TRUE(crl.releaseLock(start, end));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(opFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(crl.size(), 0);
+}
+
+// Test case for the allocations on the acquire and release paths
+TEST(ConcurrentRangeLock, HotPathAllocations) {
+    expectHotPathAllocations<ConcurrentRangeLock_V1<int, maxLevel, MutexLock>>();
+    expectHotPathAllocations<ConcurrentRangeLock_V1<int, maxLevel, SpinLock>>();
+    expectHotPathAllocations<
+        ConcurrentRangeLock_V1<int, maxLevel, OptimisticMutex>>();
+    expectHotPathAllocations<OptimisticRangeLock_V1<int, maxLevel>>();
+}
+
+// Test case for releases that leave the physical unlink to later traversals
+// or to a maintenance thread
+TEST(ConcurrentRangeLock, DeferredUnlink) {
+    ConcurrentRangeLock_V1<int, maxLevel> crl{true};
+
+    for (int i = 0; i < 100; i += 10) {
+        ASSERT_TRUE(crl.tryLock(i, i + 5));
+    }
+    for (int i = 0; i < 100; i += 20) {
+        ASSERT_TRUE(crl.releaseLock(i, i + 5));
+        ASSERT_FALSE(crl.releaseLock(i, i + 5));
+    }
+    ASSERT_EQ(crl.size(), 5);
+    ASSERT_FALSE(crl.isLocked(20));
+    ASSERT_TRUE(crl.isLocked(30));
+
+    // Relocking a released range and locking next to one unlinks on the way,
+    // depending on the tower heights it may also unlink further neighbours
+    ASSERT_TRUE(crl.tryLock(20, 25));
+    ASSERT_TRUE(crl.tryLock(45, 48));
+    ASSERT_LE(crl.unlinkMarked(), 3);
+    ASSERT_EQ(crl.unlinkMarked(), 0);
+
+    const int num_threads = 8;
+    const int num_ranges = 500;
+    std::atomic<bool> done{false};
+    std::thread maintenance([&]() {
+        while (!done.load()) {
+            crl.unlinkMarked();
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            int base = 1000 + t * num_ranges * 10;
+            for (int round = 0; round < 4; ++round) {
+                for (int i = 0; i < num_ranges; ++i) {
+                    EXPECT_TRUE(crl.tryLock(base + i * 10, base + i * 10 + 5));
+                }
+                for (int i = 0; i < num_ranges; ++i) {
+                    EXPECT_TRUE(
+                        crl.releaseLock(base + i * 10, base + i * 10 + 5));
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    done.store(true);
+    maintenance.join();
+
+    crl.unlinkMarked();
+    ASSERT_EQ(crl.unlinkMarked(), 0);
+    ASSERT_EQ(crl.size(), 7);
+    ASSERT_FALSE(crl.anyOverlap(1000, 1000 + num_threads * num_ranges * 10));
+}
+
 // Test case for all operations concurrently
 TEST(ConcurrentRangeLock, MixedOperationsConcurrently) {
     const int num_threads = 50;
     const int num_operations_per_thread = 1000;
-    ConcurrentRangeLock<int, maxLevel> crl{};
+    ConcurrentRangeLock_V1<int, maxLevel> crl{};
 
     auto mixedOpFunc = [&](int thread_id) {
         for (int i = 0; i < num_operations_per_thread; i += 2) {
@@ -124,7 +387,7 @@ TEST(ConcurrentRangeLock, MixedOperationsConcurrently) {
 TEST(ConcurrentRangeLock, HighConcurrencyInsertions) {
     const int num_threads = 50;
     const int num_elements_per_thread = 20;
-    ConcurrentRangeLock<int, maxLevel> crl{};
+    ConcurrentRangeLock_V1<int, maxLevel> crl{};
 
     auto tryLockFunc = [&](int thread_id) {
         for (int i = 0; i < num_elements_per_thread; i += 2) {
@@ -148,7 +411,7 @@ TEST(ConcurrentRangeLock, HighConcurrencyInsertions) {
 // Test case for validating list integrity after concurrent deletions
 TEST(ConcurrentRangeLock, ValidateIntegrityAfterConcurrentDeletions) {
     const int num_elements = 1000;
-    ConcurrentRangeLock<int, maxLevel> crl{};
+    ConcurrentRangeLock_V1<int, maxLevel> crl{};
 
     for (int i = 0; i < num_elements; i += 2) {
         crl.tryLock(i, i + 1);
@@ -175,7 +438,7 @@ TEST(ConcurrentRangeLock, ValidateIntegrityAfterConcurrentDeletions) {
 TEST(ConcurrentRangeLock, RapidConsecutiveInsertionsAndDeletions) {
     const int num_threads = 10;
     const int value = 123;
-    ConcurrentRangeLock<int, maxLevel> crl{};
+    ConcurrentRangeLock_V1<int, maxLevel> crl{};
 
     auto insertDeleteFunc = [&](int) {
         for (int i = 0; i < 100; i += 2) {
@@ -200,7 +463,7 @@ TEST(ConcurrentRangeLock, RapidConsecutiveInsertionsAndDeletions) {
 
 //     worker_thread_id = 0;
 
-//     ConcurrentRangeLock<int, maxLevel> crl{};
+//     ConcurrentRangeLock_V1<int, maxLevel> crl{};
 
 //     EXPECT_TRUE(crl.tryLock(101, 50));
 //     EXPECT_FALSE(crl.tryLock(100, 2));
@@ -216,7 +479,7 @@ TEST(ConcurrentRangeLock, RapidConsecutiveInsertionsAndDeletions) {
 // }
 
 // TEST(ConcurrentRangeLock, Concurrency) {
-//     ConcurrentRangeLock<int, maxLevel> crl{};
+//     ConcurrentRangeLock_V1<int, maxLevel> crl{};
 
 //     std::thread threads[NO_THREADS];
 
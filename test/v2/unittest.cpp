@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <random>
 #include <thread>
 #include <vector>
 
@@ -132,6 +134,170 @@ TEST(ConcurrentRangeLock, ValidateIntegrityAfterConcurrentDeletions) {
     }
 }
 
+// Test case for acquires that start from the skip-ahead hints, with a tiny
+// index so that hints from different key regions share a slot
+TEST(ConcurrentRangeLock, HintIndex) {
+    for (size_t buckets : {size_t{0}, size_t{8}, size_t{1} << 16}) {
+        ListRL myList(buckets, 4);
+        const int num_threads = 8;
+        const int num_ranges = 4000;
+
+        std::vector<uint64_t> starts;
+        for (int i = 0; i < num_ranges; ++i) {
+            starts.push_back(i * 10);
+        }
+        std::shuffle(starts.begin(), starts.end(), std::mt19937(42));
+
+        std::vector<RangeLock*> locks(num_ranges);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (int i = t; i < num_ranges; i += num_threads) {
+                    locks[i] = MutexRangeAcquire(&myList, starts[i],
+                                                 starts[i] + 5);
+                    ASSERT_NE(locks[i], nullptr);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        ASSERT_EQ(myList.size(), num_ranges);
+
+        for (int i = 0; i < num_ranges; ++i) {
+            ASSERT_EQ(MutexRangeAcquire(&myList, i * 10 + 4, i * 10 + 7),
+                      nullptr);
+        }
+
+        // Release every other range, the freed gaps become acquirable
+        for (int i = 0; i < num_ranges; i += 2) {
+            MutexRangeRelease(&myList, locks[i]);
+        }
+        for (int i = 0; i < num_ranges; i += 2) {
+            uint64_t start = starts[i];
+            ASSERT_NE(MutexRangeAcquire(&myList, start, start + 10), nullptr);
+        }
+        ASSERT_EQ(myList.size(), num_ranges);
+    }
+}
+
+// Test case for overlapping readers and writers
+TEST(ConcurrentRangeLock, ReaderWriter) {
+    ListRL myList;
+
+    auto r1 = RWRangeAcquire(&myList, 0, 10, true);
+    auto r2 = RWRangeAcquire(&myList, 5, 15, true);
+    ASSERT_NE(r1, nullptr);
+    ASSERT_NE(r2, nullptr);
+    ASSERT_EQ(RWRangeAcquire(&myList, 8, 12, false), nullptr);
+    ASSERT_EQ(RWRangeAcquire(&myList, 0, 20, false), nullptr);
+
+    auto w1 = RWRangeAcquire(&myList, 20, 30, false);
+    ASSERT_NE(w1, nullptr);
+    ASSERT_EQ(RWRangeAcquire(&myList, 25, 26, true), nullptr);
+
+    RWRangeRelease(&myList, r1);
+    ASSERT_NE(RWRangeAcquire(&myList, 0, 5, false), nullptr);
+    RWRangeRelease(&myList, r2);
+    ASSERT_NE(RWRangeAcquire(&myList, 5, 15, false), nullptr);
+    ASSERT_EQ(myList.size(), 3);
+
+    // Concurrently, every key tracks its holders: -1 for a writer,
+    // otherwise the number of readers
+    const int num_threads = 8;
+    const int num_keys = 64;
+    std::vector<std::atomic<int>> holders(num_keys);
+    ListRL sharedList;
+
+    auto rwFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        for (int i = 0; i < 5000; ++i) {
+            uint64_t start = rng() % (num_keys - 4);
+            uint64_t end = start + 1 + rng() % 4;
+            bool reader = rng() % 4 != 0;
+
+            auto rl = RWRangeAcquire(&sharedList, start, end, reader);
+            if (!rl) continue;
+            for (uint64_t k = start; k < end; ++k) {
+                if (reader) {
+                    EXPECT_GE(holders[k].fetch_add(1), 0);
+                } else {
+                    EXPECT_EQ(holders[k].exchange(-1), 0);
+                }
+            }
+            for (uint64_t k = start; k < end; ++k) {
+                if (reader) {
+                    holders[k].fetch_sub(1);
+                } else {
+                    holders[k].store(0);
+                }
+            }
+            RWRangeRelease(&sharedList, rl);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(rwFunc, i);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(sharedList.size(), 0);
+}
+
+// Test case for acquires that wait for overlapping ranges in the list
+TEST(ConcurrentRangeLock, WaitingAcquire) {
+    const int num_threads = 8;
+    const int num_keys = 32;
+
+    for (bool readerWriter : {false, true}) {
+        ListRL myList;
+        std::vector<std::atomic<int>> holders(num_keys);
+        std::atomic<int> acquired{0};
+
+        auto waitFunc = [&](int thread_id) {
+            std::mt19937 rng(thread_id);
+            for (int i = 0; i < 2000; ++i) {
+                uint64_t start = rng() % (num_keys - 8);
+                uint64_t end = start + 1 + rng() % 8;
+                bool reader = readerWriter && rng() % 2 == 0;
+
+                auto rl = readerWriter
+                              ? RWRangeAcquireWait(&myList, start, end, reader)
+                              : MutexRangeAcquireWait(&myList, start, end);
+                acquired++;
+                for (uint64_t k = start; k < end; ++k) {
+                    if (reader) {
+                        EXPECT_GE(holders[k].fetch_add(1), 0);
+                    } else {
+                        EXPECT_EQ(holders[k].exchange(-1), 0);
+                    }
+                }
+                std::this_thread::yield();
+                for (uint64_t k = start; k < end; ++k) {
+                    if (reader) {
+                        holders[k].fetch_sub(1);
+                    } else {
+                        holders[k].store(0);
+                    }
+                }
+                MutexRangeRelease(&myList, rl);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; ++i) {
+            threads.emplace_back(waitFunc, i);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        ASSERT_EQ(acquired.load(), num_threads * 2000);
+        ASSERT_EQ(myList.size(), 0);
+    }
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
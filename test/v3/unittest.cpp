@@ -6,6 +6,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include "../../src/v3/adaptive.hpp"
+#include "../../src/v3/delegation.hpp"
 #include "../../src/v3/range_lock.hpp"
 
 // Test case for concurrent insertions
@@ -178,4 +180,293 @@ TEST(XiangSongRangeLock, CorrectOrderOfInsertion) {
         pred = curr;
         curr = pred->forward[0];
     }
-}
\ No newline at end of file
+}
+// Test case for flat-combining mode with more threads than slots
+TEST(XiangSongRangeLock, FlatCombining) {
+    const int num_threads = SongRangeLock<>::COMBINING_SLOTS + 16;
+    const int num_elements_per_thread = 200;
+    SongRangeLock rl(true);
+
+    auto lockReleaseFunc = [&](int thread_id) {
+        for (int i = 0; i < num_elements_per_thread; i += 2) {
+            int value = thread_id * num_elements_per_thread + i;
+            ASSERT_TRUE(rl.tryLock(value, value));
+            ASSERT_FALSE(rl.tryLock(value, value + 1));
+        }
+        for (int i = 0; i < num_elements_per_thread; i += 4) {
+            rl.releaseLock(thread_id * num_elements_per_thread + i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(rl.size(), num_threads * num_elements_per_thread / 4);
+    auto pred = rl.head_;
+    for (auto curr = pred->forward[0]; curr != rl.tail_;) {
+        ASSERT_TRUE(pred->end < curr->start);
+        pred = curr;
+        curr = pred->forward[0];
+    }
+}
+
+// Runs concurrent lock and release rounds over shared keys with the given
+// global lock policy and checks that held ranges never overlap
+template <typename Lock>
+void expectExclusiveRanges() {
+    const int num_threads = 16;
+    const int num_keys = 64;
+    SongRangeLock<Lock> rl;
+    std::vector<std::atomic<int>> holders(num_keys);
+
+    auto lockReleaseFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        for (int i = 0; i < 500; ++i) {
+            uint64_t start = 1 + rng() % (num_keys - 5);
+            uint64_t end = start + rng() % 4;
+            if (!rl.tryLock(start, end)) {
+                continue;
+            }
+            for (uint64_t k = start; k <= end; ++k) {
+                EXPECT_EQ(holders[k].fetch_add(1), 0);
+            }
+            for (uint64_t k = start; k <= end; ++k) {
+                holders[k].fetch_sub(1);
+            }
+            rl.releaseLock(start);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(rl.size(), 0);
+}
+
+// Test case for every global lock policy
+TEST(XiangSongRangeLock, GlobalLockPolicies) {
+    expectExclusiveRanges<std::mutex>();
+    expectExclusiveRanges<SpinThenParkMutex>();
+    expectExclusiveRanges<TTASLock<false>>();
+    expectExclusiveRanges<TTASLock<true>>();
+    expectExclusiveRanges<TicketLock<false>>();
+    expectExclusiveRanges<TicketLock<true>>();
+    expectExclusiveRanges<MCSLock<false>>();
+    expectExclusiveRanges<MCSLock<true>>();
+    expectExclusiveRanges<SampledMutex>();
+}
+
+// Test case for batched acquire and release
+TEST(XiangSongRangeLock, BatchLockRelease) {
+    SongRangeLock rl;
+    ASSERT_TRUE(rl.tryLock(500, 505));
+
+    std::vector<std::pair<uint64_t, uint64_t>> batch;
+    for (uint64_t i = 1; i < 100; ++i) {
+        batch.emplace_back(i * 10, i * 10 + 5);
+    }
+
+    // Conflicts with a held range or inside the batch lock nothing
+    ASSERT_FALSE(rl.tryLockBatch(batch));
+    ASSERT_EQ(rl.size(), 1);
+    ASSERT_FALSE(rl.tryLockBatch({{1000, 1010}, {1005, 1020}}));
+    ASSERT_EQ(rl.size(), 1);
+
+    rl.releaseLock(500);
+    ASSERT_TRUE(rl.tryLockBatch(batch));
+    ASSERT_EQ(rl.size(), batch.size());
+    for (auto& range : batch) {
+        ASSERT_FALSE(rl.tryLock(range.first + 1, range.first + 2));
+    }
+    ASSERT_TRUE(rl.tryLock(7, 8));
+
+    std::vector<std::pair<uint64_t, uint64_t>> odd;
+    for (size_t i = 1; i < batch.size(); i += 2) {
+        odd.push_back(batch[i]);
+    }
+    // An unsorted batch releases nothing
+    std::vector<std::pair<uint64_t, uint64_t>> reversed(odd.rbegin(),
+                                                        odd.rend());
+    ASSERT_FALSE(rl.releaseLockBatch(reversed));
+    ASSERT_EQ(rl.size(), batch.size() + 1);
+    ASSERT_TRUE(rl.releaseLockBatch(odd));
+    ASSERT_EQ(rl.size(), batch.size() - odd.size() + 1);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        ASSERT_EQ(rl.tryLock(batch[i].first, batch[i].second), i % 2 == 1);
+    }
+
+    auto pred = rl.head_;
+    for (auto curr = pred->forward[0]; curr != rl.tail_;) {
+        ASSERT_TRUE(pred->end < curr->start);
+        pred = curr;
+        curr = pred->forward[0];
+    }
+}
+
+TEST(XiangSongRangeLock, ReleaseNotHeld) {
+    SongRangeLock rl;
+    ASSERT_TRUE(rl.tryLock(10, 15));
+    ASSERT_TRUE(rl.tryLock(30, 35));
+
+    // Starts that are not held leave the next range, and the tail, alone
+    rl.releaseLock(12);
+    rl.releaseLock(40);
+    ASSERT_FALSE(rl.releaseLockBatch({{5, 8}, {20, 25}, {30, 35}, {50, 55}}));
+    ASSERT_EQ(rl.size(), 1);
+    ASSERT_FALSE(rl.tryLock(10, 15));
+    ASSERT_TRUE(rl.tryLock(30, 35));
+    ASSERT_TRUE(rl.tryLock(50, 55));
+    ASSERT_EQ(rl.size(), 3);
+}
+
+// Test case for the delegation front-end with more clients than slots
+TEST(XiangSongRangeLock, Delegation) {
+    const int num_threads = DelegatedRangeLock::CLIENT_SLOTS + 16;
+    const int num_elements_per_thread = 200;
+    DelegatedRangeLock rl;
+
+    auto lockReleaseFunc = [&](int thread_id) {
+        for (int i = 0; i < num_elements_per_thread; i += 2) {
+            int value = thread_id * num_elements_per_thread + i;
+            ASSERT_TRUE(rl.tryLock(value, value));
+            ASSERT_FALSE(rl.tryLock(value, value + 1));
+        }
+        for (int i = 0; i < num_elements_per_thread; i += 4) {
+            rl.releaseLock(thread_id * num_elements_per_thread + i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(rl.size(), num_threads * num_elements_per_thread / 4);
+    for (int t = 0; t < num_threads; ++t) {
+        int value = t * num_elements_per_thread;
+        ASSERT_TRUE(rl.tryLock(value, value));
+        ASSERT_FALSE(rl.tryLock(value + 2, value + 2));
+    }
+}
+
+// Test case for moving held ranges between the two adaptive modes
+TEST(XiangSongRangeLock, AdaptiveMigration) {
+    using Mode = AdaptiveRangeLock::Mode;
+    AdaptiveRangeLock rl(Mode::COARSE, false);
+    for (uint64_t i = 1; i <= 50; ++i) {
+        ASSERT_TRUE(rl.tryLock(i * 10, i * 10 + 5));
+    }
+
+    ASSERT_TRUE(rl.switchTo(Mode::LOCK_FREE));
+    ASSERT_EQ(rl.mode(), Mode::LOCK_FREE);
+    ASSERT_EQ(rl.size(), 50);
+    ASSERT_FALSE(rl.tryLock(103, 108));
+    ASSERT_TRUE(rl.tryLock(106, 109));
+    for (uint64_t i = 1; i <= 50; i += 2) {
+        rl.releaseLock(i * 10, i * 10 + 5);
+    }
+
+    ASSERT_TRUE(rl.switchTo(Mode::COARSE));
+    ASSERT_EQ(rl.mode(), Mode::COARSE);
+    ASSERT_EQ(rl.migrations(), 2);
+    ASSERT_EQ(rl.size(), 26);
+    ASSERT_FALSE(rl.tryLock(107, 107));
+    for (uint64_t i = 1; i <= 50; ++i) {
+        ASSERT_EQ(rl.tryLock(i * 10 + 1, i * 10 + 2), i % 2 == 1);
+    }
+}
+
+// Test case for a range starting at 0 kept across both adaptive modes
+TEST(XiangSongRangeLock, AdaptiveRangeAtZero) {
+    using Mode = AdaptiveRangeLock::Mode;
+    AdaptiveRangeLock rl(Mode::COARSE, false);
+    ASSERT_TRUE(rl.tryLock(0, 5));
+
+    ASSERT_TRUE(rl.switchTo(Mode::LOCK_FREE));
+    ASSERT_EQ(rl.size(), 1);
+    ASSERT_FALSE(rl.tryLock(2, 3));
+    ASSERT_FALSE(rl.tryLock(0, 0));
+    ASSERT_TRUE(rl.tryLock(6, 7));
+    rl.releaseLock(6, 7);
+
+    ASSERT_TRUE(rl.switchTo(Mode::COARSE));
+    ASSERT_EQ(rl.size(), 1);
+    ASSERT_FALSE(rl.tryLock(5, 6));
+    rl.releaseLock(0, 5);
+    ASSERT_EQ(rl.size(), 0);
+    ASSERT_TRUE(rl.tryLock(0, 0));
+}
+
+// Test case for the statistics of a SampledMutex staying with the instance
+TEST(XiangSongRangeLock, SampledMutexPerInstance) {
+    SongRangeLock<SampledMutex> first, second;
+    for (uint64_t i = 1; i <= 10; ++i) {
+        ASSERT_TRUE(first.tryLock(i * 10, i * 10 + 5));
+    }
+    ASSERT_EQ(first.globalLock().stats().acquisitions, 10);
+    ASSERT_EQ(second.globalLock().stats().acquisitions, 0);
+}
+
+// Test case for exclusive ranges while the adaptive lock keeps switching
+TEST(XiangSongRangeLock, AdaptiveConcurrently) {
+    using Mode = AdaptiveRangeLock::Mode;
+    const int num_threads = 16;
+    const int num_keys = 64;
+    AdaptiveRangeLock rl;
+    std::vector<std::atomic<int>> holders(num_keys);
+    std::atomic<bool> done{false};
+
+    auto lockReleaseFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        for (int i = 0; i < 5000; ++i) {
+            uint64_t start = 1 + rng() % (num_keys - 5);
+            uint64_t end = start + rng() % 4;
+            if (!rl.tryLock(start, end)) {
+                continue;
+            }
+            for (uint64_t k = start; k <= end; ++k) {
+                EXPECT_EQ(holders[k].fetch_add(1), 0);
+            }
+            for (uint64_t k = start; k <= end; ++k) {
+                holders[k].fetch_sub(1);
+            }
+            rl.releaseLock(start, end);
+        }
+    };
+
+    std::thread switcher([&]() {
+        for (int i = 0; !done.load(); ++i) {
+            rl.switchTo(i % 2 ? Mode::COARSE : Mode::LOCK_FREE);
+            std::this_thread::yield();
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    done.store(true);
+    switcher.join();
+
+    ASSERT_GT(rl.migrations(), 0);
+    ASSERT_EQ(rl.size(), 0);
+}
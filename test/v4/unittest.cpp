@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../../src/v4/locktree.h"
+
+constexpr uint64_t escalationThreshold = 64;
+
+// Test case for conflicting owners
+TEST(LockTree, ConflictingOwners) {
+    locktree lt;
+    lt.create(escalationThreshold);
+
+    ASSERT_TRUE(lt.acquire_write_lock(1, 10, 20));
+    ASSERT_FALSE(lt.acquire_write_lock(2, 15, 25));
+    ASSERT_FALSE(lt.acquire_write_lock(2, 0, 10));
+    ASSERT_TRUE(lt.acquire_write_lock(2, 21, 30));
+
+    // an owner never conflicts with itself, its ranges are consolidated
+    ASSERT_TRUE(lt.acquire_write_lock(1, 5, 12));
+    ASSERT_EQ(lt.get_range_count(1), 1);
+    ASSERT_FALSE(lt.acquire_write_lock(2, 5, 5));
+
+    lt.release_locks(1);
+    lt.release_locks(2);
+    lt.destroy();
+}
+
+// Test case for escalation of adjacent ranges
+TEST(LockTree, EscalationMergesAdjacentRanges) {
+    locktree lt;
+    lt.create(escalationThreshold);
+
+    // owner 2 sits in the gap at 505, splitting owner 1 into two runs
+    ASSERT_TRUE(lt.acquire_write_lock(2, 505, 506));
+    for (uint64_t i = 0; i < escalationThreshold; i++) {
+        ASSERT_TRUE(lt.acquire_write_lock(1, i * 10, i * 10 + 1));
+    }
+    ASSERT_EQ(lt.get_range_count(1), escalationThreshold);
+
+    ASSERT_TRUE(lt.acquire_write_lock(1, 1000, 1001));
+    ASSERT_EQ(lt.get_range_count(1), 2);
+
+    // the gaps between owner 1's ranges are covered now, owner 2's is not
+    ASSERT_FALSE(lt.acquire_write_lock(3, 5, 5));
+    ASSERT_FALSE(lt.acquire_write_lock(3, 995, 995));
+    ASSERT_FALSE(lt.acquire_write_lock(3, 505, 505));
+    ASSERT_TRUE(lt.acquire_write_lock(3, 2000, 2001));
+
+    lt.release_locks(1);
+    ASSERT_EQ(lt.get_range_count(1), 0);
+    ASSERT_TRUE(lt.acquire_write_lock(3, 5, 5));
+
+    lt.release_locks(2);
+    lt.release_locks(3);
+    lt.destroy();
+}
+
+// Test case for concurrent owners that escalate and release
+TEST(LockTree, ConcurrentOwners) {
+    const int num_threads = 16;
+    const uint64_t num_ranges_per_thread = 2000;
+    locktree lt;
+    lt.create(escalationThreshold);
+
+    auto ownerFunc = [&](int thread_id) {
+        TXNID txnid = thread_id + 1;
+        uint64_t base = thread_id * num_ranges_per_thread * 4;
+        for (uint64_t i = 0; i < num_ranges_per_thread; i++) {
+            ASSERT_TRUE(lt.acquire_write_lock(txnid, base + i * 4,
+                                              base + i * 4 + 1));
+        }
+        ASSERT_LE(lt.get_range_count(txnid), escalationThreshold);
+        lt.release_locks(txnid);
+        ASSERT_EQ(lt.get_range_count(txnid), 0);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(ownerFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_TRUE(lt.acquire_write_lock(1, 0, UINT64_MAX - 1));
+    lt.release_locks(1);
+    lt.destroy();
+}
+
+// notes whether a locked keyrange holds any range
+struct any_range {
+    bool found = false;
+
+    bool fn(const keyrange&, TXNID) {
+        found = true;
+        return false;
+    }
+};
+
+// Test case for optimistic acquires mixed with prepared ones
+TEST(LockTree, OptimisticAcquire) {
+    const int num_threads = 16;
+    const uint64_t num_keys = 256;
+    const int num_rounds = 2000;
+    concurrent_tree tree;
+    tree.create();
+    std::vector<std::atomic<int>> holders(num_keys);
+
+    auto lockReleaseFunc = [&](int thread_id) {
+        std::mt19937 rng(thread_id);
+        for (int i = 0; i < num_rounds; i++) {
+            uint64_t left = rng() % num_keys;
+            uint64_t right = std::min<uint64_t>(left + rng() % 4, num_keys - 1);
+            keyrange range;
+            range.create(left, right);
+
+            concurrent_tree::locked_keyrange lkr;
+            if (i % 8 == 0) {
+                lkr.prepare(&tree);
+                lkr.acquire(left, right);
+            } else {
+                lkr.acquire_optimistic(&tree, left, right);
+            }
+            any_range conflict;
+            lkr.iterate(&conflict);
+            if (!conflict.found) {
+                lkr.insert(range, thread_id + 1);
+            }
+            lkr.release();
+            if (conflict.found) {
+                continue;
+            }
+
+            for (uint64_t key = left; key <= right; key++) {
+                ASSERT_EQ(holders[key].fetch_add(1), 0);
+            }
+            for (uint64_t key = left; key <= right; key++) {
+                holders[key].fetch_sub(1);
+            }
+
+            lkr.acquire_optimistic(&tree, left, right);
+            lkr.remove(range);
+            lkr.release();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(lockReleaseFunc, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_TRUE(tree.is_empty());
+    tree.destroy();
+}
+
+// Test case for the tree with and without the treenode pool
+TEST(LockTree, NodePool) {
+    const uint64_t pooled = concurrent_tree::get_insertion_memory_overhead();
+    ASSERT_GE(pooled, sizeof(treenode));
+    ASSERT_LT(pooled, sizeof(treenode) + 16);
+
+    for (bool pooling : {false, true}) {
+        treenode::set_pooling(pooling);
+        locktree lt;
+        lt.create(escalationThreshold);
+        for (int round = 0; round < 3; round++) {
+            for (uint64_t i = 0; i < 1000; i++) {
+                ASSERT_TRUE(lt.acquire_write_lock(i % 4 + 1, i * 10,
+                                                  i * 10 + 5));
+            }
+            ASSERT_FALSE(lt.acquire_write_lock(5, 0, 0));
+            for (TXNID txnid = 1; txnid <= 4; txnid++) {
+                lt.release_locks(txnid);
+            }
+            ASSERT_TRUE(lt.acquire_write_lock(5, 0, 0));
+            lt.release_locks(5);
+        }
+        lt.destroy();
+    }
+    ASSERT_EQ(concurrent_tree::get_insertion_memory_overhead(), pooled);
+}